@@ -9,13 +9,37 @@
  *		yourself.  Besides, it's possible that they're hanging
  *		around other places, like abstract syntax trees.
  *
+ *		The index of a large scope is an open-addressing hash table
+ *		with linear probing, like the string table, kept at most
+ *		half full.  It holds the symbols themselves rather than
+ *		their positions, so removing a symbol from the middle of
+ *		the list does not disturb the rest of the index.
+ *
  *		Extra functionality:
  *		- retrieving the vector of symbols
+ *		- indexing large scopes
  */
 
 # include <cassert>
+# include <cstdint>
 # include "Scope.h"
 
+# define SMALL_SCOPE 8		/* largest scope searched linearly */
+
+
+/*
+ * Function:	hashName
+ *
+ * Description:	Return the hash of the given name.  Names are interned, so
+ *		it is their addresses that are hashed, not their
+ *		characters.
+ */
+
+static unsigned hashName(Name name)
+{
+    return (unsigned long long) (uintptr_t) name * 0x9e3779b97f4a7c15ull >> 32;
+}
+
 
 /*
  * Function:	Scope::Scope (constructor)
@@ -29,18 +53,69 @@ Scope::Scope(Scope *enclosing)
 }
 
 
+/*
+ * Function:	Scope::slot (private)
+ *
+ * Description:	Return the slot in the index that holds the symbol with
+ *		the given name, or the empty slot where it would go.
+ */
+
+unsigned Scope::slot(Name name) const
+{
+    unsigned mask, i;
+
+
+    mask = _index.size() - 1;
+
+    for (i = hashName(name) & mask; _index[i] != nullptr; i = (i + 1) & mask)
+	if (_index[i]->name() == name)
+	    break;
+
+    return i;
+}
+
+
+/*
+ * Function:	Scope::rehash (private)
+ *
+ * Description:	Rebuild the index, large enough that it is at most a
+ *		quarter full.
+ */
+
+void Scope::rehash()
+{
+    unsigned size;
+
+
+    for (size = 16; size < 4 * _symbols.size(); size *= 2)
+	continue;
+
+    _index.assign(size, nullptr);
+
+    for (unsigned i = 0; i < _symbols.size(); i ++)
+	_index[slot(_symbols[i]->name())] = _symbols[i];
+}
+
+
 /*
  * Function:	Scope::insert
  *
  * Description:	Insert the given symbol into this scope.  It had better not
- *		already be inserted, or we fail big time.
+ *		already be inserted, or we fail big time.  The index is
+ *		built once the scope is no longer small, and rebuilt
+ *		whenever it would be more than half full.
  */
 
-
 void Scope::insert(Symbol *symbol)
 {
     assert(find(symbol->name()) == nullptr);
     _symbols.push_back(symbol);
+
+    if (2 * _symbols.size() > _index.size()) {
+	if (_symbols.size() > SMALL_SCOPE)
+	    rehash();
+    } else
+	_index[slot(symbol->name())] = symbol;
 }
 
 
@@ -51,8 +126,11 @@ void Scope::insert(Symbol *symbol)
  *		scope.  If no such symbol is found, return a null pointer.
  */
 
-Symbol *Scope::find(const string &name) const
+Symbol *Scope::find(Name name) const
 {
+    if (!_index.empty())
+	return _index[slot(name)];
+
     for (unsigned i = 0; i < _symbols.size(); i ++)
 	if (name == _symbols[i]->name())
 	    return _symbols[i];
@@ -66,14 +144,40 @@ Symbol *Scope::find(const string &name) const
  *
  * Description:	Remove the symbol with the given name from this scope.
  *		Yes, I know, I duplicated the search logic from above.
- *		And, yes, I still didn't use an iterator.  So sue me.
+ *		And, yes, I still didn't use an iterator.  So sue me.  We
+ *		search from the end, since the symbol being removed is
+ *		often the one most recently inserted.
+ *
+ *		If the scope is indexed, the slot of the symbol is emptied,
+ *		and each symbol after it in the same run of slots is moved
+ *		into the hole unless that would put it before the slot
+ *		where its probe begins.  Otherwise, a later probe could
+ *		stop at the hole and miss it.
  */
 
-void Scope::remove(const string &name)
+void Scope::remove(Name name)
 {
-    for (unsigned i = 0; i < _symbols.size(); i ++)
-	if (name == _symbols[i]->name())
-	    _symbols.erase(_symbols.begin() + i);
+    unsigned i, j, mask;
+
+
+    for (i = _symbols.size(); i > 0; i --)
+	if (name == _symbols[i - 1]->name()) {
+	    _symbols.erase(_symbols.begin() + i - 1);
+	    break;
+	}
+
+    if (_index.empty() || _index[i = slot(name)] == nullptr)
+	return;
+
+    mask = _index.size() - 1;
+    _index[i] = nullptr;
+
+    for (j = (i + 1) & mask; _index[j] != nullptr; j = (j + 1) & mask)
+	if (((j - hashName(_index[j]->name())) & mask) >= ((j - i) & mask)) {
+	    _index[i] = _index[j];
+	    _index[j] = nullptr;
+	    i = j;
+	}
 }
 
 
@@ -86,15 +190,17 @@ void Scope::remove(const string &name)
  *		null pointer.
  */
 
-Symbol *Scope::lookup(const string &name) const
+Symbol *Scope::lookup(Name name) const
 {
+    const Scope *scope;
     Symbol *symbol;
 
 
-    if ((symbol = find(name)) != nullptr)
-	return symbol;
+    for (scope = this; scope != nullptr; scope = scope->_enclosing)
+	if ((symbol = scope->find(name)) != nullptr)
+	    return symbol;
 
-    return _enclosing != nullptr ? _enclosing->lookup(name) : nullptr;
+    return nullptr;
 }
 
 
@@ -11,30 +11,35 @@
  *		convention, a null scope is used if there is no enclosing
  *		scope.  The find function searches only the given scope,
  *		whereas the lookup function searches the given scope and
- *		all enclosing scopes.
+ *		all enclosing scopes.  Since names are interned, both
+ *		compare names by pointer rather than by their characters.
+ *		Scopes are allocated in arenas.
  */
 
 # ifndef SCOPE_H
 # define SCOPE_H
 # include "Symbol.h"
+# include "arena.h"
 # include "nullptr.h"
 # include <vector>
 
 typedef std::vector<Symbol *> Symbols;
 
-class Scope {
-    typedef std::string string;
-
+class Scope : public Allocated<Scope> {
     Scope *_enclosing;
     Symbols _symbols;
+    Symbols _index;
+
+    unsigned slot(Name name) const;
+    void rehash();
 
 public:
     Scope(Scope *enclosing = nullptr);
 
     void insert(Symbol *symbol);
-    void remove(const string &name);
-    Symbol *find(const string &name) const;
-    Symbol *lookup(const string &name) const;
+    void remove(Name name);
+    Symbol *find(Name name) const;
+    Symbol *lookup(Name name) const;
 
     Scope *enclosing() const;
     const Symbols &symbols() const;
@@ -3,21 +3,23 @@
  *
  * Description:	This file contains the class definition for symbols in
  *		Simple C.  At this point, a symbol merely consists of a
- *		name and a type, neither of which you can change.
+ *		name and a type, neither of which you can change.  The
+ *		name is interned, so comparing names is just comparing
+ *		pointers.  Symbols are allocated in arenas.
  */
 
 # ifndef SYMBOL_H
 # define SYMBOL_H
 # include "Type.h"
+# include "arena.h"
 
-class Symbol {
-    typedef std::string string;
-    string _name;
+class Symbol : public Allocated<Symbol> {
+    Name _name;
     Type _type;
 
 public:
-    Symbol(const string &name, const Type &type);
-    const string &name() const;
+    Symbol(Name name, const Type &type);
+    Name name() const;
     const Type &type() const;
     int _offset;
 };
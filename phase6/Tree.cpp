@@ -10,8 +10,8 @@
  *		constructed.
  *
  *		The functions here are just the constructors and accessors.
- *		The storage allocation and code generation functions are
- *		located elsewhere.  Most of these functions don't do
+ *		The passes over a tree are visitors, and are located
+ *		elsewhere.  Most of these functions don't do
  *		anything interesting, and could easily be put in the header
  *		file, but we don't like to do that.
  *
@@ -34,8 +34,8 @@ using namespace std;
  *		have the specified type.
  */
 
-Expression::Expression(const Type &type)
-    : _type(type), _lvalue(false)
+Expression::Expression(Kind kind, const Type &type)
+    : Statement(kind), _type(type), _lvalue(false)
 {
 }
 
@@ -64,16 +64,78 @@ bool Expression::lvalue() const
 }
 
 
+/*
+ * Function:	Unary::Unary (constructor)
+ *
+ * Description:	Initialize a unary expression of the given kind.
+ */
+
+Unary::Unary(Kind kind, Expression *expr, const Type &type)
+    : Expression(kind, type), _expr(expr)
+{
+}
+
+
+/*
+ * Function:	Unary::expr (accessor)
+ *
+ * Description:	Return the operand of this expression.
+ */
+
+Expression *Unary::expr() const
+{
+    return _expr;
+}
+
+
+/*
+ * Function:	Binary::Binary (constructor)
+ *
+ * Description:	Initialize a binary expression of the given kind.
+ */
+
+Binary::Binary(Kind kind, Expression *left, Expression *right,
+	const Type &type)
+    : Expression(kind, type), _left(left), _right(right)
+{
+}
+
+
+/*
+ * Function:	Binary::left (accessor)
+ *
+ * Description:	Return the left operand of this expression.
+ */
+
+Expression *Binary::left() const
+{
+    return _left;
+}
+
+
+/*
+ * Function:	Binary::right (accessor)
+ *
+ * Description:	Return the right operand of this expression.
+ */
+
+Expression *Binary::right() const
+{
+    return _right;
+}
+
+
 /*
  * Function:	String::String (constructor)
  *
- * Description:	Initialize this string literal.  Yes, the expression
- *		for the length of the array is correct.  The literal itself
- *		includes the quotes but the array length should not.
+ * Description:	Initialize this string literal, whose characters have
+ *		already been unescaped by the lexical analyzer.  The array
+ *		includes the terminating null character.
  */
 
-String::String(const string &value)
-    : Expression(Type("char", 0, value.size() - 1)), _value(value)
+String::String(Name value)
+    : Expression(Kind::String, Type(intern("char"), 0, value->size() + 1)),
+      _value(value)
 {
 }
 
@@ -84,7 +146,7 @@ String::String(const string &value)
  * Description:	Return the value of this string.
  */
 
-const string &String::value() const
+Name String::value() const
 {
     return _value;
 }
@@ -96,8 +158,8 @@ const string &String::value() const
  * Description:	Initialize this character literal.
  */
 
-Character::Character(const string &value)
-    : Expression(Type("int")), _value(value)
+Character::Character(int value)
+    : Expression(Kind::Character, Type(intern("int"))), _value(value)
 {
 }
 
@@ -108,7 +170,7 @@ Character::Character(const string &value)
  * Description:	Return the value of this character.
  */
 
-const string &Character::value() const
+int Character::value() const
 {
     return _value;
 }
@@ -122,7 +184,7 @@ const string &Character::value() const
  */
 
 Identifier::Identifier(const Symbol *symbol)
-    : Expression(symbol->type()), _symbol(symbol)
+    : Expression(Kind::Identifier, symbol->type()), _symbol(symbol)
 {
     _lvalue = symbol->type().isScalar();
 }
@@ -146,49 +208,57 @@ const Symbol *Identifier::symbol() const
  * Description:	Initialize a number, which has type int.
  */
 
-Number::Number(const string &value)
-    : Expression(Type("int")), _value(value)
+Number::Number(unsigned value)
+    : Expression(Kind::Number, Type(intern("int"))), _value(value)
 {
 }
 
 
 /*
- * Function:	Number::Number (constructor)
+ * Function:	Number::value (accessor)
  *
- * Description:	Initialize a number from a value.
+ * Description:	Return the value of this number.
  */
 
-Number::Number(unsigned value)
-    : Expression(Type("int"))
+unsigned Number::value() const
 {
-    stringstream ss;
+    return _value;
+}
+
 
-    ss << value;
-    _value = ss.str();
+/*
+ * Function:	Call::Call (constructor)
+ *
+ * Description:	Initialize a function call expression.
+ */
+
+Call::Call(const Symbol *id, const Expressions &args, const Type &type)
+    : Expression(Kind::Call, type), _id(id), _args(args)
+{
 }
 
 
 /*
- * Function:	Number::value (accessor)
+ * Function:	Call::id (accessor)
  *
- * Description:	Return the value of this number.
+ * Description:	Return the symbol of the function called.
  */
 
-const string &Number::value() const
+const Symbol *Call::id() const
 {
-    return _value;
+    return _id;
 }
 
 
 /*
- * Function:	Call::Call (constructor)
+ * Function:	Call::args (accessor)
  *
- * Description:	Initialize a function call expression.
+ * Description:	Return the arguments of this call.
  */
 
-Call::Call(const Symbol *id, const Expressions &args, const Type &type)
-    : Expression(type), _id(id), _args(args)
+const Expressions &Call::args() const
 {
+    return _args;
 }
 
 
@@ -199,12 +269,36 @@ Call::Call(const Symbol *id, const Expressions &args, const Type &type)
  */
 
 Field::Field(Expression *expr, Identifier *id, const Type &type)
-    : Expression(type), _expr(expr), _id(id)
+    : Expression(Kind::Field, type), _expr(expr), _id(id)
 {
     _lvalue = expr->lvalue() && id->lvalue();
 }
 
 
+/*
+ * Function:	Field::expr (accessor)
+ *
+ * Description:	Return the structure of this field reference.
+ */
+
+Expression *Field::expr() const
+{
+    return _expr;
+}
+
+
+/*
+ * Function:	Field::id (accessor)
+ *
+ * Description:	Return the field of this field reference.
+ */
+
+Identifier *Field::id() const
+{
+    return _id;
+}
+
+
 /*
  * Function:	Not::Not (constructor)
  *
@@ -212,7 +306,7 @@ Field::Field(Expression *expr, Identifier *id, const Type &type)
  */
 
 Not::Not(Expression *expr, const Type &type)
-    : Expression(type), _expr(expr)
+    : Unary(Kind::Not, expr, type)
 {
 }
 
@@ -224,7 +318,7 @@ Not::Not(Expression *expr, const Type &type)
  */
 
 Negate::Negate(Expression *expr, const Type &type)
-    : Expression(type), _expr(expr)
+    : Unary(Kind::Negate, expr, type)
 {
 }
 
@@ -236,7 +330,7 @@ Negate::Negate(Expression *expr, const Type &type)
  */
 
 Dereference::Dereference(Expression *expr, const Type &type)
-    : Expression(type), _expr(expr)
+    : Unary(Kind::Dereference, expr, type)
 {
     _lvalue = true;
 }
@@ -249,7 +343,7 @@ Dereference::Dereference(Expression *expr, const Type &type)
  */
 
 Address::Address(Expression *expr, const Type &type)
-    : Expression(type), _expr(expr)
+    : Unary(Kind::Address, expr, type)
 {
 }
 
@@ -261,7 +355,7 @@ Address::Address(Expression *expr, const Type &type)
  */
 
 Cast::Cast(const Type &type, Expression *expr)
-    : Expression(type), _expr(expr)
+    : Unary(Kind::Cast, expr, type)
 {
 }
 
@@ -273,7 +367,7 @@ Cast::Cast(const Type &type, Expression *expr)
  */
 
 Multiply::Multiply(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::Multiply, left, right, type)
 {
 }
 
@@ -285,7 +379,7 @@ Multiply::Multiply(Expression *left, Expression *right, const Type &type)
  */
 
 Divide::Divide(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::Divide, left, right, type)
 {
 }
 
@@ -297,7 +391,7 @@ Divide::Divide(Expression *left, Expression *right, const Type &type)
  */
 
 Remainder::Remainder(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::Remainder, left, right, type)
 {
 }
 
@@ -309,7 +403,7 @@ Remainder::Remainder(Expression *left, Expression *right, const Type &type)
  */
 
 Add::Add(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::Add, left, right, type)
 {
 }
 
@@ -321,7 +415,7 @@ Add::Add(Expression *left, Expression *right, const Type &type)
  */
 
 Subtract::Subtract(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::Subtract, left, right, type)
 {
 }
 
@@ -333,7 +427,7 @@ Subtract::Subtract(Expression *left, Expression *right, const Type &type)
  */
 
 LessThan::LessThan(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::LessThan, left, right, type)
 {
 }
 
@@ -345,7 +439,7 @@ LessThan::LessThan(Expression *left, Expression *right, const Type &type)
  */
 
 GreaterThan::GreaterThan(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::GreaterThan, left, right, type)
 {
 }
 
@@ -357,7 +451,7 @@ GreaterThan::GreaterThan(Expression *left, Expression *right, const Type &type)
  */
 
 LessOrEqual::LessOrEqual(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::LessOrEqual, left, right, type)
 {
 }
 
@@ -369,7 +463,7 @@ LessOrEqual::LessOrEqual(Expression *left, Expression *right, const Type &type)
  */
 
 GreaterOrEqual::GreaterOrEqual(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::GreaterOrEqual, left, right, type)
 {
 }
 
@@ -381,7 +475,7 @@ GreaterOrEqual::GreaterOrEqual(Expression *left, Expression *right, const Type &
  */
 
 Equal::Equal(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::Equal, left, right, type)
 {
 }
 
@@ -393,7 +487,7 @@ Equal::Equal(Expression *left, Expression *right, const Type &type)
  */
 
 NotEqual::NotEqual(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::NotEqual, left, right, type)
 {
 }
 
@@ -405,7 +499,7 @@ NotEqual::NotEqual(Expression *left, Expression *right, const Type &type)
  */
 
 LogicalAnd::LogicalAnd(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::LogicalAnd, left, right, type)
 {
 }
 
@@ -417,7 +511,7 @@ LogicalAnd::LogicalAnd(Expression *left, Expression *right, const Type &type)
  */
 
 LogicalOr::LogicalOr(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+    : Binary(Kind::LogicalOr, left, right, type)
 {
 }
 
@@ -429,8 +523,32 @@ LogicalOr::LogicalOr(Expression *left, Expression *right, const Type &type)
  */
 
 Assignment::Assignment(Expression *left, Expression *right)
-    : _left(left), _right(right)
+    : Statement(Kind::Assignment), _left(left), _right(right)
+{
+}
+
+
+/*
+ * Function:	Assignment::left (accessor)
+ *
+ * Description:	Return the left-hand side of this assignment.
+ */
+
+Expression *Assignment::left() const
+{
+    return _left;
+}
+
+
+/*
+ * Function:	Assignment::right (accessor)
+ *
+ * Description:	Return the right-hand side of this assignment.
+ */
+
+Expression *Assignment::right() const
 {
+    return _right;
 }
 
 
@@ -441,11 +559,23 @@ Assignment::Assignment(Expression *left, Expression *right)
  */
 
 Return::Return(Expression *expr)
-    : _expr(expr)
+    : Statement(Kind::Return), _expr(expr)
 {
 }
 
 
+/*
+ * Function:	Return::expr (accessor)
+ *
+ * Description:	Return the expression returned.
+ */
+
+Expression *Return::expr() const
+{
+    return _expr;
+}
+
+
 /*
  * Function:	Block::Block (constructor)
  *
@@ -453,7 +583,7 @@ Return::Return(Expression *expr)
  */
 
 Block::Block(Scope *decls, const Statements &stmts)
-    : _decls(decls), _stmts(stmts)
+    : Statement(Kind::Block), _decls(decls), _stmts(stmts)
 {
 }
 
@@ -470,6 +600,18 @@ Scope *Block::declarations() const
 }
 
 
+/*
+ * Function:	Block::statements (accessor)
+ *
+ * Description:	Return the statements of this block.
+ */
+
+const Statements &Block::statements() const
+{
+    return _stmts;
+}
+
+
 /*
  * Function:	While::While (constructor)
  *
@@ -477,11 +619,35 @@ Scope *Block::declarations() const
  */
 
 While::While(Expression *expr, Statement *stmt)
-    : _expr(expr), _stmt(stmt)
+    : Statement(Kind::While), _expr(expr), _stmt(stmt)
 {
 }
 
 
+/*
+ * Function:	While::expr (accessor)
+ *
+ * Description:	Return the test of this while statement.
+ */
+
+Expression *While::expr() const
+{
+    return _expr;
+}
+
+
+/*
+ * Function:	While::statement (accessor)
+ *
+ * Description:	Return the body of this while statement.
+ */
+
+Statement *While::statement() const
+{
+    return _stmt;
+}
+
+
 /*
  * Function:	If::If (constructor)
  *
@@ -489,11 +655,48 @@ While::While(Expression *expr, Statement *stmt)
  */
 
 If::If(Expression *expr, Statement *thenStmt, Statement *elseStmt)
-    : _expr(expr), _thenStmt(thenStmt), _elseStmt(elseStmt)
+    : Statement(Kind::If), _expr(expr), _thenStmt(thenStmt),
+      _elseStmt(elseStmt)
 {
 }
 
 
+/*
+ * Function:	If::expr (accessor)
+ *
+ * Description:	Return the test of this if statement.
+ */
+
+Expression *If::expr() const
+{
+    return _expr;
+}
+
+
+/*
+ * Function:	If::thenStatement (accessor)
+ *
+ * Description:	Return the then part of this if statement.
+ */
+
+Statement *If::thenStatement() const
+{
+    return _thenStmt;
+}
+
+
+/*
+ * Function:	If::elseStatement (accessor)
+ *
+ * Description:	Return the else part of this if statement, if any.
+ */
+
+Statement *If::elseStatement() const
+{
+    return _elseStmt;
+}
+
+
 /*
  * Function:	Function::Function (constructor)
  *
@@ -501,6 +704,30 @@ If::If(Expression *expr, Statement *thenStmt, Statement *elseStmt)
  */
 
 Function::Function(const Symbol *id, Block *body)
-    : _id(id), _body(body)
+    : Node(Kind::Function), _id(id), _body(body)
+{
+}
+
+
+/*
+ * Function:	Function::id (accessor)
+ *
+ * Description:	Return the symbol of this function.
+ */
+
+const Symbol *Function::id() const
+{
+    return _id;
+}
+
+
+/*
+ * Function:	Function::body (accessor)
+ *
+ * Description:	Return the body of this function.
+ */
+
+Block *Function::body() const
 {
+    return _body;
 }
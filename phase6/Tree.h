@@ -5,8 +5,10 @@
  *		syntax trees in Simple C.
  *
  *		The base class Node cannot not be instantiated (the
- *		constructor is private).  It provides empty functions for
- *		storage allocation and code generation.
+ *		constructor is private).  Each node is tagged with its
+ *		kind, and passes over a tree are written as visitors that
+ *		dispatch on the kind (see visitor.h) rather than as virtual
+ *		functions on every class.
  *
  *		A Node is either a Function, representing a function
  *		definition, or a Statement, which also cannot be
@@ -19,8 +21,13 @@
  *
  *		Tree.h - class definitions
  *		Tree.cpp - constructors and accessors
- *		allocator.cpp - member functions to do storage allocation
- *		generator.cpp - member functions to do code generation
+ *		visitor.h - dispatch on the kind of a node
+ *		flat.cpp - flattening a tree
+ *		allocator.cpp - storage allocation on a flat tree
+ *		generator.cpp - code generation on a flat tree
+ *
+ *		Nodes are allocated in arenas, and the tree of a function
+ *		is freed all at once after it has been generated.
  */
 
 # ifndef TREE_H
@@ -28,22 +35,39 @@
 # include <string>
 # include <vector>
 # include "Scope.h"
+# include "arena.h"
+# include "lexer.h"
 
 typedef std::vector<class Statement *> Statements;
 typedef std::vector<class Expression *> Expressions;
 
 
-/* The base class */
+/* The kinds of nodes, which tell them apart in a tree and in its flat
+   form. */
+
+enum class Kind : unsigned char {
+    Function, Block, While, If, Return, Assignment,
+    String, Character, Identifier, Number, Call, Field,
+    Not, Negate, Dereference, Address, Cast,
+    Multiply, Divide, Remainder, Add, Subtract,
+    LessThan, GreaterThan, LessOrEqual, GreaterOrEqual, Equal, NotEqual,
+    LogicalAnd, LogicalOr,
+};
+
+
+/* The base class.  The kind of a node is all that a pass needs to find
+   its class, so its accessor is inline.  The destructor is still virtual,
+   so that an arena can destroy any node. */
 
-class Node {
+class Node : public Allocated<Node> {
 protected:
     typedef std::string string;
-    Node() {}
+    Kind _kind;
+    Node(Kind kind) : _kind(kind) {}
 
 public:
     virtual ~Node() {}
-    virtual void allocate(int &offset) const {}
-    virtual void generate() {}
+    Kind kind() const { return _kind; }
 };
 
 
@@ -51,7 +75,7 @@ public:
 
 class Statement : public Node {
 protected:
-    Statement() {}
+    Statement(Kind kind) : Node(kind) {}
 };
 
 
@@ -61,38 +85,58 @@ class Expression : public Statement {
 protected:
     Type _type;
     bool _lvalue;
-    Expression(const Type &_type = Type());
+    Expression(Kind kind, const Type &_type = Type());
 
 public:
-    string _operand;
     const Type &type() const;
     bool lvalue() const;
-	virtual void generate();
-	virtual void generate(bool &indirect);
+};
+
+
+/* A unary expression, which has a single operand */
+
+class Unary : public Expression {
+protected:
+    Expression *_expr;
+    Unary(Kind kind, Expression *expr, const Type &type);
+
+public:
+    Expression *expr() const;
+};
+
+
+/* A binary expression, which has a left and a right operand */
+
+class Binary : public Expression {
+protected:
+    Expression *_left, *_right;
+    Binary(Kind kind, Expression *left, Expression *right, const Type &type);
+
+public:
+    Expression *left() const;
+    Expression *right() const;
 };
 
 
 /* A string literal */
 
 class String : public Expression {
-    string _value;
+    Name _value;
 
 public:
-    String(const string &value);
-    const string &value() const;
-	virtual void generate();
+    String(Name value);
+    Name value() const;
 };
 
 
 /* A character literal */
 
 class Character : public Expression {
-    string _value;
+    int _value;
 
 public:
-    Character(const string &value);
-    const string &value() const;
-	virtual void generate();
+    Character(int value);
+    int value() const;
 };
 
 
@@ -104,20 +148,17 @@ class Identifier : public Expression {
 public:
     Identifier(const Symbol *symbol);
     const Symbol *symbol() const;
-    virtual void generate();
 };
 
 
 /* A number (i.e., integer literal) */
 
 class Number : public Expression {
-    string _value;
+    unsigned _value;
 
 public:
-    Number(const string &value);
     Number(unsigned value);
-    const string &value() const;
-    virtual void generate();
+    unsigned value() const;
 };
 
 
@@ -129,7 +170,8 @@ class Call : public Expression {
 
 public:
     Call(const Symbol *id, const Expressions &args, const Type &type);
-    virtual void generate();
+    const Symbol *id() const;
+    const Expressions &args() const;
 };
 
 
@@ -143,205 +185,152 @@ public:
 //	virtual void generate();
 //	virtual void generate(bool &indirect);
     Field(Expression *expr, Identifier *id, const Type &type);
+    Expression *expr() const;
+    Identifier *id() const;
 };
 
 
 /* A logical negation expression: ! expr */
 
-class Not : public Expression {
-    Expression *_expr;
-
+class Not : public Unary {
 public:
     Not(Expression *expr, const Type &type);
-	virtual void generate();
 };
 
 
 /* An arithmetic negation expression: - expr */
 
-class Negate : public Expression {
-    Expression *_expr;
-
+class Negate : public Unary {
 public:
     Negate(Expression *expr, const Type &type);
-	virtual void generate();
 };
 
 
 /* A dereference expression: * expr */
 
-class Dereference : public Expression {
-    Expression *_expr;
-
+class Dereference : public Unary {
 public:
     Dereference(Expression *expr, const Type &type);
-	virtual void generate(bool &indirect);
-	virtual void generate();
 };
 
 
 /* An address expression: & expr */
 
-class Address : public Expression {
-    Expression *_expr;
-
+class Address : public Unary {
 public:
     Address(Expression *expr, const Type &type);
-	virtual void generate();
 };
 
 
 /* A cast expression: (type) expr */
 
-class Cast : public Expression {
-    Expression *_expr;
-
+class Cast : public Unary {
 public:
     Cast(const Type &type, Expression *expr);
-	virtual void generate();
 };
 
 
 /* A multiply expression: left * right */
 
-class Multiply : public Expression {
-    Expression *_left, *_right;
-
+class Multiply : public Binary {
 public:
     Multiply(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* A divide expression: left / right */
 
-class Divide : public Expression {
-    Expression *_left, *_right;
-
+class Divide : public Binary {
 public:
     Divide(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* A remainder expression: left % right */
 
-class Remainder : public Expression {
-    Expression *_left, *_right;
-
+class Remainder : public Binary {
 public:
     Remainder(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* An addition expression: left + right */
 
-class Add : public Expression {
-    Expression *_left, *_right;
-
+class Add : public Binary {
 public:
     Add(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* A subtraction expression: left - right */
 
-class Subtract : public Expression {
-    Expression *_left, *_right;
-
+class Subtract : public Binary {
 public:
     Subtract(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* A less-than expression: left < right */
 
-class LessThan : public Expression {
-    Expression *_left, *_right;
-
+class LessThan : public Binary {
 public:
     LessThan(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* A greater-than expression: left > right */
 
-class GreaterThan : public Expression {
-    Expression *_left, *_right;
-
+class GreaterThan : public Binary {
 public:
-	virtual void generate();
     GreaterThan(Expression *left, Expression *right, const Type &type);
 };
 
 
 /* A less-than-or-equal expression: left <= right */
 
-class LessOrEqual : public Expression {
-    Expression *_left, *_right;
-
+class LessOrEqual : public Binary {
 public:
     LessOrEqual(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* A greater-than-or-equal expression: left >= right */
 
-class GreaterOrEqual : public Expression {
-    Expression *_left, *_right;
-
+class GreaterOrEqual : public Binary {
 public:
     GreaterOrEqual(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* An equality expression: left == right */
 
-class Equal : public Expression {
-    Expression *_left, *_right;
-
+class Equal : public Binary {
 public:
     Equal(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* An inequality expression: left != right */
 
-class NotEqual : public Expression {
-    Expression *_left, *_right;
-
+class NotEqual : public Binary {
 public:
     NotEqual(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* A logical-and expression: left && right */
 
-class LogicalAnd: public Expression {
-    Expression *_left, *_right;
-
+class LogicalAnd : public Binary {
 public:
     LogicalAnd(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
 /* A logical-or expression: left || right */
 
-class LogicalOr : public Expression {
-    Expression *_left, *_right;
-
+class LogicalOr : public Binary {
 public:
     LogicalOr(Expression *left, Expression *right, const Type &type);
-	virtual void generate();
 };
 
 
@@ -352,7 +341,8 @@ class Assignment : public Statement {
 
 public:
     Assignment(Expression *left, Expression *right);
-    virtual void generate();
+    Expression *left() const;
+    Expression *right() const;
 };
 
 
@@ -363,7 +353,7 @@ class Return : public Statement {
 
 public:
     Return(Expression *expr);
-	virtual void generate();
+    Expression *expr() const;
 };
 
 
@@ -376,8 +366,7 @@ class Block : public Statement {
 public:
     Block(Scope *decls, const Statements &stmts);
     Scope *declarations() const;
-    virtual void allocate(int &offset) const;
-    virtual void generate();
+    const Statements &statements() const;
 };
 
 
@@ -389,8 +378,8 @@ class While : public Statement {
 
 public:
     While(Expression *expr, Statement *stmt);
-    virtual void allocate(int &offset) const;
-	virtual void generate();
+    Expression *expr() const;
+    Statement *statement() const;
 };
 
 
@@ -402,8 +391,9 @@ class If : public Statement {
 
 public:
     If(Expression *expr, Statement *thenStmt, Statement *elseStmt);
-    virtual void allocate(int &offset) const;
-	virtual void generate();
+    Expression *expr() const;
+    Statement *thenStatement() const;
+    Statement *elseStatement() const;
 };
 
 
@@ -415,8 +405,9 @@ class Function : public Node {
 
 public:
     Function(const Symbol *id, Block *body);
-    virtual void allocate(int &offset) const;
-    virtual void generate();
+    const Symbol *id() const;
+    Block *body() const;
+    void generate();
 };
 
 # endif /* TREE_H */
@@ -17,15 +17,238 @@
  *		- predicate functions such as isArray()
  *		- stream operator
  *		- the error type
+ *		- interning types
  */
 
+# include <atomic>
 # include <cassert>
+# include <cstdint>
+# include <mutex>
 # include "tokens.h"
 # include "Type.h"
 
-using std::string;
+using std::atomic;
+using std::lock_guard;
+using std::mutex;
 using std::ostream;
 
+const Name Type::_int = intern("int");
+const Name Type::_char = intern("char");
+
+
+/* The entry of a type holds the type itself, its hash value, and the
+   results of promoting and dereferencing it, along with what the
+   predicates need that would otherwise take comparing names.  Entries are
+   never freed or changed once they are in the table. */
+
+struct Type::Entry {
+    enum { ARRAY, ERROR, FUNCTION, SCALAR } kind;
+    Name specifier;
+    unsigned indirection;
+    unsigned long length;
+    Parameters *parameters;
+
+    unsigned hash;
+    bool integer, structure;
+    const Entry *promoted, *dereferenced;
+
+    unsigned hashKey() const;
+    bool sameKey(const Entry &that) const;
+
+    struct Table {
+	unsigned mask, count;
+	atomic<const Entry *> *slots;
+    };
+
+    static atomic<Table *> table;
+    static mutex lock;
+
+    static const Entry *find(const Entry &key);
+    static const Entry *create(const Entry &key);
+};
+
+
+/* The table is an open-addressing hash table with linear probing, like the
+   string table, kept at most half full.  It is probed without a lock, so
+   a type that is already there costs only the probe.  A type that isn't
+   is added under the lock, after probing again.  When the table grows, the
+   old one is kept, since another thread may still be probing it, and at
+   worst misses an entry and takes the lock.  Together, the old tables are
+   no larger than the current one.  The table and its lock are initialized
+   before any constructor runs, since types are made by the constructors
+   of static objects in other files. */
+
+atomic<Type::Entry::Table *> Type::Entry::table;
+mutex Type::Entry::lock;
+
+
+/*
+ * Function:	Type::Entry::hashKey
+ *
+ * Description:	Return the hash of the type in this entry.  Names and the
+ *		types of the parameters are both interned, so it is their
+ *		addresses that are hashed.
+ */
+
+unsigned Type::Entry::hashKey() const
+{
+    unsigned long long h;
+
+
+    h = (uintptr_t) specifier;
+    h = (h ^ (kind << 8 | indirection)) * 0x9e3779b97f4a7c15ull;
+    h = (h ^ length) * 0x9e3779b97f4a7c15ull;
+
+    if (parameters != nullptr)
+	for (unsigned i = 0; i < parameters->size(); i ++)
+	    h = (h ^ (uintptr_t) (*parameters)[i]._entry) * 0x9e3779b97f4a7c15ull;
+
+    return h >> 32;
+}
+
+
+/*
+ * Function:	Type::Entry::sameKey
+ *
+ * Description:	Return whether the type in this entry is identical to the
+ *		type in the given one, comparing the types of parameters
+ *		by their entries.  An unspecified parameter list is only
+ *		identical to another unspecified one.
+ */
+
+bool Type::Entry::sameKey(const Entry &that) const
+{
+    if (kind != that.kind || specifier != that.specifier)
+	return false;
+
+    if (indirection != that.indirection || length != that.length)
+	return false;
+
+    if (parameters == nullptr || that.parameters == nullptr)
+	return parameters == that.parameters;
+
+    if (parameters->size() != that.parameters->size())
+	return false;
+
+    for (unsigned i = 0; i < parameters->size(); i ++)
+	if ((*parameters)[i]._entry != (*that.parameters)[i]._entry)
+	    return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	Type::Entry::find
+ *
+ * Description:	Return the entry for the type in the given key, adding it
+ *		to the table if it isn't there already.
+ */
+
+const Type::Entry *Type::Entry::find(const Entry &key)
+{
+    const Table *current;
+    const Entry *entry;
+    unsigned h, i;
+
+
+    h = key.hashKey();
+    current = table.load();
+
+    if (current != nullptr)
+	for (i = h & current->mask; (entry = current->slots[i].load()) != nullptr;
+		i = (i + 1) & current->mask)
+	    if (entry->hash == h && entry->sameKey(key))
+		return entry;
+
+    lock_guard<mutex> guard(lock);
+    return create(key);
+}
+
+
+/*
+ * Function:	Type::Entry::create
+ *
+ * Description:	Return the entry for the type in the given key, adding it
+ *		to the table if it isn't there already, with the lock held.
+ *		The types it promotes and dereferences to are added first,
+ *		and the table is grown by doubling it.
+ */
+
+const Type::Entry *Type::Entry::create(const Entry &key)
+{
+    Table *current, *old;
+    unsigned h, i, j;
+    const Entry *e;
+    Entry *entry;
+    Name name;
+
+
+    h = key.hashKey();
+    current = table.load();
+
+    if (current != nullptr)
+	for (i = h & current->mask; (e = current->slots[i].load()) != nullptr;
+		i = (i + 1) & current->mask)
+	    if (e->hash == h && e->sameKey(key))
+		return e;
+
+    entry = new Entry(key);
+    entry->hash = h;
+    entry->promoted = entry;
+    entry->dereferenced = nullptr;
+
+    name = key.specifier;
+    entry->integer = key.kind == SCALAR && key.indirection == 0 &&
+	(name == intern("int") || name == intern("char"));
+    entry->structure = key.kind != ERROR && name != intern("int") &&
+	name != intern("char");
+
+    if (key.kind == SCALAR && key.indirection > 0) {
+	Entry pointee = {SCALAR, name, key.indirection - 1, 0, nullptr};
+	entry->dereferenced = create(pointee);
+
+    } else if (key.kind == SCALAR && name == intern("char")) {
+	Entry promoted = {SCALAR, intern("int"), 0, 0, nullptr};
+	entry->promoted = create(promoted);
+    }
+
+    if (key.kind == ARRAY) {
+	Entry pointer = {SCALAR, name, key.indirection + 1, 0, nullptr};
+	entry->promoted = create(pointer);
+    }
+
+    current = table.load();
+
+    if (current == nullptr || (current->count + 1) * 2 > current->mask + 1) {
+	old = current;
+	current = new Table;
+	current->mask = old != nullptr ? old->mask * 2 + 1 : 255;
+	current->count = 0;
+	current->slots = new atomic<const Entry *>[current->mask + 1]();
+
+	for (j = 0; old != nullptr && j <= old->mask; j ++)
+	    if ((e = old->slots[j].load()) != nullptr) {
+		for (i = e->hash & current->mask; current->slots[i].load();
+			i = (i + 1) & current->mask)
+		    continue;
+
+		current->slots[i].store(e);
+		current->count ++;
+	    }
+
+	table.store(current);
+    }
+
+    for (i = h & current->mask; current->slots[i].load();
+	    i = (i + 1) & current->mask)
+	continue;
+
+    current->slots[i].store(entry);
+    current->count ++;
+    return entry;
+}
+
 
 /*
  * Function:	Type::Type (constructor)
@@ -34,8 +257,11 @@ using std::ostream;
  */
 
 Type::Type()
-    : _specifier("-error-"), _kind(ERROR)
 {
+    static const Entry key = {Entry::ERROR, intern("-error-"), 0, 0, nullptr};
+    static const Entry *error = Entry::find(key);
+
+    _entry = error;
 }
 
 
@@ -45,9 +271,10 @@ Type::Type()
  * Description:	Initialize this type object as a scalar type.
  */
 
-Type::Type(const string &specifier, unsigned indirection)
-    : _specifier(specifier), _indirection(indirection), _kind(SCALAR)
+Type::Type(Name specifier, unsigned indirection)
 {
+    Entry key = {Entry::SCALAR, specifier, indirection, 0, nullptr};
+    _entry = Entry::find(key);
 }
 
 
@@ -57,58 +284,64 @@ Type::Type(const string &specifier, unsigned indirection)
  * Description:	Initialize this type object as an array type.
  */
 
-Type::Type(const string &specifier, unsigned indirection, unsigned long length)
-    : _specifier(specifier), _indirection(indirection), _length(length)
+Type::Type(Name specifier, unsigned indirection, unsigned long length)
 {
-    _kind = ARRAY;
+    Entry key = {Entry::ARRAY, specifier, indirection, length, nullptr};
+    _entry = Entry::find(key);
 }
 
 
 /*
  * Function:	Type::Type (constructor)
  *
- * Description:	Initialize this type object as a function type.
+ * Description:	Initialize this type object as a function type.  The
+ *		parameter list becomes part of the type if the type is new,
+ *		so it must be in the permanent arena, and must not change.
+ */
+
+Type::Type(Name specifier, unsigned indirection, Parameters *parameters)
+{
+    Entry key = {Entry::FUNCTION, specifier, indirection, 0, parameters};
+    _entry = Entry::find(key);
+}
+
+
+/*
+ * Function:	Type::Type (private constructor)
+ *
+ * Description:	Initialize this type object with the given entry.
  */
 
-Type::Type(const string &specifier, unsigned indirection, Parameters *parameters)
-    : _specifier(specifier), _indirection(indirection), _parameters(parameters)
+Type::Type(const Entry *entry)
+    : _entry(entry)
 {
-    _kind = FUNCTION;
 }
 
 
 /*
  * Function:	Type::operator ==
  *
- * Description:	Return whether another type is equal to this type.  The
- *		parameter lists are checked for function types, which C++
- *		makes so easy.  (At least, it makes something easy!)
+ * Description:	Return whether another type is equal to this type.  Since
+ *		types are interned, only function types with different
+ *		entries can be equal, if either has an unspecified
+ *		parameter list.
  */
 
 bool Type::operator ==(const Type &rhs) const
 {
-    if (_kind != rhs._kind)
-	return false;
-
-    if (_kind == ERROR)
+    if (_entry == rhs._entry)
 	return true;
 
-    if (_specifier != rhs._specifier)
+    if (_entry->kind != Entry::FUNCTION || rhs._entry->kind != Entry::FUNCTION)
 	return false;
 
-    if (_indirection != rhs._indirection)
+    if (_entry->parameters != nullptr && rhs._entry->parameters != nullptr)
 	return false;
 
-    if (_kind == SCALAR)
-	return true;
-
-    if (_kind == ARRAY)
-	return _length == rhs._length;
-
-    if (!_parameters || !rhs._parameters)
-	return true;
+    if (_entry->specifier != rhs._entry->specifier)
+	return false;
 
-    return *_parameters == *rhs._parameters;
+    return _entry->indirection == rhs._entry->indirection;
 }
 
 
@@ -134,7 +367,7 @@ bool Type::operator !=(const Type &rhs) const
 
 bool Type::isArray() const
 {
-    return _kind == ARRAY;
+    return _entry->kind == Entry::ARRAY;
 }
 
 
@@ -146,7 +379,7 @@ bool Type::isArray() const
 
 bool Type::isScalar() const
 {
-    return _kind == SCALAR;
+    return _entry->kind == Entry::SCALAR;
 }
 
 
@@ -158,7 +391,7 @@ bool Type::isScalar() const
 
 bool Type::isFunction() const
 {
-    return _kind == FUNCTION;
+    return _entry->kind == Entry::FUNCTION;
 }
 
 
@@ -170,7 +403,7 @@ bool Type::isFunction() const
 
 bool Type::isStruct() const
 {
-    return _kind != ERROR && _specifier != "int" && _specifier != "char";
+    return _entry->structure;
 }
 
 
@@ -182,7 +415,7 @@ bool Type::isStruct() const
 
 bool Type::isError() const
 {
-    return _kind == ERROR;
+    return _entry->kind == Entry::ERROR;
 }
 
 
@@ -192,9 +425,9 @@ bool Type::isError() const
  * Description:	Return the specifier of this type.
  */
 
-const string &Type::specifier() const
+Name Type::specifier() const
 {
-    return _specifier;
+    return _entry->specifier;
 }
 
 
@@ -206,7 +439,7 @@ const string &Type::specifier() const
 
 unsigned Type::indirection() const
 {
-    return _indirection;
+    return _entry->indirection;
 }
 
 
@@ -220,8 +453,8 @@ unsigned Type::indirection() const
 
 unsigned long Type::length() const
 {
-    assert(_kind == ARRAY);
-    return _length;
+    assert(_entry->kind == Entry::ARRAY);
+    return _entry->length;
 }
 
 
@@ -234,8 +467,8 @@ unsigned long Type::length() const
 
 Parameters *Type::parameters() const
 {
-    assert(_kind == FUNCTION);
-    return _parameters;
+    assert(_entry->kind == Entry::FUNCTION);
+    return _entry->parameters;
 }
 
 
@@ -259,10 +492,7 @@ bool Type::isSimple() const
 
 bool Type::isInteger() const
 {
-    if (_kind != SCALAR || _indirection > 0)
-	return false;
-
-    return _specifier == "int" || _specifier == "char";
+    return _entry->integer;
 }
 
 
@@ -274,7 +504,10 @@ bool Type::isInteger() const
 
 bool Type::isPointer() const
 {
-    return (_kind == SCALAR && _indirection > 0) || _kind == ARRAY;
+    if (_entry->kind == Entry::SCALAR)
+	return _entry->indirection > 0;
+
+    return _entry->kind == Entry::ARRAY;
 }
 
 
@@ -288,9 +521,9 @@ bool Type::isPointer() const
 
 bool Type::isCompatibleWith(const Type &that) const
 {
-    Type t = that.promote();
+    const Entry *t = that._entry->promoted;
 
-    return t.isSimple() && t == promote();
+    return Type(t).isSimple() && t == _entry->promoted;
 }
 
 
@@ -304,13 +537,7 @@ bool Type::isCompatibleWith(const Type &that) const
 
 Type Type::promote() const
 {
-    if (_kind == SCALAR && _indirection == 0 && _specifier == "char")
-	return Type("int", 0);
-
-    if (_kind == ARRAY)
-	return Type(_specifier, _indirection + 1);
-
-    return *this;
+    return Type(_entry->promoted);
 }
 
 
@@ -323,8 +550,8 @@ Type Type::promote() const
 
 Type Type::deref() const
 {
-    assert(_kind == SCALAR && _indirection > 0);
-    return Type(_specifier, _indirection - 1);
+    assert(_entry->dereferenced != nullptr);
+    return Type(_entry->dereferenced);
 }
 
 
@@ -337,7 +564,7 @@ Type Type::deref() const
 
 ostream &operator <<(ostream &ostr, const Type &type)
 {
-    ostr << type.specifier();
+    ostr << *type.specifier();
 
     if (type.indirection() > 0) {
 	ostr << " ";
@@ -9,17 +9,27 @@
  *		An error type is also supported for use in undeclared
  *		identifiers and the results of type checking.
  *
+ *		The specifier is an interned name, so comparing specifiers
+ *		is just comparing pointers.
+ *
  *		By convention, a null parameter list represents an
  *		unspecified parameter list.  An empty parameter list is
  *		represented by an empty vector.
  *
- *		No subclassing is used to avoid the problem of object
- *		slicing (since we'll be treating types as value types) and
- *		the proliferation of small member functions.
+ *		Types are interned, like names: each distinct type is kept
+ *		exactly once, in a table shared by all threads, and a type
+ *		is simply a handle to its entry.  Types are still value
+ *		types, but copying one copies a pointer, and two types are
+ *		equal exactly when their handles are, except that a
+ *		function type with an unspecified parameter list is equal
+ *		to any function type of the same specifier and indirection.
+ *		The result of promoting or dereferencing a type is linked
+ *		from its entry when the entry is made, so neither has to
+ *		search the table.
  *
- *		As we've designed them, types are essentially immutable,
- *		since we haven't included any mutators.  In practice, we'll
- *		be creating new types rather than changing existing types.
+ *		As we've designed them, types are immutable, since we
+ *		haven't included any mutators.  In practice, we'll be
+ *		creating new types rather than changing existing types.
  */
 
 # ifndef TYPE_H
@@ -27,24 +37,23 @@
 # include <string>
 # include <vector>
 # include <ostream>
+# include "intern.h"
 
 typedef std::vector<class Type> Parameters;
 
 class Type {
-    typedef std::string string;
+    static const Name _int, _char;
 
-    string _specifier;
-    unsigned _indirection;
-    unsigned _length;
-    Parameters *_parameters;
+    struct Entry;
+    const Entry *_entry;
 
-    enum { ARRAY, ERROR, FUNCTION, SCALAR } _kind;
+    Type(const Entry *entry);
 
 public:
     Type();
-    Type(const string &specifier, unsigned indirection = 0);
-    Type(const string &specifier, unsigned indirection, unsigned long length);
-    Type(const string &specifier, unsigned indirection, Parameters *parameters);
+    Type(Name specifier, unsigned indirection = 0);
+    Type(Name specifier, unsigned indirection, unsigned long length);
+    Type(Name specifier, unsigned indirection, Parameters *parameters);
 
     bool operator ==(const Type &rhs) const;
     bool operator !=(const Type &rhs) const;
@@ -55,7 +64,7 @@ public:
     bool isStruct() const;
     bool isError() const;
 
-    const string &specifier() const;
+    Name specifier() const;
     unsigned indirection() const;
     unsigned long length() const;
     Parameters *parameters() const;
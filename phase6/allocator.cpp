@@ -1,13 +1,13 @@
 /*
  * File:	allocator.cpp
  *
- * Description:	This file contains the member function definitions for
- *		functions dealing with storage allocation.  The actual
- *		classes are declared elsewhere, mainly in Tree.h.
+ * Description:	This file contains the public and member function
+ *		definitions for storage allocation, which is done on the
+ *		flat form of a tree.  The actual classes are declared
+ *		elsewhere, mainly in Tree.h and flat.h.
  *
  *		Extra functionality:
  *		- computing the alignment of types
- *		- computing the size of a structure type
  *		- maintaining minimum offset in nested blocks
  *		- allocation within while and if-then-else statements
  */
@@ -17,7 +17,8 @@
 # include "checker.h"
 # include "machine.h"
 # include "tokens.h"
-# include "Tree.h"
+# include "flat.h"
+# include "visitor.h"
 
 using namespace std;
 
@@ -25,50 +26,28 @@ using namespace std;
 /*
  * Function:	Type::size
  *
- * Description:	Return the size of a type in bytes.
+ * Description:	Return the size of a type in bytes.  The size of a
+ *		structure was computed when it was defined.
  */
 
 unsigned Type::size() const
 {
-    Symbols symbols;
-    unsigned count, size, align;
+    unsigned count;
 
 
-    assert(_kind != FUNCTION && _kind != ERROR);
-    count = (_kind == ARRAY ? _length : 1);
+    assert(!isFunction() && !isError());
+    count = (isArray() ? length() : 1);
 
-    if (_indirection > 0)
+    if (indirection() > 0)
 	return count * SIZEOF_PTR;
 
-    if (_specifier == "int")
+    if (specifier() == _int)
 	return count * SIZEOF_INT;
 
-    if (_specifier == "char")
+    if (specifier() == _char)
 	return count * SIZEOF_CHAR;
 
-
-    /* The size of a structure is the size of all of its fields, but with
-       each field aligned and the entire structure aligned as well. */
-
-    size = 0;
-    symbols = getFields(_specifier);
-
-    for (unsigned i = 0; i < symbols.size(); i ++) {
-	align = symbols[i]->type().alignment();
-
-	if (size % align != 0)
-	    size += (align - size % align);
-
-	symbols[i]->_offset = size;
-	size += symbols[i]->type().size();
-    }
-
-    align = alignment();
-
-    if (size % align != 0)
-	size += (align - size % align);
-
-    return count * size;
+    return count * getLayout(specifier()).size;
 }
 
 
@@ -80,124 +59,131 @@ unsigned Type::size() const
 
 unsigned Type::alignment() const
 {
-    Symbols symbols;
-    unsigned align;
+    assert(!isFunction() && !isError());
 
-
-    assert(_kind != FUNCTION && _kind != ERROR);
-
-    if (_indirection > 0)
+    if (indirection() > 0)
 	return ALIGNOF_PTR;
 
-    if (_specifier == "char")
+    if (specifier() == _char)
 	return ALIGNOF_CHAR;
 
-    if (_specifier == "int")
+    if (specifier() == _int)
 	return ALIGNOF_INT;
 
+    return getLayout(specifier()).alignment;
+}
 
-    /* The alignment of a structure is the maximum alignment of its fields. */
 
-    align = 0;
-    symbols = getFields(_specifier);
+/* Storage allocation is a visitor of the flat tree.  Its member for each
+   kind of statement takes the next step in allocating storage for it, and
+   returns the nested statement to allocate next, if any.  Each nested
+   statement starts where the symbols of its enclosing statement end, given
+   by start, so the else part of an if statement starts where its then part
+   starts.  Other kinds of nodes have nothing to allocate. */
 
-    for (unsigned i = 0; i < symbols.size(); i ++)
-	if (symbols[i]->type().alignment() > align)
-	    align = symbols[i]->type().alignment();
+struct Allocator {
+    const FlatTree &tree;
 
-    return align;
-}
+    template <Kind K>
+    unsigned visit(unsigned node, unsigned step, int &offset, int &start) {
+	return NO_NODE;
+    }
+};
 
 
 /*
- * Function:	Block::allocate
+ * Function:	Allocator::visit<Kind::Block>
  *
- * Description:	Allocate storage for this block.  We assign decreasing
- *		offsets for all symbols declared within this block, and
- *		then for all symbols declared within any nested block.
- *		Only symbols that have not already been allocated an
- *		offset will be assigned one, since the parameters are
- *		already assigned special offsets.
+ * Description:	A block assigns decreasing offsets for all symbols
+ *		declared within it, and then for all symbols declared
+ *		within any nested block.  Only symbols that have not
+ *		already been allocated an offset are assigned one, since
+ *		the parameters are already assigned special offsets.
  */
 
-void Block::allocate(int &offset) const
+template <>
+unsigned Allocator::visit<Kind::Block>(unsigned node, unsigned step,
+	int &offset, int &start)
 {
-    int temp, saved;
-    unsigned i;
     Symbols symbols;
 
 
-    symbols = _decls->symbols();
-
-    for (i = 0; i < symbols.size(); i ++)
-	if (symbols[i]->_offset == 0) {
-	    offset -= symbols[i]->type().size();
-	    symbols[i]->_offset = offset;
-	}
+    if (step == 0) {
+	symbols = tree.scopes[tree.operands[node]]->symbols();
 
-    saved = offset;
+	for (unsigned i = 0; i < symbols.size(); i ++)
+	    if (symbols[i]->_offset == 0) {
+		offset -= symbols[i]->type().size();
+		symbols[i]->_offset = offset;
+	    }
 
-    for (i = 0; i < _stmts.size(); i ++) {
-	temp = saved;
-	_stmts[i]->allocate(temp);
-	offset = min(offset, temp);
+	start = offset;
     }
+
+    return step < tree.counts[node] ? tree.firsts[node] + step : NO_NODE;
 }
 
 
 /*
- * Function:	While::allocate
+ * Function:	Allocator::visit<Kind::While>
  *
- * Description:	Allocate storage for this while statement, which
- *		essentially means allocating storage for variables declared
- *		as part of its statement.
+ * Description:	The statement of a while statement is nested in it.
  */
 
-void While::allocate(int &offset) const
+template <>
+unsigned Allocator::visit<Kind::While>(unsigned node, unsigned step,
+	int &offset, int &start)
 {
-    _stmt->allocate(offset);
+    start = offset;
+    return step == 0 ? tree.firsts[node] + 1 : NO_NODE;
 }
 
 
 /*
- * Function:	If::allocate
+ * Function:	Allocator::visit<Kind::If>
  *
- * Description:	Allocate storage for this if-then or if-then-else
- *		statement, which essentially means allocating storage for
- *		variables declared as part of its statements.
+ * Description:	The then and else parts of an if statement are nested in
+ *		it.
  */
 
-void If::allocate(int &offset) const
+template <>
+unsigned Allocator::visit<Kind::If>(unsigned node, unsigned step,
+	int &offset, int &start)
 {
-    int temp;
-
+    start = offset;
 
-    _thenStmt->allocate(offset);
+    if (step + 1 < tree.counts[node])
+	return tree.firsts[node] + step + 1;
 
-    if (_elseStmt != nullptr) {
-	temp = offset;
-	_elseStmt->allocate(temp);
-	offset = min(offset, temp);
-    }
+    return NO_NODE;
 }
 
 
 /*
- * Function:	Function::allocate
+ * Function:	allocate
  *
- * Description:	Allocate storage for this function and return the number of
- *		bytes required.  The parameters are allocated offsets as
- *		well.
+ * Description:	Allocate storage for the function in the given flat tree
+ *		and return the number of bytes required.  The parameters
+ *		are allocated offsets as well.  The statements are walked
+ *		with an explicit stack: each nested statement starts at
+ *		the offset given by the statement enclosing it, and once
+ *		done, the enclosing statement's offset becomes the lower of
+ *		the two.
  */
 
-void Function::allocate(int &offset) const
+void allocate(const FlatTree &tree, int &offset)
 {
+    static vector<unsigned> nodes, steps;
+    static vector<int> offsets, starts;
+    Allocator allocator = {tree};
+    unsigned node, body;
     Parameters *params;
     Symbols symbols;
 
 
-    params = _id->type().parameters();
-    symbols = _body->declarations()->symbols();
+    body = tree.firsts[0];
+    params = tree.symbols[tree.operands[0]]->type().parameters();
+    symbols = tree.scopes[tree.operands[body]]->symbols();
     offset = PARAM_OFFSET;
 
     for (unsigned i = 0; i < params->size(); i ++) {
@@ -205,6 +191,32 @@ void Function::allocate(int &offset) const
 	offset += SIZEOF_ARG;
     }
 
-    offset = 0;
-    _body->allocate(offset);
+    nodes.assign(1, body);
+    steps.assign(1, 0);
+    offsets.assign(1, 0);
+    starts.assign(1, 0);
+
+    while (true) {
+	node = dispatch(tree.kinds[nodes.back()], allocator, nodes.back(),
+			steps.back() ++, offsets.back(), starts.back());
+
+	if (node != NO_NODE) {
+	    nodes.push_back(node);
+	    steps.push_back(0);
+	    offsets.push_back(starts.back());
+	    starts.push_back(0);
+
+	} else {
+	    offset = offsets.back();
+	    nodes.pop_back();
+	    steps.pop_back();
+	    offsets.pop_back();
+	    starts.pop_back();
+
+	    if (nodes.empty())
+		break;
+
+	    offsets.back() = min(offsets.back(), offset);
+	}
+    }
 }
@@ -0,0 +1,136 @@
+/*
+ * File:	arena.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		memory arenas in Simple C.
+ *
+ *		The first chunk of an arena is small, so that an arena that
+ *		holds a small function costs little, and each new chunk is
+ *		twice the size of the last, up to a limit.  An object too
+ *		large for any chunk gets a chunk of its own.
+ */
+
+# include <algorithm>
+# include "arena.h"
+
+# define FIRST_CHUNK	4096
+# define LAST_CHUNK	(1 << 20)
+# define ALIGNMENT	alignof(std::max_align_t)
+
+using namespace std;
+
+Arena permanent;
+__thread Arena *arena = &permanent;
+
+
+/*
+ * Function:	Arena::Arena (constructor)
+ *
+ * Description:	Initialize this arena object.  No memory is allocated
+ *		until it is needed.
+ */
+
+Arena::Arena()
+    : _used(0), _next(nullptr), _limit(nullptr)
+{
+}
+
+
+/*
+ * Function:	Arena::~Arena (destructor)
+ *
+ * Description:	Destroy the objects in this arena and free its memory.
+ */
+
+Arena::~Arena()
+{
+    reset();
+
+    for (unsigned i = 0; i < _chunks.size(); i ++)
+	delete[] _chunks[i].base;
+}
+
+
+/*
+ * Function:	Arena::grow
+ *
+ * Description:	Move on to the next chunk with room for an object of the
+ *		given size, allocating a new one if none is left.  A kept
+ *		chunk that is too small is passed over until the next
+ *		reset.
+ */
+
+void Arena::grow(size_t size)
+{
+    Chunk chunk;
+
+
+    while (_used < _chunks.size()) {
+	chunk = _chunks[_used ++];
+
+	if (chunk.size >= size) {
+	    _next = chunk.base;
+	    _limit = chunk.base + chunk.size;
+	    return;
+	}
+    }
+
+    if (_chunks.empty())
+	chunk.size = FIRST_CHUNK;
+    else
+	chunk.size = min(_chunks.back().size * 2, (size_t) LAST_CHUNK);
+
+    chunk.size = max(chunk.size, size);
+    chunk.base = new char[chunk.size];
+    _chunks.push_back(chunk);
+    _used = _chunks.size();
+
+    _next = chunk.base;
+    _limit = chunk.base + chunk.size;
+}
+
+
+/*
+ * Function:	Arena::allocate
+ *
+ * Description:	Return memory for an object of the given size.  If the
+ *		object has a destructor, it is run when the arena is
+ *		reset.
+ */
+
+void *Arena::allocate(size_t size, Destructor destroy)
+{
+    char *object;
+
+
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    if ((size_t) (_limit - _next) < size)
+	grow(size);
+
+    object = _next;
+    _next += size;
+
+    if (destroy != nullptr)
+	_cleanups.push_back({destroy, object});
+
+    return object;
+}
+
+
+/*
+ * Function:	Arena::reset
+ *
+ * Description:	Destroy the objects in this arena, last first, and make
+ *		all of its memory available again.
+ */
+
+void Arena::reset()
+{
+    for (unsigned i = _cleanups.size(); i > 0; i --)
+	_cleanups[i - 1].destroy(_cleanups[i - 1].object);
+
+    _cleanups.clear();
+    _used = 0;
+    _next = _limit = nullptr;
+}
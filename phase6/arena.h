@@ -0,0 +1,100 @@
+/*
+ * File:	arena.h
+ *
+ * Description:	This file contains the class definitions for memory arenas
+ *		in Simple C.  An arena hands out memory by bumping a pointer
+ *		through a list of chunks, and takes all of it back at once
+ *		when it is reset, first running the destructors of the
+ *		objects in it in the reverse order of their allocation.
+ *		Nothing in an arena is ever freed on its own.  The chunks
+ *		are kept across a reset, so an arena that is reused needs
+ *		only as much memory as its largest use.
+ *
+ *		The trees, scopes, and symbols of a function definition are
+ *		allocated in an arena that is reset once the function has
+ *		been generated, so the memory needed is bounded by the
+ *		largest function rather than by the whole file.  Anything
+ *		that outlives a function, such as a global symbol, the
+ *		fields of a structure, or the parameters of a function
+ *		type, is allocated in the permanent arena, which is never
+ *		reset.  Each thread allocates in its own current arena.
+ */
+
+# ifndef ARENA_H
+# define ARENA_H
+# include <cstddef>
+# include <type_traits>
+# include <vector>
+
+typedef void (*Destructor)(void *object);
+
+class Arena {
+    struct Chunk {
+	char *base;
+	std::size_t size;
+    };
+
+    struct Cleanup {
+	Destructor destroy;
+	void *object;
+    };
+
+    std::vector<Chunk> _chunks;
+    std::vector<Cleanup> _cleanups;
+    unsigned _used;
+    char *_next, *_limit;
+
+    void grow(std::size_t size);
+
+public:
+    Arena();
+    ~Arena();
+
+    void *allocate(std::size_t size, Destructor destroy = nullptr);
+    void reset();
+};
+
+extern Arena permanent;
+extern __thread Arena *arena;
+
+
+/* A class whose objects are allocated in the current arena, or in the
+   given one, and destroyed when that arena is reset.  They must never be
+   deleted. */
+
+template <class T>
+class Allocated {
+    static void destroy(void *object) {
+	static_cast<T *>(object)->~T();
+    }
+
+    static Destructor cleanup() {
+	return std::is_trivially_destructible<T>::value ? nullptr : destroy;
+    }
+
+public:
+    static void *operator new(std::size_t size) {
+	return arena->allocate(size, cleanup());
+    }
+
+    static void *operator new(std::size_t size, Arena &where) {
+	return where.allocate(size, cleanup());
+    }
+
+    static void operator delete(void *) {}
+    static void operator delete(void *, Arena &) {}
+};
+
+
+/* Any other object can be placed in an arena, but is never destroyed. */
+
+inline void *operator new(std::size_t size, Arena &where)
+{
+    return where.allocate(size);
+}
+
+inline void operator delete(void *, Arena &)
+{
+}
+
+# endif /* ARENA_H */
@@ -0,0 +1,664 @@
+/*
+ * File:	cache.cpp
+ *
+ * Description:	This file contains the public and private function and
+ *		variable definitions for the token cache for Simple C.
+ *
+ *		A cache file is named after a hash of the contents of the
+ *		source files, and consists of a header, the token stream,
+ *		and a table of the distinct lexemes.  Each token is stored
+ *		as a byte for its kind.  Keywords and operators always have
+ *		the same lexeme, which is kept in the header, but any other
+ *		token is followed by the index of its lexeme as a
+ *		variable-length number.  Changes in the line number are
+ *		stored as separate bytes between tokens, and only when the
+ *		line actually changes.  So is the lack of white space
+ *		before a token, which the preprocessor needs to know about.
+ *		Most tokens therefore take only one or two bytes, which is
+ *		less than their text in the source.
+ *
+ *		A cache file is only written if the whole token stream was
+ *		read without any lexical errors, since replaying the tokens
+ *		would not replay the error messages.  The standard input is
+ *		never cached, since it can't be hashed before it is read.
+ */
+
+# include <cerrno>
+# include <cstdio>
+# include <cstdlib>
+# include <cstdint>
+# include <cstring>
+# include <string>
+# include <vector>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "cache.h"
+# include "parlex.h"
+# include "watch.h"
+# include "tokens.h"
+
+# define CACHE_MAGIC	0x4b544353
+# define CACHE_VERSION	2
+# define BLOCK_SIZE	(1024 * 1024)
+
+# define LINES		192		/* first code for a change in line */
+# define GLUED		254		/* code for no white space before */
+# define RESET		255		/* code for an absolute line number */
+
+using namespace std;
+
+struct Header {
+    unsigned magic, version;
+    Hash hash, size, table;
+    unsigned count;
+    unsigned fixed[LINES];
+};
+
+static_assert(DONE - 128 < LINES, "token kinds overlap line codes");
+
+enum { OFF, RECORD, REPLAY };
+
+static int mode = OFF;
+static string path;
+static Hash digest;
+
+static vector<unsigned char> stream;
+struct Entry {
+    Name name;
+    unsigned index;
+};
+
+static vector<Entry> indices(1024);
+static vector<Name> names;
+static unsigned fixed[LINES];
+static int lastline = 1;
+static bool spoiled, glued;
+static const char *previous;
+
+static const unsigned char *first, *last;
+static vector<Lexeme> lexemes;
+static vector<long> values;
+
+
+/*
+ * Function:	variable
+ *
+ * Description:	Return whether tokens of the given kind may have different
+ *		lexemes, and so must have their lexemes stored.
+ */
+
+static inline bool variable(int kind)
+{
+    return kind == ID || kind == NUM || kind == CHARACTER || kind == STRING ||
+	kind == ERROR;
+}
+
+
+/*
+ * Function:	mix
+ *
+ * Description:	Mix a word of input into the hash value.
+ */
+
+static inline Hash mix(Hash h, Hash w)
+{
+    w *= 0x87c37b91114253d5ULL;
+    w = (w << 31) | (w >> 33);
+    w *= 0x4cf5ad432745937fULL;
+    h ^= w;
+    h = (h << 27) | (h >> 37);
+    return h * 5 + 0x52dce729;
+}
+
+
+/*
+ * Function:	hashBlock
+ *
+ * Description:	Hash a block of characters eight at a time.  Only the last
+ *		block of a file may be partial, so the hash of a file does
+ *		not depend on how it happens to be read.
+ */
+
+static Hash hashBlock(Hash h, const char *s, size_t n)
+{
+    Hash w;
+    size_t i;
+
+
+    for (i = 0; i + 8 <= n; i += 8) {
+	memcpy(&w, s + i, 8);
+	h = mix(h, w);
+    }
+
+    if (i < n) {
+	w = 0;
+	memcpy(&w, s + i, n - i);
+	h = mix(h, w);
+    }
+
+    return h;
+}
+
+
+/*
+ * Function:	hashSources
+ *
+ * Description:	Compute the hash of the contents of the given files.  The
+ *		length of each file is included, so that the boundaries
+ *		between files matter too.
+ */
+
+bool hashSources(int count, char *paths[], Hash &h)
+{
+    static char buffer[BLOCK_SIZE];
+    Hash length;
+    ssize_t n;
+    size_t used;
+    int fd;
+
+
+    h = CACHE_VERSION;
+
+    for (int i = 0; i < count; i ++) {
+	if ((fd = open(paths[i], O_RDONLY)) < 0)
+	    return false;
+
+	length = 0;
+
+	do {
+	    used = 0;
+
+	    do {
+		n = read(fd, buffer + used, BLOCK_SIZE - used);
+
+		if (n > 0)
+		    used += n;
+
+	    } while ((n > 0 || (n < 0 && errno == EINTR)) && used < BLOCK_SIZE);
+
+	    h = hashBlock(h, buffer, used);
+	    length += used;
+	} while (used == BLOCK_SIZE);
+
+	close(fd);
+
+	if (n < 0)
+	    return false;
+
+	h = mix(h, length);
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return true;
+}
+
+
+/*
+ * Function:	putNumber
+ *
+ * Description:	Append a variable-length number to the given buffer, seven
+ *		bits at a time with the high bit set on all but the last.
+ */
+
+static void putNumber(vector<unsigned char> &buf, unsigned n)
+{
+    while (n >= 0x80) {
+	buf.push_back(n | 0x80);
+	n >>= 7;
+    }
+
+    buf.push_back(n);
+}
+
+
+/*
+ * Function:	getNumber
+ *
+ * Description:	Read a variable-length number from the cache.
+ */
+
+static unsigned getNumber(const unsigned char *&p, const unsigned char *limit)
+{
+    unsigned n = 0, shift = 0;
+
+
+    while (p < limit && (*p & 0x80) && shift < 28) {
+	n |= (*p ++ & 0x7f) << shift;
+	shift += 7;
+    }
+
+    if (p < limit)
+	n |= *p ++ << shift;
+
+    return n;
+}
+
+
+/*
+ * Function:	corrupt
+ *
+ * Description:	Report that the cache file is damaged and give up.  We
+ *		have already handed some of its tokens to the parser, so
+ *		there is no going back to the source.
+ */
+
+static void corrupt()
+{
+    report("token cache %s is corrupt", path);
+    exit(EXIT_FAILURE);
+}
+
+
+/*
+ * Function:	loadCache
+ *
+ * Description:	Map the cache file, if it exists and is for the right
+ *		sources, and find its lexemes.  The lexemes stay in the
+ *		mapped file, and identifiers and literals are only interned
+ *		or converted when they are first replayed.
+ */
+
+static bool loadCache()
+{
+    struct stat st;
+    const unsigned char *p, *limit;
+    const Header *header;
+    unsigned length;
+    void *addr;
+    int fd;
+
+
+    if ((fd = open(path.c_str(), O_RDONLY)) < 0)
+	return false;
+
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(Header)) {
+	close(fd);
+	return false;
+    }
+
+    addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED)
+	return false;
+
+    header = (const Header *) addr;
+    limit = (const unsigned char *) addr + st.st_size;
+
+    if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION ||
+	    header->hash != digest || header->size != (Hash) st.st_size ||
+	    header->table < sizeof(Header) || header->table > header->size) {
+	munmap(addr, st.st_size);
+	return false;
+    }
+
+    p = (const unsigned char *) addr + header->table;
+
+    for (unsigned i = 0; i < header->count; i ++) {
+	length = getNumber(p, limit);
+
+	if (length > (size_t) (limit - p)) {
+	    munmap(addr, st.st_size);
+	    lexemes.clear();
+	    names.clear();
+	    return false;
+	}
+
+	lexemes.push_back(Lexeme {(const char *) p, length});
+	p += length;
+    }
+
+    memcpy(fixed, header->fixed, sizeof(fixed));
+    names.resize(lexemes.size());
+    values.resize(lexemes.size(), -1);
+    first = (const unsigned char *) addr + sizeof(Header);
+    last = (const unsigned char *) addr + header->table;
+    return true;
+}
+
+
+/*
+ * Function:	saveCache
+ *
+ * Description:	Write the recorded token stream to the cache file.  The
+ *		file is written under a temporary name and then renamed, so
+ *		that a concurrent compilation never sees half a file.
+ */
+
+static void saveCache()
+{
+    vector<unsigned char> table;
+    string temp;
+    Header header;
+    FILE *fp;
+
+
+    for (unsigned i = 0; i < names.size(); i ++) {
+	putNumber(table, names[i]->size());
+	table.insert(table.end(), names[i]->begin(), names[i]->end());
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.hash = digest;
+    header.table = sizeof(header) + stream.size();
+    header.size = header.table + table.size();
+    header.count = names.size();
+    memcpy(header.fixed, fixed, sizeof(fixed));
+
+    temp = path + "." + to_string(getpid());
+
+    if ((fp = fopen(temp.c_str(), "wb")) == NULL)
+	return;
+
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(stream.data(), 1, stream.size(), fp);
+    fwrite(table.data(), 1, table.size(), fp);
+
+    if (fclose(fp) != 0 || rename(temp.c_str(), path.c_str()) != 0)
+	unlink(temp.c_str());
+}
+
+
+/*
+ * Function:	slot
+ *
+ * Description:	Return the slot of the index table where the given name is
+ *		or belongs.  Names are unique, so they are hashed and
+ *		compared by pointer.
+ */
+
+static unsigned slot(Name name)
+{
+    unsigned mask, i;
+
+
+    mask = indices.size() - 1;
+    i = ((uintptr_t) name * 0x9e3779b97f4a7c15ULL) >> 40 & mask;
+
+    while (indices[i].name != nullptr && indices[i].name != name)
+	i = (i + 1) & mask;
+
+    return i;
+}
+
+
+/*
+ * Function:	indexOf
+ *
+ * Description:	Return the index of the given name in the lexeme table,
+ *		adding it if necessary.  The index table is an
+ *		open-addressing hash table kept at most half full, which is
+ *		much cheaper than a map for the number of lookups we do.
+ */
+
+static unsigned indexOf(Name name)
+{
+    vector<Entry> old;
+    unsigned i;
+
+
+    i = slot(name);
+
+    if (indices[i].name != nullptr)
+	return indices[i].index;
+
+    indices[i].name = name;
+    indices[i].index = names.size();
+    names.push_back(name);
+
+    if (names.size() * 2 > indices.size()) {
+	old.resize(indices.size() * 2);
+	old.swap(indices);
+
+	for (unsigned j = 0; j < old.size(); j ++)
+	    if (old[j].name != nullptr)
+		indices[slot(old[j].name)] = old[j];
+    }
+
+    return names.size() - 1;
+}
+
+
+/*
+ * Function:	record
+ *
+ * Description:	Append a token to the recorded stream.
+ */
+
+static void record(const Token &token)
+{
+    unsigned index, code;
+    int delta, n;
+    Name name;
+
+
+    delta = lineno - lastline;
+    lastline = lineno;
+
+    if (delta < 0) {
+	stream.push_back(RESET);
+	putNumber(stream, lineno);
+    }
+
+    for (; delta > 0; delta -= n) {
+	n = delta < GLUED - LINES ? delta : GLUED - LINES;
+	stream.push_back(LINES + n - 1);
+    }
+
+    if (glued)
+	stream.push_back(GLUED);
+
+    code = token.kind < 128 ? token.kind : token.kind - 128;
+    stream.push_back(code);
+
+    if (!variable(token.kind) && fixed[code] != 0)
+	return;
+
+    if (token.kind == ID)
+	name = token.name;
+    else
+	name = intern(token.lexeme.text, token.lexeme.length);
+
+    index = indexOf(name);
+
+    if (variable(token.kind))
+	putNumber(stream, index);
+    else
+	fixed[code] = index + 1;
+}
+
+
+/*
+ * Function:	replay
+ *
+ * Description:	Read the next token from the cache file, after any changes
+ *		in the line number, or mark of no white space, that precede
+ *		it.
+ */
+
+static int replay(Token &token)
+{
+    unsigned index, code;
+
+
+    glued = false;
+
+    while (first < last && *first >= LINES) {
+	code = *first ++;
+
+	if (code == GLUED)
+	    glued = true;
+	else if (code == RESET)
+	    lineno = getNumber(first, last);
+	else
+	    lineno += code - LINES + 1;
+    }
+
+    if (first >= last) {
+	token.kind = DONE;
+	token.lexeme.text = "";
+	token.lexeme.length = 0;
+	return DONE;
+    }
+
+    code = *first ++;
+    token.kind = code < 128 ? code : code + 128;
+    index = variable(token.kind) ? getNumber(first, last) : fixed[code] - 1;
+
+    if (index >= lexemes.size())
+	corrupt();
+
+    token.lexeme = lexemes[index];
+
+    if (token.kind == ID) {
+	if (names[index] == nullptr)
+	    names[index] = intern(lexemes[index].text, lexemes[index].length);
+
+	token.name = names[index];
+
+    } else if (token.kind == STRING) {
+	if (names[index] == nullptr)
+	    names[index] = strval(lexemes[index]);
+
+	token.name = names[index];
+
+    } else if (token.kind == NUM || token.kind == CHARACTER) {
+	if (values[index] == -1) {
+	    if (token.kind == NUM)
+		values[index] = numval(lexemes[index]);
+	    else
+		values[index] = charval(string(lexemes[index].text,
+			lexemes[index].length));
+	}
+
+	token.value = values[index];
+    }
+
+    return token.kind;
+}
+
+
+/*
+ * Function:	openCache
+ *
+ * Description:	Look in the given directory for the token stream of the
+ *		given source files.  Return true if it was found, in which
+ *		case the tokens will be replayed and the source need not be
+ *		opened.  Otherwise, the tokens read from the source will be
+ *		recorded.
+ */
+
+bool openCache(const char *dir, int count, char *paths[])
+{
+    char name[32];
+
+
+    if (count == 0 || !hashSources(count, paths, digest))
+	return false;
+
+    snprintf(name, sizeof(name), "/%016llx.tok", digest);
+    path = string(dir) + name;
+
+    if (loadCache()) {
+	mode = REPLAY;
+	return true;
+    }
+
+    mkdir(dir, 0777);
+    mode = RECORD;
+    return false;
+}
+
+
+/*
+ * Function:	errorCount
+ *
+ * Description:	Return the number of errors so far, whether they have been
+ *		reported or are being collected.
+ */
+
+static int errorCount()
+{
+    return numerrors + (diagnostics != nullptr ? diagnostics->size() : 0);
+}
+
+
+/*
+ * Function:	follow
+ *
+ * Description:	Note whether the given token, just read from the source,
+ *		immediately follows the token before it, and return its
+ *		kind.
+ */
+
+static inline int follow(const Token &token)
+{
+    glued = token.lexeme.text == previous;
+    previous = token.lexeme.text + token.lexeme.length;
+    return token.kind;
+}
+
+
+/*
+ * Function:	nextToken
+ *
+ * Description:	Return the next token, either from the cache or from the
+ *		lexical analyzer, which may be running in parallel.  In
+ *		watch mode, the tokens of the watched file are already in
+ *		memory.
+ */
+
+int nextToken(Token &token)
+{
+    int errors;
+
+
+    if (watching) {
+	watchToken(token);
+	return follow(token);
+    }
+
+    if (mode == REPLAY)
+	return replay(token);
+
+    if (mode == OFF) {
+	parallel ? parallelToken(token) : lexan(token);
+	return follow(token);
+    }
+
+    errors = errorCount();
+    parallel ? parallelToken(token) : lexan(token);
+    follow(token);
+    spoiled = spoiled || errorCount() != errors;
+    record(token);
+
+    if (token.kind == DONE) {
+	if (!spoiled)
+	    saveCache();
+
+	mode = OFF;
+    }
+
+    return token.kind;
+}
+
+
+/*
+ * Function:	spaced
+ *
+ * Description:	Return whether there is white space between the token
+ *		last returned by nextToken() and the one before it.  The
+ *		lexemes of replayed tokens are not in the source, so this
+ *		can't be told from where they are.
+ */
+
+bool spaced()
+{
+    return !glued;
+}
@@ -0,0 +1,33 @@
+/*
+ * File:	cache.h
+ *
+ * Description:	This file contains the public function declarations for
+ *		the token cache for Simple C.
+ *
+ *		The token stream for a set of source files can be saved in
+ *		a cache directory, keyed by a hash of their contents.  When
+ *		the same sources are compiled again, the tokens are replayed
+ *		from the cache instead of being produced by the lexical
+ *		analyzer.  The tokens are cached before they are
+ *		preprocessed, and the preprocessor reads every token
+ *		through nextToken(), which does the right thing whether or
+ *		not a cache is in use, whether or not the source is being
+ *		lexed in parallel, and whether or not the source is being
+ *		watched.
+ *
+ *		The hash of the contents of a set of files is also what
+ *		decides whether a precompiled header is still current.
+ */
+
+# ifndef CACHE_H
+# define CACHE_H
+# include "lexer.h"
+
+typedef unsigned long long Hash;
+
+bool hashSources(int count, char *paths[], Hash &h);
+bool openCache(const char *dir, int count, char *paths[]);
+int nextToken(Token &token);
+bool spaced();
+
+# endif /* CACHE_H */
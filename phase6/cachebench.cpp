@@ -0,0 +1,157 @@
+/*
+ * File:	cachebench.cpp
+ *
+ * Description:	This file contains a benchmark for the token cache for
+ *		Simple C.  The token stream of a source file is produced
+ *		three ways: by the lexical analyzer alone, by a cold run that
+ *		lexes and writes the cache, and by a warm run that replays
+ *		the cache.  The cold and warm runs include hashing the
+ *		source, since a real compilation must do that too.
+ *
+ *		The lexical analyzer can only be run once per process, so
+ *		each run is made in a child process of its own.  If no file
+ *		is given, a synthetic source file is generated.
+ *
+ *		usage: cachebench [file | megabytes]
+ */
+
+# include <ctime>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <string>
+# include <unistd.h>
+# include <dirent.h>
+# include <sys/stat.h>
+# include <sys/wait.h>
+# include "lexer.h"
+# include "source.h"
+# include "cache.h"
+# include "tokens.h"
+
+using namespace std;
+
+static char dir[] = "/tmp/cachebenchXXXXXX";
+
+
+/*
+ * Function:	generate
+ *
+ * Description:	Write a synthetic source file of about the given size.
+ */
+
+static void generate(const string &path, unsigned long size)
+{
+    FILE *fp;
+    unsigned n;
+
+
+    if ((fp = fopen(path.c_str(), "w")) == NULL) {
+	perror(path.c_str());
+	exit(EXIT_FAILURE);
+    }
+
+    for (n = 0; (unsigned long) ftell(fp) < size; n ++)
+	fprintf(fp, "int f%u(int a, int b)\n{\n    int i, s;\n\n"
+		"    s = 0;\n    i = 0;\n\n    while (i < a) {\n"
+		"\ts = s + i * b - %u;\t/* accumulate */\n"
+		"\ti = i + 1;\n    }\n\n    return s;\n}\n\n", n, n);
+
+    fclose(fp);
+}
+
+
+/*
+ * Function:	measure
+ *
+ * Description:	Produce the token stream for the file in a child process
+ *		and report how long it took.
+ */
+
+static void measure(const char *name, char *path, const char *cache)
+{
+    clock_t start;
+    unsigned long count = 0;
+    Token token;
+    double secs;
+    int status;
+
+
+    fflush(stdout);
+
+    if (fork() == 0) {
+	start = clock();
+
+	if (cache == NULL || !openCache(cache, 1, &path))
+	    openSource(1, &path);
+
+	while (nextToken(token) != DONE) {
+	    count ++;
+	    releaseSource();
+	}
+
+	secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+	printf("%-8s %8.1f ms  %8.1f Mtokens/s\n", name, secs * 1e3,
+	       count / secs / 1e6);
+	fflush(stdout);
+	_exit(EXIT_SUCCESS);
+    }
+
+    wait(&status);
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Benchmark the three ways of producing the tokens.
+ */
+
+int main(int argc, char *argv[])
+{
+    struct stat st;
+    struct dirent *dp;
+    string source, cache;
+    DIR *dirp;
+
+
+    if (mkdtemp(dir) == NULL) {
+	perror(dir);
+	exit(EXIT_FAILURE);
+    }
+
+    cache = string(dir) + "/cache";
+
+    if (argc > 1 && stat(argv[1], &st) == 0)
+	source = argv[1];
+    else {
+	source = string(dir) + "/source.c";
+	generate(source, (argc > 1 ? atoi(argv[1]) : 32) * 1048576UL);
+    }
+
+    stat(source.c_str(), &st);
+    printf("source   %8.1f MB\n", st.st_size / 1048576.0);
+
+    measure("lexan", &source[0], NULL);
+    measure("cold", &source[0], cache.c_str());
+    measure("warm", &source[0], cache.c_str());
+
+    if ((dirp = opendir(cache.c_str())) != NULL) {
+	while ((dp = readdir(dirp)) != NULL)
+	    if (dp->d_name[0] != '.') {
+		string file = cache + "/" + dp->d_name;
+		stat(file.c_str(), &st);
+		printf("cache    %8.1f MB\n", st.st_size / 1048576.0);
+		unlink(file.c_str());
+	    }
+
+	closedir(dirp);
+	rmdir(cache.c_str());
+    }
+
+    if (source == string(dir) + "/source.c")
+	unlink(source.c_str());
+
+    rmdir(dir);
+    exit(EXIT_SUCCESS);
+}
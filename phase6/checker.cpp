@@ -6,9 +6,17 @@
  *
  *		Extra functionality:
  *		- inserting an undeclared symbol with the error type
+ *		- journaling changes to the global state so that they can be
+ *		  undone and redone
+ *		- checking against a snapshot of the global state taken from
+ *		  a journal, so that function bodies can be checked in
+ *		  parallel
+ *		- writing a summary of the global state
+ *		- laying out each structure once, when it is defined
  */
 
 # include <map>
+# include <algorithm>
 # include <cassert>
 # include <iostream>
 # include "lexer.h"
@@ -22,9 +30,25 @@
 
 using namespace std;
 
-static map<string,Scope *> fields;
-static Scope *outermost, *toplevel;
-static const Type error, integer("int"), character("char");
+struct Structure {
+    Scope *fields;
+    Layout layout;
+    unsigned order;
+};
+
+static map<Name,Structure> structures;
+static unsigned definitions;
+static Scope *outermost;
+static __thread Scope *toplevel;
+static __thread Changes *journaled;
+static __thread const Changes *history;
+static __thread unsigned horizon;
+static __thread MissingFields *missing;
+static map<Name,vector<unsigned>> versions;
+static map<Name,unsigned> defined;
+static const Name unknown = intern("-unknown-");
+static const Type error, integer(intern("int")),
+    character(intern("char"));
 
 static string undeclared = "'%s' undeclared";
 static string redefined = "redefinition of '%s'";
@@ -79,6 +103,67 @@ static Type promote(Expression *&expr)
 }
 
 
+/*
+ * Function:	isDefined
+ *
+ * Description:	Check if the structure with the specified name has been
+ *		defined.  When checking against a snapshot, only the
+ *		definitions made before the snapshot count.
+ */
+
+static bool isDefined(Name name)
+{
+    map<Name,unsigned>::const_iterator it;
+
+
+    if (history == nullptr)
+	return structures.count(name) > 0;
+
+    it = defined.find(name);
+    return it != defined.end() && it->second < horizon;
+}
+
+
+/*
+ * Function:	lookup
+ *
+ * Description:	Look up the specified name in the top-level scope and its
+ *		enclosing scopes.  When checking against a snapshot, the
+ *		outermost scope is not searched directly, since it may have
+ *		changed since.  Instead, the last change to the name in the
+ *		outermost scope before the snapshot decides, which is found
+ *		by a binary search of the changes to the name.
+ */
+
+static Symbol *lookup(Name name)
+{
+    map<Name,vector<unsigned>>::const_iterator it;
+    vector<unsigned>::const_iterator last;
+    const Change *change;
+    Symbol *symbol;
+    Scope *scope;
+
+
+    if (history == nullptr)
+	return toplevel->lookup(name);
+
+    for (scope = toplevel; scope != outermost; scope = scope->enclosing())
+	if ((symbol = scope->find(name)) != nullptr)
+	    return symbol;
+
+    if ((it = versions.find(name)) == versions.end())
+	return nullptr;
+
+    last = lower_bound(it->second.begin(), it->second.end(), horizon);
+
+    if (last == it->second.begin())
+	return nullptr;
+
+    change = &(*history)[*(last - 1)];
+    return change->kind == INSERTED ? change->symbol : nullptr;
+}
+
+
 /*
  * Function:	isIncomplete
  *
@@ -87,7 +172,7 @@ static Type promote(Expression *&expr)
 
 static bool isIncomplete(const Type &t)
 {
-    return !t.isPointer() && t.isStruct() && fields.count(t.specifier()) == 0;
+    return !t.isPointer() && t.isStruct() && !isDefined(t.specifier());
 }
 
 
@@ -112,15 +197,15 @@ static bool isIncompletePointer(const Type &t)
  *		fields have been defined.
  */
 
-static Type checkIfComplete(const string &name, const Type &type)
+static Type checkIfComplete(Name name, const Type &type)
 {
     if (!type.isStruct() || type.indirection() > 0)
 	return type;
 
-    if (fields.count(type.specifier()) > 0)
+    if (isDefined(type.specifier()))
 	return type;
 
-    report(incomplete, name);
+    report(incomplete, *name);
     return error;
 }
 
@@ -131,20 +216,43 @@ static Type checkIfComplete(const string &name, const Type &type)
  * Description:	Check if the given type is a structure.
  */
 
-static Type checkIfStructure(const string &name, const Type &type)
+static Type checkIfStructure(Name name, const Type &type)
 {
     if (!type.isStruct() || type.indirection() > 0)
 	return type;
 
-    report(nonpointer, name);
+    report(nonpointer, *name);
     return error;
 }
 
 
+/*
+ * Function:	record
+ *
+ * Description:	Record a change to the global state in the journal, if
+ *		there is one.
+ */
+
+static void record(int kind, Scope *scope, Symbol *symbol, Name name)
+{
+    Change change;
+
+
+    if (journaled != nullptr) {
+	change.kind = kind;
+	change.scope = scope;
+	change.symbol = symbol;
+	change.name = name;
+	journaled->push_back(change);
+    }
+}
+
+
 /*
  * Function:	openScope
  *
- * Description:	Create a scope and make it the new top-level scope.
+ * Description:	Create a scope in the current arena and make it the new
+ *		top-level scope.
  */
 
 Scope *openScope()
@@ -158,6 +266,20 @@ Scope *openScope()
 }
 
 
+/*
+ * Function:	reopenScope
+ *
+ * Description:	Make a scope that was closed earlier the top-level scope
+ *		again, such as the scope of the parameters of a function
+ *		whose body is checked later.
+ */
+
+void reopenScope(Scope *scope)
+{
+    toplevel = scope;
+}
+
+
 /*
  * Function:	closeScope
  *
@@ -174,16 +296,129 @@ Scope *closeScope()
 }
 
 
+/*
+ * Function:	layOut
+ *
+ * Description:	Lay out the fields of the given structure, giving each its
+ *		offset, and compute the size and alignment of the
+ *		structure.  Each field is aligned, and so is the entire
+ *		structure, whose alignment is the maximum alignment of its
+ *		fields.  A field whose type is in error takes no room.
+ */
+
+static void layOut(Structure &structure)
+{
+    const Symbols &symbols = structure.fields->symbols();
+    unsigned size, align, alignment;
+
+
+    size = 0;
+    alignment = 1;
+
+    for (unsigned i = 0; i < symbols.size(); i ++) {
+	if (symbols[i]->type().isError())
+	    continue;
+
+	align = symbols[i]->type().alignment();
+
+	if (size % align != 0)
+	    size += (align - size % align);
+
+	symbols[i]->_offset = size;
+	size += symbols[i]->type().size();
+
+	if (align > alignment)
+	    alignment = align;
+    }
+
+    if (size % alignment != 0)
+	size += (alignment - size % alignment);
+
+    structure.layout.size = size;
+    structure.layout.alignment = alignment;
+}
+
+
+/*
+ * Function:	define
+ *
+ * Description:	Make the given scope the fields of the structure with the
+ *		given name, and lay it out.  The structures it uses have
+ *		all been defined before it.
+ */
+
+static void define(Name name, Scope *scope)
+{
+    Structure &structure = structures[name];
+
+
+    structure.fields = scope;
+    structure.order = definitions ++;
+    layOut(structure);
+}
+
+
 /*
  * Function:	getFields
  *
  * Description:	Return the fields associated with the specified structure.
  */
 
-Symbols getFields(const string &name)
+const Symbols &getFields(Name name)
 {
-    assert(fields.count(name) > 0);
-    return fields[name]->symbols();
+    assert(structures.count(name) > 0);
+    return structures.find(name)->second.fields->symbols();
+}
+
+
+/*
+ * Function:	getLayout
+ *
+ * Description:	Return the layout of the specified structure.
+ */
+
+Layout getLayout(Name name)
+{
+    assert(structures.count(name) > 0);
+    return structures.find(name)->second.layout;
+}
+
+
+/*
+ * Function:	getStructures
+ *
+ * Description:	Return the names of all structures defined, in the order
+ *		they were defined, so that each comes after those it uses.
+ */
+
+vector<Name> getStructures()
+{
+    map<Name,Structure>::iterator it;
+    map<unsigned,Name> ordered;
+    map<unsigned,Name>::iterator jt;
+    vector<Name> names;
+
+
+    for (it = structures.begin(); it != structures.end(); ++ it)
+	ordered[it->second.order] = it->first;
+
+    for (jt = ordered.begin(); jt != ordered.end(); ++ jt)
+	names.push_back(jt->second);
+
+    return names;
+}
+
+
+/*
+ * Function:	getDeclarations
+ *
+ * Description:	Return the symbols declared in the outermost scope, in the
+ *		order they were declared.
+ */
+
+const Symbols &getDeclarations()
+{
+    return outermost->symbols();
 }
 
 
@@ -195,13 +430,14 @@ Symbols getFields(const string &name)
  *		once.
  */
 
-void defineStructure(const string &name, Scope *scope)
+void defineStructure(Name name, Scope *scope)
 {
-    if (fields.count(name) > 0) {
-	report(redefined, name);
-	delete scope;
-    } else
-	fields[name] = scope;
+    if (structures.count(name) > 0)
+	report(redefined, *name);
+    else {
+	define(name, scope);
+	record(DEFINED, scope, nullptr, name);
+    }
 }
 
 
@@ -211,27 +447,27 @@ void defineStructure(const string &name, Scope *scope)
  * Description:	Define a function with the specified NAME and TYPE.  A
  *		function is always defined in the outermost scope.  This
  *		definition always replaces any previous definition or
- *		declaration.
+ *		declaration.  The symbol is allocated in the permanent
+ *		arena, since the current one holds the function itself.
  */
 
-Symbol *defineFunction(const string &name, const Type &type)
+Symbol *defineFunction(Name name, const Type &type)
 {
     Symbol *symbol = outermost->find(name);
 
     if (symbol != nullptr) {
-	if (symbol->type().isFunction() && symbol->type().parameters()) {
-	    report(redefined, name);
-	    delete symbol->type().parameters();
-
-	} else if (type != symbol->type())
-	    report(conflicting, name);
+	if (symbol->type().isFunction() && symbol->type().parameters())
+	    report(redefined, *name);
+	else if (type != symbol->type())
+	    report(conflicting, *name);
 
 	outermost->remove(name);
-	delete symbol;
+	record(REMOVED, outermost, symbol, name);
     }
 
-    symbol = new Symbol(name, checkIfStructure(name, type));
+    symbol = new (permanent) Symbol(name, checkIfStructure(name, type));
     outermost->insert(symbol);
+    record(INSERTED, outermost, symbol, name);
 
     return symbol;
 }
@@ -245,18 +481,17 @@ Symbol *defineFunction(const string &name, const Type &type)
  *		redeclaration is discarded.
  */
 
-Symbol *declareFunction(const string &name, const Type &type)
+Symbol *declareFunction(Name name, const Type &type)
 {
     Symbol *symbol = outermost->find(name);
 
     if (symbol == nullptr) {
-	symbol = new Symbol(name, checkIfStructure(name, type));
+	symbol = new (permanent) Symbol(name, checkIfStructure(name, type));
 	outermost->insert(symbol);
+	record(INSERTED, outermost, symbol, name);
 
-    } else if (type != symbol->type()) {
-	report(conflicting, name);
-	delete type.parameters();
-    }
+    } else if (type != symbol->type())
+	report(conflicting, *name);
 
     return symbol;
 }
@@ -271,7 +506,7 @@ Symbol *declareFunction(const string &name, const Type &type)
  *		cannot be a structure type.
  */
 
-Symbol *declareParameter(const string &name, const Type &type)
+Symbol *declareParameter(Name name, const Type &type)
 {
     return declareVariable(name, checkIfStructure(name, type));
 }
@@ -284,7 +519,7 @@ Symbol *declareParameter(const string &name, const Type &type)
  *		redeclaration is discarded.
  */
 
-Symbol *declareVariable(const string &name, const Type &type)
+Symbol *declareVariable(Name name, const Type &type)
 {
     Symbol *symbol = toplevel->find(name);
 
@@ -292,16 +527,34 @@ Symbol *declareVariable(const string &name, const Type &type)
 	symbol = new Symbol(name, checkIfComplete(name, type));
 	toplevel->insert(symbol);
 
+	if (toplevel == outermost)
+	    record(INSERTED, outermost, symbol, name);
+
     } else if (outermost != toplevel)
-	report(redeclared, name);
+	report(redeclared, *name);
 
     else if (type != symbol->type())
-	report(conflicting, name);
+	report(conflicting, *name);
 
     return symbol;
 }
 
 
+/*
+ * Function:	declareSymbol
+ *
+ * Description:	Declare the given symbol, which has already been checked,
+ *		in the outermost scope, such as one restored from a
+ *		precompiled header.
+ */
+
+void declareSymbol(Symbol *symbol)
+{
+    outermost->insert(symbol);
+    record(INSERTED, outermost, symbol, symbol->name());
+}
+
+
 /*
  * Function:	checkIdentifier
  *
@@ -310,12 +563,12 @@ Symbol *declareVariable(const string &name, const Type &type)
  *		future error messages.
  */
 
-Symbol *checkIdentifier(const string &name)
+Symbol *checkIdentifier(Name name)
 {
-    Symbol *symbol = toplevel->lookup(name);
+    Symbol *symbol = lookup(name);
 
     if (symbol == nullptr) {
-	report(undeclared, name);
+	report(undeclared, *name);
 	symbol = new Symbol(name, error);
 	toplevel->insert(symbol);
     }
@@ -409,18 +662,57 @@ Expression *checkArray(Expression *left, Expression *right)
 }
 
 
+/*
+ * Function:	missingField
+ *
+ * Description:	Report that the given fields of a structure have none
+ *		with the given name, and go ahead and declare it and give
+ *		it the error type, so we only get the error once.  Since
+ *		the structure outlives the function, so must the symbol.
+ *		When checking against a snapshot, the symbol is kept with
+ *		the missing fields of the body instead, along with the
+ *		index of its diagnostic.
+ */
+
+static Symbol *missingField(Scope *scope, Name id, const string &op)
+{
+    Symbol *symbol;
+    unsigned i;
+
+
+    if (history == nullptr) {
+	report(invalid_operands, op);
+	symbol = new (permanent) Symbol(id, error);
+	scope->insert(symbol);
+	record(INSERTED, scope, symbol, id);
+	return symbol;
+    }
+
+    for (i = 0; i < missing->size(); i ++) {
+	symbol = (*missing)[i].symbol;
+
+	if ((*missing)[i].fields == scope && symbol->name() == id)
+	    return symbol;
+    }
+
+    symbol = new Symbol(id, error);
+    i = diagnostics != nullptr ? diagnostics->size() : 0;
+    missing->push_back({scope, symbol, i});
+    report(invalid_operands, op);
+    return symbol;
+}
+
+
 /*
  * Function:	checkDirectField
  *
  * Description:	Check a direct structure field reference expression: the
  *		expression must have a structure type, the identifier must
  *		be a field of that structure, and the result has the type
- *		of the field.  If the identifier is not a member of the
- *		structure, we go ahead and declare it and give it the error
- *		type, so we only get the error once.
+ *		of the field.
  */
 
-Expression *checkDirectField(Expression *expr, const string &id)
+Expression *checkDirectField(Expression *expr, Name id)
 {
     Scope *scope;
     Symbol *symbol = nullptr;
@@ -437,15 +729,11 @@ Expression *checkDirectField(Expression *expr, const string &id)
 		report(incomplete_type);
 
 	    else {
-		scope = fields[t.specifier()];
+		scope = structures[t.specifier()].fields;
 		symbol = scope->find(id);
-		t.size();
 
-		if (symbol == nullptr) {
-		    report(invalid_operands, ".");
-		    symbol = new Symbol(id, error);
-		    scope->insert(symbol);
-		}
+		if (symbol == nullptr)
+		    symbol = missingField(scope, id, ".");
 
 		result = symbol->type();
 	    }
@@ -453,7 +741,7 @@ Expression *checkDirectField(Expression *expr, const string &id)
     }
 
     if (symbol == nullptr)
-	symbol = new Symbol("-unknown-", error);
+	symbol = new Symbol(unknown, error);
 
     return new Field(expr, new Identifier(symbol), result);
 }
@@ -468,7 +756,7 @@ Expression *checkDirectField(Expression *expr, const string &id)
  *		structure, and the result has the type of the field.
  */
 
-Expression *checkIndirectField(Expression *expr, const string &id)
+Expression *checkIndirectField(Expression *expr, Name id)
 {
     Scope *scope;
     Symbol *symbol = nullptr;
@@ -485,15 +773,12 @@ Expression *checkIndirectField(Expression *expr, const string &id)
 		report(incomplete_type);
 
 	    else {
-		scope = fields[t.specifier()];
+		scope = structures[t.specifier()].fields;
 		symbol = scope->find(id);
 		t = t.deref();
 
-		if (symbol == nullptr) {
-		    report(invalid_operands, "->");
-		    symbol = new Symbol(id, error);
-		    scope->insert(symbol);
-		}
+		if (symbol == nullptr)
+		    symbol = missingField(scope, id, "->");
 
 		result = symbol->type();
 	    }
@@ -501,7 +786,7 @@ Expression *checkIndirectField(Expression *expr, const string &id)
     }
 
     if (symbol == nullptr)
-	symbol = new Symbol("-unknown-", error);
+	symbol = new Symbol(unknown, error);
 
     return new Field(new Dereference(expr, t), new Identifier(symbol), result);
 }
@@ -610,7 +895,9 @@ Expression *checkAddress(Expression *expr)
  * Function:	checkSizeof
  *
  * Description:	Check a sizeof expression: the type cannot be a function
- *		type and must be complete.
+ *		type and must be complete.  Taking the size of such a type
+ *		fails an assertion.  When checking against a snapshot, a
+ *		type that fails in the same way is thrown instead.
  */
 
 Expression *checkSizeof(const Type &type)
@@ -619,6 +906,14 @@ Expression *checkSizeof(const Type &type)
 	if (type.isFunction() || isIncomplete(type))
 	    report(invalid_sizeof);
 
+    if (history != nullptr) {
+	if (type == error || type.isFunction())
+	    throw Unsizable{type};
+
+	if (isIncomplete(type))
+	    throw Unsizable{Type(unknown)};
+    }
+
     return new Number(type.size());
 }
 
@@ -1016,3 +1311,280 @@ void checkTest(Expression *&expr)
     if (t != error && !t.isSimple())
 	report(invalid_test);
 }
+
+
+/*
+ * Function:	resetScopes
+ *
+ * Description:	Close any scopes left open by a declaration that was
+ *		abandoned, so that the outermost scope is the top-level
+ *		scope again.
+ */
+
+void resetScopes()
+{
+    toplevel = outermost;
+}
+
+
+/*
+ * Function:	journal
+ *
+ * Description:	Record every later change to the global state, which
+ *		consists of the outermost scope, the structure definitions,
+ *		and the fields of structures, in the given journal.  A null
+ *		journal turns journaling off.
+ */
+
+void journal(Changes *changes)
+{
+    journaled = changes;
+}
+
+
+/*
+ * Function:	snapshot
+ *
+ * Description:	Check against the global state as it was after the given
+ *		number of changes in the given journal, rather than as it
+ *		is now.  The journal must not change while it is used.  A
+ *		field that is not found is reported as usual, but is not
+ *		added to its structure, since the structure is shared, but
+ *		to the given missing fields instead.  A null journal turns
+ *		this off.
+ */
+
+void snapshot(const Changes *changes, unsigned count, MissingFields *fields)
+{
+    history = changes;
+    horizon = count;
+    missing = fields;
+}
+
+
+/*
+ * Function:	indexChanges
+ *
+ * Description:	Index the given journal by name before checking against
+ *		snapshots of it, so that a name is looked up without
+ *		scanning the journal.  For each name, the positions of the
+ *		changes to it in the outermost scope are kept in order, as
+ *		is the position of the first definition of a structure with
+ *		the name.  The journal must not change once it is indexed.
+ *		A null journal discards the index.
+ */
+
+void indexChanges(const Changes *changes)
+{
+    versions.clear();
+    defined.clear();
+
+    if (changes == nullptr)
+	return;
+
+    for (unsigned i = 0; i < changes->size(); i ++) {
+	const Change &change = (*changes)[i];
+
+	if (change.kind == DEFINED)
+	    defined.insert(make_pair(change.name, i));
+	else if (change.scope == outermost)
+	    versions[change.name].push_back(i);
+    }
+}
+
+
+/*
+ * Function:	undoChanges
+ *
+ * Description:	Undo the given changes, which must be the most recent ones
+ *		still in effect, in reverse order.
+ */
+
+void undoChanges(const Changes &changes)
+{
+    for (unsigned i = changes.size(); i > 0; i --) {
+	const Change &change = changes[i - 1];
+
+	if (change.kind == INSERTED)
+	    change.scope->remove(change.name);
+	else if (change.kind == REMOVED)
+	    change.scope->insert(change.symbol);
+	else
+	    structures.erase(change.name);
+    }
+}
+
+
+/*
+ * Function:	redoChanges
+ *
+ * Description:	Make the given changes again, after they have been undone.
+ *		A symbol is removed by name, since the symbol now in the
+ *		scope may be an equal one from a declaration that was
+ *		checked again, and that is the symbol that would be brought
+ *		back were the change undone once more.
+ */
+
+void redoChanges(Changes &changes)
+{
+    for (unsigned i = 0; i < changes.size(); i ++) {
+	Change &change = changes[i];
+
+	if (change.kind == INSERTED)
+	    change.scope->insert(change.symbol);
+
+	else if (change.kind == REMOVED) {
+	    change.symbol = change.scope->find(change.name);
+	    change.scope->remove(change.name);
+
+	} else
+	    define(change.name, change.scope);
+    }
+}
+
+
+/*
+ * Function:	sameChanges
+ *
+ * Description:	Return whether two sequences of changes leave the global
+ *		state the same, other than by using different but equal
+ *		symbols.  A structure definition is never the same as
+ *		another, since its fields are a scope of its own.
+ */
+
+bool sameChanges(const Changes &a, const Changes &b)
+{
+    if (a.size() != b.size())
+	return false;
+
+    for (unsigned i = 0; i < a.size(); i ++) {
+	if (a[i].kind != b[i].kind || a[i].name != b[i].name)
+	    return false;
+
+	if (a[i].scope != b[i].scope)
+	    return false;
+
+	if (a[i].kind != DEFINED) {
+	    const Type &t1 = a[i].symbol->type(), &t2 = b[i].symbol->type();
+
+	    if (t1 != t2)
+		return false;
+
+	    if (t1.isFunction() && !t1.parameters() != !t2.parameters())
+		return false;
+	}
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	writeDeclaration
+ *
+ * Description:	Write a declaration of the given name with the given type,
+ *		or just the type if there is no name, in the syntax of
+ *		Simple C.  The parameters of a function are written as
+ *		types alone.
+ */
+
+static void writeDeclaration(ostream &ostr, const Type &type, Name name)
+{
+    Parameters *params;
+
+
+    if (type.isStruct())
+	ostr << "struct ";
+
+    ostr << *type.specifier();
+
+    if (type.indirection() > 0 || name != nullptr)
+	ostr << " ";
+
+    for (unsigned i = 0; i < type.indirection(); i ++)
+	ostr << "*";
+
+    if (name != nullptr)
+	ostr << *name;
+
+    if (type.isArray())
+	ostr << "[" << type.length() << "]";
+
+    else if (type.isFunction()) {
+	ostr << "(";
+	params = type.parameters();
+
+	if (params != nullptr && params->empty())
+	    ostr << "void";
+
+	else if (params != nullptr)
+	    for (unsigned i = 0; i < params->size(); i ++) {
+		ostr << (i > 0 ? ", " : "");
+		writeDeclaration(ostr, (*params)[i], nullptr);
+	    }
+
+	ostr << ")";
+    }
+}
+
+
+/*
+ * Function:	alphabetical
+ *
+ * Description:	Return whether the first name comes before the second.
+ */
+
+static bool alphabetical(Name a, Name b)
+{
+    return *a < *b;
+}
+
+
+/*
+ * Function:	writeInterface
+ *
+ * Description:	Write a summary of the global state, one line for each
+ *		structure and then one line for each symbol in the
+ *		outermost scope, in the order they were declared.  The
+ *		structures are sorted by name, since the table of
+ *		structures is keyed by the interned names.
+ */
+
+void writeInterface(ostream &ostr)
+{
+    map<Name,Structure>::iterator it;
+    vector<Name> names;
+    const Symbols *symbols;
+    Symbol *symbol;
+
+
+    for (it = structures.begin(); it != structures.end(); ++ it)
+	names.push_back(it->first);
+
+    sort(names.begin(), names.end(), alphabetical);
+
+    for (unsigned i = 0; i < names.size(); i ++) {
+	ostr << "struct " << *names[i] << " {";
+	symbols = &structures[names[i]].fields->symbols();
+
+	for (unsigned j = 0; j < symbols->size(); j ++) {
+	    symbol = (*symbols)[j];
+	    ostr << " ";
+	    writeDeclaration(ostr, symbol->type(), symbol->name());
+	    ostr << ";";
+	}
+
+	ostr << " };" << endl;
+    }
+
+    if (outermost == nullptr)
+	return;
+
+    symbols = &outermost->symbols();
+
+    for (unsigned i = 0; i < symbols->size(); i ++) {
+	symbol = (*symbols)[i];
+	writeDeclaration(ostr, symbol->type(), symbol->name());
+	ostr << ";" << endl;
+    }
+}
@@ -3,6 +3,29 @@
  *
  * Description:	This file contains the public function declarations for the
  *		semantic checker for Simple C.
+ *
+ *		Changes to the global state can be recorded in a journal,
+ *		so that the effects of a top-level declaration can be undone
+ *		and redone without checking the declaration again.  A
+ *		function body can also be checked against the global state
+ *		as it was at some point in a journal, so that bodies can be
+ *		checked in parallel once the global state is complete.  The
+ *		journal is first indexed by name, so that a name is looked
+ *		up without scanning it.  The current scope and journal are
+ *		private to each thread.
+ *
+ *		A body checked against a snapshot must not change the
+ *		global state, so a field that is not found in a structure
+ *		is not added to it, but kept with the body, along with its
+ *		diagnostic, so that a field reported missing by an earlier
+ *		body need not be reported again.  Nor must the body abort
+ *		before the diagnostics of earlier bodies are written, so a
+ *		type whose size cannot be taken is thrown instead, for the
+ *		caller to size once they are.
+ *
+ *		A structure is laid out once, when it is defined, so its
+ *		size, its alignment, and the offsets of its fields are
+ *		never written while bodies are checked.
  */
 
 # ifndef CHECKER_H
@@ -10,22 +33,54 @@
 # include "Scope.h"
 # include "Tree.h"
 
+enum { INSERTED, REMOVED, DEFINED };
+
+struct Change {
+    int kind;
+    Scope *scope;
+    Symbol *symbol;
+    Name name;
+};
+
+typedef std::vector<Change> Changes;
+
+struct MissingField {
+    Scope *fields;
+    Symbol *symbol;
+    unsigned diagnostic;
+};
+
+typedef std::vector<MissingField> MissingFields;
+
+struct Unsizable {
+    Type type;
+};
+
+struct Layout {
+    unsigned size, alignment;
+};
+
 Scope *openScope();
+void reopenScope(Scope *scope);
 Scope *closeScope();
-Symbols getFields(const std::string &name);
+const Symbols &getFields(Name name);
+Layout getLayout(Name name);
+std::vector<Name> getStructures();
+const Symbols &getDeclarations();
 
-void defineStructure(const std::string &name, Scope *scope);
+void defineStructure(Name name, Scope *scope);
 
-Symbol *defineFunction(const std::string &name, const Type &type);
-Symbol *declareFunction(const std::string &name, const Type &type);
-Symbol *declareParameter(const std::string &name, const Type &type);
-Symbol *declareVariable(const std::string &name, const Type &type);
-Symbol *checkIdentifier(const std::string &name);
+Symbol *defineFunction(Name name, const Type &type);
+Symbol *declareFunction(Name name, const Type &type);
+Symbol *declareParameter(Name name, const Type &type);
+Symbol *declareVariable(Name name, const Type &type);
+void declareSymbol(Symbol *symbol);
+Symbol *checkIdentifier(Name name);
 
 Expression *checkCall(Symbol *symbol, Expressions &args);
 Expression *checkArray(Expression *left, Expression *right);
-Expression *checkDirectField(Expression *expr, const std::string &id);
-Expression *checkIndirectField(Expression *expr, const std::string &id);
+Expression *checkDirectField(Expression *expr, Name id);
+Expression *checkIndirectField(Expression *expr, Name id);
 Expression *checkNot(Expression *expr);
 Expression *checkNegate(Expression *expr);
 Expression *checkDereference(Expression *expr);
@@ -51,4 +106,14 @@ Statement *checkAssignment(Expression *left, Expression *right);
 void checkReturn(Expression *&expr, const Type &type);
 void checkTest(Expression *&expr);
 
+void resetScopes();
+void journal(Changes *changes);
+void undoChanges(const Changes &changes);
+void redoChanges(Changes &changes);
+bool sameChanges(const Changes &a, const Changes &b);
+void snapshot(const Changes *changes, unsigned count, MissingFields *missing);
+void indexChanges(const Changes *changes);
+
+void writeInterface(std::ostream &ostr);
+
 # endif /* CHECKER_H */
@@ -0,0 +1,138 @@
+/*
+ * File:	deepbench.cpp
+ *
+ * Description:	This file contains a stress test for deeply nested input to
+ *		Simple C.  For each kind of nesting, a function is generated
+ *		whose body nests one construct to a quarter, a half, and all
+ *		of the given depth, and the compiler is run on it in a child
+ *		process.  Each compilation must succeed, and doubling the
+ *		depth must no more than about double the time taken, since
+ *		the parser and the tree walks should be linear in the depth
+ *		and limited only by memory rather than by the native stack.
+ *
+ *		usage: deepbench [depth [compiler]]
+ */
+
+# include <cstdio>
+# include <cstdlib>
+# include <string>
+# include <unistd.h>
+# include "harness.h"
+
+# define MAX_GROWTH 3.0		/* largest acceptable ratio for doubling */
+
+using namespace std;
+
+struct Nesting {
+    const char *name, *open, *inner, *close;
+};
+
+static const Nesting nestings[] = {
+    {"parens", "(", "x", ")"},
+    {"binary", "(x + ", "x", ")"},
+    {"logical", "(x && ", "x", ")"},
+    {"prefix", "- ", "x", ""},
+    {"cast", "(int) ", "x", ""},
+    {"index", "p[", "0", "]"},
+    {"call", "f(", "x", ")"},
+    {"block", "{ int y; ", "x = y;", " }"},
+    {"while", "while (x) ", "x = x - 1;", ""},
+    {"if-else", "if (x) x = 1; else ", "x = 2;", ""},
+};
+
+static string dir;
+
+
+/*
+ * Function:	generate
+ *
+ * Description:	Write a source file that nests the given construct to the
+ *		given depth.  Expressions are the right side of an
+ *		assignment, and statements are the body of the function.
+ */
+
+static void generate(const string &path, const Nesting &nesting,
+	unsigned depth)
+{
+    bool statement;
+    FILE *fp;
+    unsigned i;
+
+
+    if ((fp = fopen(path.c_str(), "w")) == NULL) {
+	perror(path.c_str());
+	exit(EXIT_FAILURE);
+    }
+
+    statement = string(nesting.inner).back() == ';';
+    fprintf(fp, "int f();\nint main(void)\n{\n    int x, *p;\n\n    ");
+
+    if (!statement)
+	fprintf(fp, "x = ");
+
+    for (i = 0; i < depth; i ++)
+	fputs(nesting.open, fp);
+
+    fputs(nesting.inner, fp);
+
+    for (i = 0; i < depth; i ++)
+	fputs(nesting.close, fp);
+
+    fprintf(fp, "%s\n    return x;\n}\n", statement ? "" : ";");
+    fclose(fp);
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Compile each kind of nesting at each depth and report how
+ *		the time grows.
+ */
+
+int main(int argc, char *argv[])
+{
+    double secs[3], growth;
+    const char *compiler;
+    unsigned depth, i, j;
+    bool failed = false;
+    string source;
+
+
+    depth = argc > 1 ? atoi(argv[1]) : 100000;
+    compiler = argc > 2 ? argv[2] : "./scc";
+
+    dir = scratch("deepbench");
+
+    source = dir + "/source.c";
+    printf("%-8s %10u %10u %10u   growth\n", "depth", depth / 4, depth / 2,
+	   depth);
+
+    for (i = 0; i < sizeof(nestings) / sizeof(nestings[0]); i ++) {
+	printf("%-8s", nestings[i].name);
+
+	for (j = 0; j < 3; j ++) {
+	    generate(source, nestings[i], depth >> (2 - j));
+	    secs[j] = compile({compiler}, source, "/dev/null");
+
+	    if (secs[j] < 0)
+		printf("     failed");
+	    else
+		printf(" %7.1f ms", secs[j] * 1e3);
+	}
+
+	if (secs[0] < 0 || secs[1] < 0 || secs[2] < 0) {
+	    printf("   FAILED\n");
+	    failed = true;
+	    continue;
+	}
+
+	growth = secs[2] / secs[1];
+	printf("   %5.2fx%s\n", growth, growth > MAX_GROWTH ? "  NONLINEAR" : "");
+	failed = failed || growth > MAX_GROWTH;
+    }
+
+    unlink(source.c_str());
+    rmdir(dir.c_str());
+    exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,295 @@
+/*
+ * File:	exprbench.cpp
+ *
+ * Description:	This file contains a benchmark for expression parsing in
+ *		Simple C.  A source file of expression statements is
+ *		generated and compiled by the real compiler in a child
+ *		process, with a type error in the first statement, so that
+ *		the bodies are parsed and checked but no code is generated.
+ *		A file with the same declarations but empty bodies is
+ *		compiled the same way, and the difference is the time spent
+ *		lexing, parsing, and checking the expressions, and is
+ *		reported per token.  This works with any version of the
+ *		compiler, so a second one can be given, such as one built
+ *		from the chain of functions, one for each level of
+ *		precedence, that the parser used before.  Both compilers
+ *		must produce the same assembly for the file without the
+ *		error, and the same diagnostic for the file with it.
+ *
+ *		There are two corpora: one of large expressions with many
+ *		operators, and one of small expressions that are mostly
+ *		single operands, which is where the chain does the most
+ *		work for the least result.
+ *
+ *		usage: exprbench [statements [compiler [other]]]
+ */
+
+# include <cstdio>
+# include <cstdlib>
+# include <string>
+# include <unistd.h>
+# include "harness.h"
+
+# define RUNS		5
+# define STATEMENTS	1000		/* statements in each function */
+
+using namespace std;
+
+static string dir;
+static unsigned long tokens;
+
+
+/*
+ * Function:	expression
+ *
+ * Description:	Write a random expression of at most the given depth.  At
+ *		each level, an operand stops being split with the given
+ *		probability in percent.  Every operand is an int, so that
+ *		the expression always checks.
+ */
+
+static void expression(FILE *fp, unsigned depth, int leaf)
+{
+    static const char *binary[] = {
+	"||", "&&", "==", "!=", "<", ">", "<=", ">=", "+", "-", "*", "/", "%",
+	"+", "-", "*", "+", "<", "==", "&&",
+    };
+
+    static const char *operands[] = {"a", "b", "c", "*p", "1", "42"};
+    static const char *prefix[] = {"!", "-"};
+    int k = rand() % 100;
+
+
+    if (depth == 0 || k < leaf) {
+	if (rand() % 8 == 0) {
+	    fputs(prefix[rand() % 2], fp);
+	    tokens ++;
+	}
+
+	if (rand() % 8 == 0) {
+	    fputs("v[", fp);
+	    expression(fp, depth > 2 ? 2 : depth, leaf);
+	    fputs("]", fp);
+	    tokens += 3;
+	} else {
+	    fputs(operands[rand() % 6], fp);
+	    tokens += 1;
+	}
+
+    } else if (k < leaf + 10) {
+	fputs("(", fp);
+	expression(fp, depth - 1, leaf);
+	fputs(")", fp);
+	tokens += 2;
+
+    } else {
+	expression(fp, depth - 1, leaf);
+	k = rand() % (sizeof(binary) / sizeof(binary[0]));
+	fprintf(fp, " %s ", binary[k]);
+	expression(fp, depth - 1, leaf);
+	tokens ++;
+    }
+}
+
+
+/*
+ * Function:	generate
+ *
+ * Description:	Write a source file with the given number of expression
+ *		statements, each assigned to a variable, in functions of a
+ *		thousand statements each, and count the tokens in them.
+ *		The first function starts with the given statement.  If
+ *		the bodies are not wanted, the functions are left empty
+ *		apart from that statement.
+ */
+
+static void generate(const string &path, unsigned count, unsigned depth,
+	int leaf, const char *opening, bool bodies)
+{
+    FILE *fp;
+    unsigned i;
+
+
+    if ((fp = fopen(path.c_str(), "w")) == NULL) {
+	perror(path.c_str());
+	exit(EXIT_FAILURE);
+    }
+
+    srand(1);
+    tokens = 0;
+    fprintf(fp, "int a, b, c, *p, v[10];\n");
+
+    for (i = 0; i < count; i ++) {
+	if (i % STATEMENTS == 0)
+	    fprintf(fp, "%sint f%u(int x)\n{\n%s\n", i > 0 ? "}\n\n" : "", i,
+		    i > 0 ? "" : opening);
+
+	if (bodies) {
+	    fputs("    x = ", fp);
+	    expression(fp, depth, leaf);
+	    fputs(";\n", fp);
+	    tokens += 3;
+	}
+    }
+
+    fprintf(fp, "%s", count > 0 ? "}\n" : "");
+    fclose(fp);
+}
+
+
+/*
+ * Function:	lines
+ *
+ * Description:	Return the number of lines in the given file.
+ */
+
+static unsigned lines(const string &path)
+{
+    unsigned count = 0;
+    FILE *fp;
+    int c;
+
+
+    if ((fp = fopen(path.c_str(), "r")) == NULL)
+	return 0;
+
+    while ((c = getc(fp)) != EOF)
+	count += c == '\n';
+
+    fclose(fp);
+    return count;
+}
+
+
+/*
+ * Function:	front
+ *
+ * Description:	Compile the given source file with the given compiler,
+ *		which generates no code for it, and keep the time taken if
+ *		it is the best so far.  Return false if the compiler failed
+ *		or did not report just the one error.
+ */
+
+static bool front(const char *compiler, const string &source,
+	const string &errors, double &best, bool first)
+{
+    string output;
+    double secs;
+
+
+    output = dir + "/front.s";
+    secs = compile({compiler}, source, output, errors);
+    unlink(output.c_str());
+
+    if (secs < 0 || lines(errors) != 1)
+	return false;
+
+    best = first || secs < best ? secs : best;
+    return true;
+}
+
+
+/*
+ * Function:	measure
+ *
+ * Description:	Time the compilers over a corpus and report the time per
+ *		token of each for the function bodies, as the difference
+ *		between compiling the file with them and the file without
+ *		them.  The runs of the two compilers are interleaved, so
+ *		that both see the same machine.  Return whether they both
+ *		succeeded and agreed, and whether the file without the
+ *		bodies was the faster for both, since otherwise nothing was
+ *		measured.
+ */
+
+static bool measure(const char *name, unsigned count, unsigned depth,
+	int leaf, const char *compiler, const char *other)
+{
+    string source, empty, errors, out[2], err[2];
+    const char *compilers[2];
+    double full[2], bare[2];
+    unsigned i, j, n;
+    bool failed;
+
+
+    source = dir + "/source.c";
+    empty = dir + "/empty.c";
+    errors = dir + "/empty.err";
+    out[0] = dir + "/compiler.s";
+    out[1] = dir + "/other.s";
+    err[0] = dir + "/compiler.err";
+    err[1] = dir + "/other.err";
+    compilers[0] = compiler;
+    compilers[1] = other;
+    n = other != NULL ? 2 : 1;
+
+    generate(source, count, depth, leaf, "", true);
+    failed = false;
+
+    for (j = 0; j < n && !failed; j ++)
+	failed = compile({compilers[j]}, source, out[j], err[j]) < 0 ||
+	    lines(err[j]) > 0 || !same(out[0], out[j]);
+
+    generate(empty, count, depth, leaf, "    x = *x;", false);
+    generate(source, count, depth, leaf, "    x = *x;", true);
+
+    for (i = 0; i < RUNS && !failed; i ++)
+	for (j = 0; j < n && !failed; j ++)
+	    failed = !front(compilers[j], source, err[j], full[j], i == 0) ||
+		!front(compilers[j], empty, errors, bare[j], i == 0);
+
+    for (j = 0; j < n && !failed; j ++)
+	failed = bare[j] >= full[j] || !same(err[0], err[j]);
+
+    printf("%-16s %9lu tokens", name, tokens);
+
+    if (failed)
+	printf("   FAILED\n");
+
+    else if (other == NULL)
+	printf("   %5.1f ns per token\n", (full[0] - bare[0]) * 1e9 / tokens);
+
+    else
+	printf("   %5.1f ns   other %5.1f ns   per token   speedup %4.2fx\n",
+	       (full[0] - bare[0]) * 1e9 / tokens,
+	       (full[1] - bare[1]) * 1e9 / tokens,
+	       (full[1] - bare[1]) / (full[0] - bare[0]));
+
+    unlink(source.c_str());
+    unlink(empty.c_str());
+    unlink(errors.c_str());
+
+    for (j = 0; j < 2; j ++) {
+	unlink(out[j].c_str());
+	unlink(err[j].c_str());
+    }
+
+    return !failed;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Benchmark both corpora.
+ */
+
+int main(int argc, char *argv[])
+{
+    const char *compiler, *other;
+    unsigned count;
+    bool passed;
+
+
+    count = argc > 1 ? atoi(argv[1]) : 200000;
+    compiler = argc > 2 ? argv[2] : "./scc";
+    other = argc > 3 ? argv[3] : NULL;
+
+    dir = scratch("exprbench");
+
+    passed = measure("operator-heavy", count / 4, 6, 20, compiler, other);
+    passed = measure("operand-heavy", count, 2, 70, compiler, other) && passed;
+
+    rmdir(dir.c_str());
+    exit(passed ? EXIT_SUCCESS : EXIT_FAILURE);
+}
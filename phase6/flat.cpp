@@ -0,0 +1,405 @@
+/*
+ * File:	flat.cpp
+ *
+ * Description:	This file contains the public and member function
+ *		definitions for flattening abstract syntax trees in Simple
+ *		C.
+ *
+ *		A node is flattened, by a visitor, by giving the slot it
+ *		was attached to its kind, type, and operand, and by
+ *		attaching each of its children in turn, which adds a slot
+ *		for each at the end of the arrays.  The slots are filled in
+ *		the order they were added, so no stack is needed, however
+ *		deep the tree.
+ *
+ *		The number of nodes flattened and their sizes, both flat
+ *		and as a tree, are kept so that they can be reported.
+ */
+
+# include <iomanip>
+# include "flat.h"
+# include "visitor.h"
+
+using namespace std;
+
+static unsigned long functions, nodes;
+static double flatBytes, treeBytes;
+
+/* The flattener is a visitor of the tree.  Its function for each class
+   flattens a node of that class into the given slot. */
+
+struct Flattener : NodeVisitor<Flattener> {
+    FlatTree &tree;
+    unsigned node;
+
+    Flattener(FlatTree &tree) : tree(tree), node(0) {}
+
+    void operator ()(const Function *function);
+    void operator ()(const Block *block);
+    void operator ()(const While *stmt);
+    void operator ()(const If *stmt);
+    void operator ()(const Return *stmt);
+    void operator ()(const Assignment *stmt);
+    void operator ()(const String *expr);
+    void operator ()(const Character *expr);
+    void operator ()(const Identifier *expr);
+    void operator ()(const Number *expr);
+    void operator ()(const Call *expr);
+    void operator ()(const Field *expr);
+    void operator ()(const Unary *expr);
+    void operator ()(const Binary *expr);
+};
+
+static const size_t sizes[] = {
+    sizeof(Function), sizeof(Block), sizeof(While), sizeof(If),
+    sizeof(Return), sizeof(Assignment), sizeof(String), sizeof(Character),
+    sizeof(Identifier), sizeof(Number), sizeof(Call), sizeof(Field),
+    sizeof(Not), sizeof(Negate), sizeof(Dereference), sizeof(Address),
+    sizeof(Cast), sizeof(Multiply), sizeof(Divide), sizeof(Remainder),
+    sizeof(Add), sizeof(Subtract), sizeof(LessThan), sizeof(GreaterThan),
+    sizeof(LessOrEqual), sizeof(GreaterOrEqual), sizeof(Equal),
+    sizeof(NotEqual), sizeof(LogicalAnd), sizeof(LogicalOr),
+};
+
+
+/*
+ * Function:	FlatTree::define
+ *
+ * Description:	Give the given node its kind, type, and operand.
+ */
+
+void FlatTree::define(unsigned node, Kind kind, const Type &type,
+	unsigned operand)
+{
+    unsigned handle;
+
+
+    for (handle = 0; handle < typeTable.size(); handle ++)
+	if (typeTable[handle] == type)
+	    break;
+
+    if (handle == typeTable.size())
+	typeTable.push_back(type);
+
+    kinds[node] = kind;
+    types[node] = handle;
+    operands[node] = operand;
+}
+
+
+/*
+ * Function:	FlatTree::attach
+ *
+ * Description:	Add a slot for the given child at the end of the tree, and
+ *		make it the next child of the given node.  The child is
+ *		flattened into its slot later.
+ */
+
+void FlatTree::attach(unsigned node, const Node *child)
+{
+    if (counts[node] ++ == 0)
+	firsts[node] = kinds.size();
+
+    kinds.push_back(Kind::Function);
+    firsts.push_back(0);
+    counts.push_back(0);
+    types.push_back(0);
+    operands.push_back(0);
+    sources.push_back(child);
+}
+
+
+/*
+ * Function:	FlatTree::symbol
+ *
+ * Description:	Add the given symbol to the table of symbols and return
+ *		its index.
+ */
+
+unsigned FlatTree::symbol(const Symbol *symbol)
+{
+    symbols.push_back(symbol);
+    return symbols.size() - 1;
+}
+
+
+/*
+ * Function:	FlatTree::name
+ *
+ * Description:	Add the given name to the table of names and return its
+ *		index.
+ */
+
+unsigned FlatTree::name(Name name)
+{
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+
+/*
+ * Function:	FlatTree::scope
+ *
+ * Description:	Add the given scope to the table of scopes and return its
+ *		index.
+ */
+
+unsigned FlatTree::scope(Scope *scope)
+{
+    scopes.push_back(scope);
+    return scopes.size() - 1;
+}
+
+
+/*
+ * Function:	FlatTree::type (accessor)
+ *
+ * Description:	Return the type of the given node.
+ */
+
+const Type &FlatTree::type(unsigned node) const
+{
+    return typeTable[types[node]];
+}
+
+
+/*
+ * Function:	flatten
+ *
+ * Description:	Flatten the given function into the given tree, replacing
+ *		whatever it held before.
+ */
+
+void flatten(const Function *function, FlatTree &tree)
+{
+    Flattener flattener(tree);
+    unsigned i;
+
+
+    tree.kinds.assign(1, Kind::Function);
+    tree.firsts.assign(1, 0);
+    tree.counts.assign(1, 0);
+    tree.types.assign(1, 0);
+    tree.operands.assign(1, 0);
+    tree.sources.assign(1, function);
+
+    tree.typeTable.clear();
+    tree.symbols.clear();
+    tree.names.clear();
+    tree.scopes.clear();
+
+    for (i = 0; i < tree.kinds.size(); i ++) {
+	flattener.node = i;
+	visit(tree.sources[i], flattener);
+	treeBytes += sizes[(unsigned) tree.kinds[i]];
+
+	if (tree.kinds[i] == Kind::Block || tree.kinds[i] == Kind::Call)
+	    treeBytes += tree.counts[i] * sizeof(Node *);
+    }
+
+    functions ++;
+    nodes += tree.kinds.size();
+
+    flatBytes += tree.kinds.size() * (sizeof(Kind) + 4 * sizeof(unsigned));
+    flatBytes += tree.typeTable.size() * sizeof(Type);
+    flatBytes += tree.symbols.size() * sizeof(const Symbol *);
+    flatBytes += tree.names.size() * sizeof(Name);
+    flatBytes += tree.scopes.size() * sizeof(Scope *);
+}
+
+
+/*
+ * Function:	writeTreeStats
+ *
+ * Description:	Write the number of nodes flattened so far, and how many
+ *		bytes each took, on average, both flat and as a tree.  The
+ *		bytes of a flat tree include its tables.
+ */
+
+void writeTreeStats(ostream &ostr)
+{
+    double count = nodes > 0 ? nodes : 1;
+
+
+    ostr << functions << " functions, " << nodes << " nodes, ";
+    ostr << fixed << setprecision(1) << flatBytes / count;
+    ostr << " bytes per node flat, " << treeBytes / count;
+    ostr << " bytes per node as a tree" << endl;
+}
+
+
+/*
+ * Function:	Flattener::operator () (Function)
+ *
+ * Description:	A function has its body as its only child, and the index
+ *		of its symbol as its operand.
+ */
+
+void Flattener::operator ()(const Function *function)
+{
+    tree.define(node, Kind::Function, Type(), tree.symbol(function->id()));
+    tree.attach(node, function->body());
+}
+
+
+/*
+ * Function:	Flattener::operator () (Block)
+ *
+ * Description:	A block has its statements as its children, and the index
+ *		of its scope as its operand.
+ */
+
+void Flattener::operator ()(const Block *block)
+{
+    const Statements &stmts = block->statements();
+
+
+    tree.define(node, Kind::Block, Type(), tree.scope(block->declarations()));
+
+    for (unsigned i = 0; i < stmts.size(); i ++)
+	tree.attach(node, stmts[i]);
+}
+
+
+/*
+ * Function:	Flattener::operator () (While)
+ *
+ * Description:	A while statement has its test and its statement as its
+ *		children.
+ */
+
+void Flattener::operator ()(const While *stmt)
+{
+    tree.define(node, Kind::While);
+    tree.attach(node, stmt->expr());
+    tree.attach(node, stmt->statement());
+}
+
+
+/*
+ * Function:	Flattener::operator () (If)
+ *
+ * Description:	An if statement has its test, its then part, and its else
+ *		part, if any, as its children.
+ */
+
+void Flattener::operator ()(const If *stmt)
+{
+    tree.define(node, Kind::If);
+    tree.attach(node, stmt->expr());
+    tree.attach(node, stmt->thenStatement());
+
+    if (stmt->elseStatement() != nullptr)
+	tree.attach(node, stmt->elseStatement());
+}
+
+
+/*
+ * Function:	Flattener::operator () (Return)
+ */
+
+void Flattener::operator ()(const Return *stmt)
+{
+    tree.define(node, Kind::Return);
+    tree.attach(node, stmt->expr());
+}
+
+
+/*
+ * Function:	Flattener::operator () (Assignment)
+ */
+
+void Flattener::operator ()(const Assignment *stmt)
+{
+    tree.define(node, Kind::Assignment);
+    tree.attach(node, stmt->left());
+    tree.attach(node, stmt->right());
+}
+
+
+/*
+ * Function:	Flattener::operator () (String)
+ *
+ * Description:	The literals and identifiers have no children.
+ */
+
+void Flattener::operator ()(const String *expr)
+{
+    tree.define(node, Kind::String, expr->type(), tree.name(expr->value()));
+}
+
+void Flattener::operator ()(const Character *expr)
+{
+    tree.define(node, Kind::Character, expr->type(), expr->value());
+}
+
+void Flattener::operator ()(const Identifier *expr)
+{
+    tree.define(node, Kind::Identifier, expr->type(),
+	tree.symbol(expr->symbol()));
+}
+
+void Flattener::operator ()(const Number *expr)
+{
+    tree.define(node, Kind::Number, expr->type(), expr->value());
+}
+
+
+/*
+ * Function:	Flattener::operator () (Call)
+ *
+ * Description:	A call has its arguments as its children, and the index
+ *		of the symbol called as its operand.
+ */
+
+void Flattener::operator ()(const Call *expr)
+{
+    const Expressions &args = expr->args();
+
+
+    tree.define(node, Kind::Call, expr->type(), tree.symbol(expr->id()));
+
+    for (unsigned i = 0; i < args.size(); i ++)
+	tree.attach(node, args[i]);
+}
+
+
+/*
+ * Function:	Flattener::operator () (Field)
+ */
+
+void Flattener::operator ()(const Field *expr)
+{
+    tree.define(node, Kind::Field, expr->type());
+    tree.attach(node, expr->expr());
+    tree.attach(node, expr->id());
+}
+
+
+/*
+ * Function:	Flattener::operator () (Unary)
+ *
+ * Description:	The unary expressions have their operand as their only
+ *		child.
+ */
+
+void Flattener::operator ()(const Unary *expr)
+{
+    tree.define(node, expr->kind(), expr->type());
+    tree.attach(node, expr->expr());
+}
+
+
+/*
+ * Function:	Flattener::operator () (Binary)
+ *
+ * Description:	The binary expressions have their left and right operands
+ *		as their children.
+ */
+
+void Flattener::operator ()(const Binary *expr)
+{
+    tree.define(node, expr->kind(), expr->type());
+    tree.attach(node, expr->left());
+    tree.attach(node, expr->right());
+}
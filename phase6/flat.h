@@ -0,0 +1,62 @@
+/*
+ * File:	flat.h
+ *
+ * Description:	This file contains the definitions for the flat form of
+ *		abstract syntax trees in Simple C.  A flat tree holds the
+ *		nodes of one function as a structure of arrays indexed by
+ *		node: the kind of each node, the index and number of its
+ *		children, a handle for its type, and its operand.  The
+ *		children of a node are always next to each other, so a
+ *		node needs only the index of its first child.  The root,
+ *		the function itself, is node zero.
+ *
+ *		The operand of a node depends on its kind: the value of a
+ *		number or character, and an index into the table of
+ *		symbols for an identifier, a call, or the function, into
+ *		the table of names for a string, or into the table of
+ *		scopes for a block.  The handle of a type is an index into
+ *		the table of types, in which each type appears once.
+ *
+ *		A function is flattened after it has been checked, in one
+ *		pass over its nodes in the order in which they are added,
+ *		and both storage allocation and code generation walk the
+ *		arrays rather than the tree.  A flat tree whose storage has
+ *		been allocated is also what a module holds for a function
+ *		(see module.h).
+ */
+
+# ifndef FLAT_H
+# define FLAT_H
+# include <climits>
+# include <ostream>
+# include <vector>
+# include "Tree.h"
+
+# define NO_NODE UINT_MAX
+
+struct FlatTree {
+    std::vector<Kind> kinds;
+    std::vector<unsigned> firsts, counts, types, operands;
+
+    std::vector<Type> typeTable;
+    std::vector<const Symbol *> symbols;
+    std::vector<Name> names;
+    std::vector<Scope *> scopes;
+
+    std::vector<const Node *> sources;
+
+    void define(unsigned node, Kind kind, const Type &type = Type(),
+	unsigned operand = 0);
+    void attach(unsigned node, const Node *child);
+    unsigned symbol(const Symbol *symbol);
+    unsigned name(Name name);
+    unsigned scope(Scope *scope);
+    const Type &type(unsigned node) const;
+};
+
+void flatten(const Function *function, FlatTree &tree);
+void allocate(const FlatTree &tree, int &offset);
+void generate(const FlatTree &tree, int offset);
+void writeTreeStats(std::ostream &ostr);
+
+# endif /* FLAT_H */
@@ -2,27 +2,47 @@
  * File:	generator.cpp
  *
  * Description:	This file contains the public and member function
- *		definitions for the code generator for Simple C.
+ *		definitions for the code generator for Simple C.  Code is
+ *		generated from the flat form of a tree, in which the
+ *		operand of each expression, where its value is found, is
+ *		kept in an array alongside the others.  The instructions
+ *		of a function are built as a list (see instruction.h), and
+ *		written through a buffered output object once it is done.
  *
  *		Extra functionality:
  *		- putting all the global declarations at the end
  */
 
-# include <sstream>
-# include <iostream>
+# include <string>
+# include <vector>
 # include "generator.h"
+# include "flat.h"
+# include "visitor.h"
+# include "module.h"
 # include "machine.h"
 # include "lexer.h"
+# include "instruction.h"
 
 using namespace std;
 
 int offset;
 static unsigned maxargs;
+static const FlatTree *tree;
+
+
+/* Where the value of an expression is found: on the stack, in a global
+   variable, in the instruction itself, or at a label.  The instructions
+   of a function are kept until it is done. */
+
+static vector<Operand> locations;
+static vector<int> labels;
+static Instructions code;
 
 struct Label{
 	static unsigned counter;
 	int number;
 	Label();
+	explicit Label(int n);
 };
 
 unsigned Label::counter=0;
@@ -31,536 +51,903 @@ Label::Label(){
 	number=counter++;
 }
 
+Label::Label(int n){
+	number=n;
+}
+
 Label GLabel;
 
-ostream &operator <<(ostream &ostr, Label L){
-	return ostr << ".L"<<L.number;
-}
 
 /*
- * Function:	operator <<
+ * Function:	emit
  *
- * Description:	Convenience function for writing the operand of an
- *		expression.
+ * Description:	Add an instruction with the given operands to the code of
+ *		the function, and return it.
  */
 
-
-ostream &operator <<(ostream &ostr, Expression *expr)
+static Instruction &emit(Opcode opcode)
 {
-    return ostr << expr->_operand;
+    code.push_back({opcode, 0, false, Operand(), Operand()});
+    return code.back();
 }
 
-void Expression::generate(){
-	cout<<"oops you didnt implement something"<<endl;
+static Instruction &emit(Opcode opcode, const Operand &first)
+{
+    code.push_back({opcode, 1, false, first, Operand()});
+    return code.back();
 }
-void Expression::generate(bool &indirect){
-	indirect=false;
-	generate();
+
+static Instruction &emit(Opcode opcode, const Operand &first,
+	const Operand &second)
+{
+    code.push_back({opcode, 2, false, first, second});
+    return code.back();
 }
+
+
 /*
- * Function:	Identifier::generate
+ * Function:	assignTempOffset
  *
- * Description:	Generate code for an identifier.  Since there is really no
- *		code to generate, we simply update our operand.
+ * Description:	Allocate a temporary on the stack for the value of the
+ *		given node, and make it the operand of the node.
  */
 
-void assignTempOffset(Expression *expr){
-	stringstream ss;
-	offset-=expr->type().size();
-	ss<<offset<<"(%ebp)";
-	expr->_operand=ss.str();
+static void assignTempOffset(unsigned node)
+{
+	offset-=tree->type(node).size();
+	locations[node] = memory(EBP, offset);
 }
 
-void Identifier::generate()
+
+/*
+ * Function:	indirect
+ *
+ * Description:	Return the node whose value is the address of the given
+ *		node, if the given node is indirect.  Generating that node
+ *		instead of the given one gives an operand that can be
+ *		stored through, without loading the value.
+ */
+
+static unsigned indirect(unsigned node)
 {
-    stringstream ss;
+    if (tree->kinds[node] == Kind::Dereference)
+	return tree->firsts[node];
 
+    return NO_NODE;
+}
+
+
+/* The code generator is a visitor of the flat tree.  Its member for each
+   kind of node takes the next step in generating code for a node of that
+   kind, and returns the child to generate next, if any.  Each step does
+   its work up to the next child. */
+
+struct Generator {
+    template <Kind K> unsigned visit(unsigned node, unsigned step);
+};
+
+
+template <>
+unsigned Generator::visit<Kind::Function>(unsigned node, unsigned step)
+{
+    unsigned first = tree->firsts[node];
 
-    if (_symbol->_offset != 0)
-	ss << _symbol->_offset << "(%ebp)";
-    else
-	ss << global_prefix << _symbol->name();
 
-    _operand = ss.str();
+    return step == 0 ? first : NO_NODE;
 }
 
 
-/*
- * Function:	Number::generate
- *
- * Description:	Generate code for a number.  Since there is really no code
- *		to generate, we simply update our operand.
- */
+template <>
+unsigned Generator::visit<Kind::Block>(unsigned node, unsigned step)
+{
+    unsigned first = tree->firsts[node], count = tree->counts[node];
+
+
+    return step < count ? first + step : NO_NODE;
+}
+
 
-void Number::generate()
+template <>
+unsigned Generator::visit<Kind::Identifier>(unsigned node, unsigned step)
 {
-    stringstream ss;
+    const Symbol *symbol;
 
 
-    ss << "$" << _value;
-    _operand = ss.str();
+    symbol = tree->symbols[tree->operands[node]];
+
+    if (symbol->_offset != 0)
+	locations[node] = memory(EBP, symbol->_offset);
+    else
+	locations[node] = global(symbol->name());
+
+    return NO_NODE;
 }
 
-void Character::generate()
+
+template <>
+unsigned Generator::visit<Kind::Number>(unsigned node, unsigned step)
 {
-	stringstream ss;
+    locations[node] = immediate(tree->operands[node]);
+    return NO_NODE;
+}
 
-	ss<< "$" << charval(_value);
-	_operand = ss.str();
+
+template <>
+unsigned Generator::visit<Kind::Character>(unsigned node, unsigned step)
+{
+	locations[node] = immediate((int) tree->operands[node]);
+	return NO_NODE;
 }
 
-void String::generate(){
-	stringstream ss;
+
+template <>
+unsigned Generator::visit<Kind::String>(unsigned node, unsigned step)
+{
 	Label B;
-	cout<<"\t.data\t"<<endl;
-	cout<<B<<":"<<" .asciz"<< value()<<endl;
-	cout<<"\t.text\t"<<endl;
-	ss<<B;
-	_operand=ss.str();
+	emit(DATA);
+	emit(ASCIZ, label(B.number), literal(tree->names[tree->operands[node]]));
+	emit(TEXT);
+	locations[node] = label(B.number);
+	return NO_NODE;
 }
 
+
 # if STACK_ALIGNMENT == 4
 
-/*
- * Function:	Call::generate
- *
- * Description:	Generate code for a function call expression, in which each
- *		argument is simply a variable or an integer literal.
- */
+/* The arguments of a call are generated and pushed from last to
+   first, one per step. */
 
-void Call::generate()
+template <>
+unsigned Generator::visit<Kind::Call>(unsigned node, unsigned step)
 {
-    unsigned numBytes = 0;
+    unsigned first = tree->firsts[node], count = tree->counts[node], numBytes;
+    const Operand &self = locations[node];
+    int i;
 
-	assignTempOffset(this);
-    for (int i = _args.size() - 1; i >= 0; i --) {
-	_args[i]->generate();
-	cout << "\tpushl\t" << _args[i] << endl;
-	numBytes += _args[i]->type().size();
-    }
 
-    cout << "\tcall\t" << global_prefix << _id->name() << endl;
-	
-	cout <<"\tmovl\t"<<"%eax, "<<this<<endl;
+    i = count - step;
+
+    if (step == 0)
+	assignTempOffset(node);
+    else
+	emit(PUSHL, locations[first + i]);
+
+    if (i > 0)
+	return first + i - 1;
+
+    numBytes = 0;
+
+    for (i = 0; i < (int) count; i ++)
+	numBytes += tree->type(first + i).size();
+
+    emit(CALL, symbol(tree->symbols[tree->operands[node]]->name()));
+    
+    emit(MOVL, EAX, self);
     if (numBytes > 0)
-	cout << "\taddl\t$" << numBytes << ", %esp" << endl;
+	emit(ADDL, immediate(numBytes), ESP);
+    return NO_NODE;
 }
 
+
 # else
 
-/*
- * If the stack has to be aligned to a certain size before a function call
- * then we cannot push the arguments in the order we see them.  If we had
- * nested function calls, we cannot guarantee that the stack would be
- * aligned.
- *
- * Instead, we must know the maximum number of arguments so we can compute
- * the size of the frame.  Again, we cannot just move the arguments onto
- * the stack as we see them because of nested function calls.  Rather, we
- * have to generate code for all arguments first and then move the results
- * onto the stack.  This will likely cause a lot of spills.
- *
- * For now, since each argument is going to be either a number of in
- * memory, we just load it into %eax and then move %eax onto the stack.
- */
+/* If the stack has to be aligned to a certain size before a function
+   call then we cannot push the arguments in the order we see them.
+   If we had nested function calls, we cannot guarantee that the
+   stack would be aligned.
+
+   Instead, we must know the maximum number of arguments so we can
+   compute the size of the frame.  Again, we cannot just move the
+   arguments onto the stack as we see them because of nested function
+   calls.  Rather, we have to generate code for all arguments first
+   and then move the results onto the stack.  This will likely cause a
+   lot of spills.
 
-void Call::generate()
+   For now, since each argument is going to be either a number of in
+   memory, we just load it into %eax and then move %eax onto the
+   stack. */
+
+template <>
+unsigned Generator::visit<Kind::Call>(unsigned node, unsigned step)
 {
-    if (_args.size() > maxargs)
-	maxargs = _args.size();
+    unsigned first = tree->firsts[node], count = tree->counts[node];
+    int i;
+
+
+    i = count - step;
+
+    if (step == 0 && count > maxargs)
+	maxargs = count;
 
-    for (int i = _args.size() - 1; i >= 0; i --) {
-	_args[i]->generate();
-	cout << "\tmovl\t" << _args[i] << ", %eax" << endl;
-	cout << "\tmovl\t%eax, " << i * SIZEOF_ARG << "(%esp)" << endl;
+    if (step > 0) {
+	emit(MOVL, locations[first + i], EAX);
+	emit(MOVL, EAX, memory(ESP, i * SIZEOF_ARG));
     }
 
-  	 cout << "\tcall\t" << global_prefix << _id->name() << endl;
+    if (i > 0)
+	return first + i - 1;
+
+    emit(CALL, symbol(tree->symbols[tree->operands[node]]->name()));
+    return NO_NODE;
 }
 
+
 # endif
 
+/* In an assignment, the right-hand side is an integer literal and
+   the left-hand side is an integer scalar variable.  Actually, the
+   way we've written things, the right-side can be a variable too. */
+
+template <>
+unsigned Generator::visit<Kind::Assignment>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1, ind;
+    const Operand &_left = locations[left], &_right = locations[right];
 
-/*
- * Function:	Assignment::generate
- *
- * Description:	Generate code for this assignment statement, in which the
- *		right-hand side is an integer literal and the left-hand
- *		side is an integer scalar variable.  Actually, the way
- *		we've written things, the right-side can be a variable too.
- */
 
-void Assignment::generate()
-{	bool indirect=false;
-	
-	_left->generate(indirect);
-    _right->generate();
-	if(indirect){
-		if(_left->type().size()==4){
-			cout<<"\tmovl\t"<<_right<<", %eax"<<endl;
-			cout<<"\tmovl\t"<<_left<<", %ecx"<<endl;
-			cout<<"\tmovl\t"<<"%eax, " << "(%ecx)"<<endl;
+	ind = indirect(left);
+
+	if(step==0)
+		return ind!=NO_NODE?ind:left;
+	if(step==1){
+		if(ind!=NO_NODE)
+			locations[left]=locations[ind];
+		return right;
+	}
+	if(ind!=NO_NODE){
+		if(tree->type(left).size()==4){
+			emit(MOVL, _right, EAX);
+			emit(MOVL, _left, ECX);
+			emit(MOVL, EAX, memory(ECX));
 		}
 
 		else{
-			cout<<"\tmovl\t"<<_right<<", %eax"<<endl;
-			cout<<"\tmovl\t"<<_left<<", %ecx"<<endl;
-			cout<<"\tmovb\t"<<"%al, (%ecx)"<<endl;
+			emit(MOVL, _right, EAX);
+			emit(MOVL, _left, ECX);
+			emit(MOVB, AL, memory(ECX));
 
 		}
 	}
 	else{
-		if(_left->type().size()==4){
-    		cout << "\tmovl\t" << _right << ", %eax" << endl;
-    		cout << "\tmovl\t%eax, " << _left << endl;
+		if(tree->type(left).size()==4){
+    		emit(MOVL, _right, EAX);
+    		emit(MOVL, EAX, _left);
 		}	
 
 		else{
-    		cout << "\tmovl\t" << _right << ", %eax" << endl;
-    		cout << "\tmovb\t%eax, " << _left << endl;
+    		emit(MOVL, _right, EAX);
+    		emit(MOVB, EAX, _left);
 		}
 	}
+	return NO_NODE;
 }
 
-/*Function Return::generate
- * Description: Generates code a return statement
- *
- */
-void Address::generate(){
-	bool indirect;
-	_expr->generate(indirect);
-	if(indirect){
-		_operand= _expr->_operand;
+
+template <>
+unsigned Generator::visit<Kind::Address>(unsigned node, unsigned step)
+{
+    unsigned first = tree->firsts[node], ind;
+    const Operand &_expr = locations[first], &self = locations[node];
+
+
+	ind = indirect(first);
+
+	if(step==0)
+		return ind!=NO_NODE?ind:first;
+	if(ind!=NO_NODE){
+		locations[node]=locations[ind];
 	}
 	else{
-		cout<<"\tleal \t" <<_expr<<", %eax"<<endl;
-		assignTempOffset(this);
-		cout<<"\tmovl\t%eax, "<<this<<endl;
+		emit(LEAL, _expr, EAX);
+		assignTempOffset(node);
+		emit(MOVL, EAX, self);
 	}
+	return NO_NODE;
 }
 
 
-void Dereference::generate(){
-	_expr->generate();
-	if(_type.size()==1){
-		cout<<"\tmovsbl\t(%eax), %eax" <<endl;
+template <>
+unsigned Generator::visit<Kind::Dereference>(unsigned node, unsigned step)
+{
+    unsigned first = tree->firsts[node];
+    const Operand &self = locations[node];
+
+
+	if(step==0)
+		return first;
+	if(tree->type(node).size()==1){
+		emit(MOVSBL, memory(EAX), EAX);
 	}
 	else
-		cout<<"\tmovl\t(%eax), %eax" <<endl;
-	assignTempOffset(this);
-	cout<<"\tmovl\t%eax, "<<this<<endl;
+		emit(MOVL, memory(EAX), EAX);
+	assignTempOffset(node);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
 }
-void Dereference::generate(bool &indirect){
-	indirect=true;
-	_expr->generate();
-	_operand=_expr->_operand;
+
+
+template <>
+unsigned Generator::visit<Kind::Return>(unsigned node, unsigned step)
+{
+    unsigned first = tree->firsts[node];
+    const Operand &_expr = locations[first];
+
+
+	if(step==0)
+		return first;
+	emit(MOVL, _expr, EAX);
+	emit(JMP, label(GLabel.number));
+	return NO_NODE;
 }
 
-void Return::generate(){
-	_expr->generate();
-	cout << "\tmovl\t" <<_expr<<", %eax"<< endl;
-	cout << "\tjmp\t"<<GLabel<<endl;
+
+template <>
+unsigned Generator::visit<Kind::Add>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
+
+
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(ADDL, _right, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
 }
 
-/*
- * Function:	Block::generate
- *
- * Description:	Generate code for this block, which simply means we
- *		generate code for each statement within the block.
- */
 
-void Block::generate()
+template <>
+unsigned Generator::visit<Kind::Subtract>(unsigned node, unsigned step)
 {
-    for (unsigned i = 0; i < _stmts.size(); i ++)
-	_stmts[i]->generate();
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
+
+
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(SUBL, _right, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
 }
 
 
-/*
- * Function:	Function::generate
- *
- * Description:	Generate code for this function, which entails allocating
- *		space for local variables, then emitting our prologue, the
- *		body of the function, and the epilogue.
- */
+template <>
+unsigned Generator::visit<Kind::Negate>(unsigned node, unsigned step)
+{
+    unsigned first = tree->firsts[node];
+    const Operand &_expr = locations[first], &self = locations[node];
 
-void Function::generate()
+
+	if(step==0)
+		return first;
+	assignTempOffset(node);
+	emit(MOVL, _expr, EAX);
+	emit(NEGL, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
+}
+
+
+template <>
+unsigned Generator::visit<Kind::Not>(unsigned node, unsigned step)
 {
-	Label A;
-	GLabel=A;
+    unsigned first = tree->firsts[node];
+    const Operand &_expr = locations[first], &self = locations[node];
 
-    offset = 0;
 
+	if(step==0)
+		return first;
+	assignTempOffset(node);
+	emit(MOVL, _expr, EAX);
+	emit(CMPL, immediate(0), EAX);
+	emit(SETE, AL);
+	emit(MOVZBL, AL, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
+}
 
-    /* Generate our prologue. */
 
-    allocate(offset);
-    cout << global_prefix << _id->name() << ":" << endl;
-    cout << "\tpushl\t%ebp" << endl;
-    cout << "\tmovl\t%esp, %ebp" << endl;
-    cout << "\tsubl\t$" << _id->name() << ".size, %esp" << endl;
+template <>
+unsigned Generator::visit<Kind::Remainder>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
 
 
-    /* Generate the body of this function. */
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(CLTD);
+	emit(IDIV, _right);
+	emit(MOVL, EDX, self);
+	return NO_NODE;
+}
 
-    maxargs = 0;
-    _body->generate();
 
-    offset -= maxargs * SIZEOF_ARG;
+template <>
+unsigned Generator::visit<Kind::Divide>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
 
-    while ((offset - PARAM_OFFSET) % STACK_ALIGNMENT)
-	offset --;
+
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(CLTD);
+	emit(IDIV, _right, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
+}
 
 
-    /* Generate our epilogue. */
-	cout <<GLabel<<":"<<endl;//MAKE GLOBAL LABEL
-    cout << "\tmovl\t%ebp, %esp" << endl;
-    cout << "\tpopl\t%ebp" << endl;
-    cout << "\tret" << endl << endl;
+template <>
+unsigned Generator::visit<Kind::Multiply>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
 
-    cout << "\t.globl\t" << global_prefix << _id->name() << endl;
-    cout << "\t.set\t" << _id->name() << ".size, " << -offset << endl;
 
-    cout << endl;
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(IMUL, _right, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
 }
 
 
-/*
- * Function:	generateGlobals
- *
- * Description:	Generate code for any global variable declarations.
- */
+template <>
+unsigned Generator::visit<Kind::LogicalOr>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
 
-void generateGlobals(const Symbols &globals)
+
+	if(step==0){
+		Label C;
+		labels[node]=C.number;
+		return left;
+	}
+	if(step==1){
+	assignTempOffset(node);
+	emit(CMPL, immediate(0), _left);
+	emit(JNE, label(labels[node]));//LABEL
+	return right;
+	}
+	emit(CMPL, immediate(0), _right);
+	emit(DEFINE, label(labels[node]));
+	emit(SETNE, AL);
+	emit(MOVZBL, AL, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
+}
+
+
+template <>
+unsigned Generator::visit<Kind::LogicalAnd>(unsigned node, unsigned step)
 {
-    if (globals.size() > 0)
-	cout << "\t.data" << endl;
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
 
-    for (unsigned i = 0; i < globals.size(); i ++) {
-	cout << "\t.comm\t" << global_prefix << globals[i]->name();
-	cout << ", " << globals[i]->type().size();
-	cout << ", " << globals[i]->type().alignment() << endl;
-    }
+
+	if(step==0){
+		Label C;
+		labels[node]=C.number;
+		return left;
+	}
+	if(step==1){
+	assignTempOffset(node);
+	emit(CMPL, immediate(0), _left);
+	emit(JE, label(labels[node]));//LABEL
+	return right;
+	}
+	emit(CMPL, immediate(0), _right);
+	emit(DEFINE, label(labels[node]));
+	emit(SETNE, AL);
+	emit(MOVZBL, AL, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
 }
 
-void Add::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\taddl\t"<<_right<<", %eax" <<endl;
-	cout<<"\tmovl\t%eax, "<< this << endl;
-
-}
-void Subtract::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\tsubl\t"<<_right<<", %eax" <<endl;
-	cout<<"\tmovl\t%eax, "<< this << endl;
-
-}
-
-void Negate::generate(){
-	_expr->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_expr<<", %eax"<<endl;
-	cout<<"\tnegl\t"<<"%eax"<<endl;
-	cout<<"\tmovl\t%eax, "<<this << endl;
-}
-
-void Not::generate(){
-	_expr->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_expr<<", %eax"<<endl;
-	cout<<"\tcmpl\t"<<"$0, %eax"<<endl;
-	cout<<"\tsete\t"<<"%al"<<endl;
-	cout<<"\tmovzbl\t"<<"%al, %eax"<<endl;
-	cout<<"\tmovl\t"<<"%eax, "<< this <<endl;	
-}
-
-void Remainder::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\tcltd\t"<<endl;
-	cout<<"\tidiv\t"<<_right<<endl;
-	cout<<"\tmovl\t%edx, "<< this << endl;
-}
-
-
-void Divide::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\tcltd\t"<<endl;
-	cout<<"\tidiv\t"<<_right<<", %eax" <<endl;
-	cout<<"\tmovl\t%eax, "<< this << endl;
-}
-void Multiply::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\timul\t"<<_right<<", %eax" <<endl;
-	cout<<"\tmovl\t%eax, "<< this << endl;
-}
-void LogicalOr::generate(){
-	Label C;
-	_left->generate();
-	assignTempOffset(this);
-	cout<<"\tcmpl\t$0, "<<_left<<endl;
-	cout<<"\tjne\t"<< C<<endl;//LABEL
-	_right->generate();
-	cout<<"\tcmpl\t$0, "<<_right<<endl;
-	cout<<C<<":"<<endl;
-	cout<<"\tsetne\t%al"<<endl;
-	cout<<"\tmovzbl\t%al, %eax"<<endl;
-	cout<<"\tmovl\t%eax, "<<this<<endl;
-}
-
-void LogicalAnd::generate(){
-	Label C;
-	_left->generate();
-	assignTempOffset(this);
-	cout<<"\tcmpl\t$0, "<<_left<<endl;
-	cout<<"\tje\t"<< C<< endl;//LABEL
-	_right->generate();
-	cout<<"\tcmpl\t$0, "<<_right<<endl;
-	cout<<C<<":"<<endl;
-	cout<<"\tsetne\t%al"<<endl;
-	cout<<"\tmovzbl\t%al, %eax"<<endl;
-	cout<<"\tmovl\t%eax, "<<this<<endl;
-}
-
-void Cast::generate(){
-	int src=_expr->type().size();
-	int des=_type.size();
-	_expr->generate();
+
+template <>
+unsigned Generator::visit<Kind::Cast>(unsigned node, unsigned step)
+{
+    unsigned first = tree->firsts[node];
+    const Operand &_expr = locations[first], &self = locations[node];
+    int src, des;
+
+
+	if(step==0)
+		return first;
+	src=tree->type(first).size();
+	des=tree->type(node).size();
 
 	if(des>src){
-		assignTempOffset(this);
-		cout<<"\tmovb\t"<<_expr<<", %al"<<endl;
-		cout<<"\tmovsbl\t"<<" %al, %eax"<<endl;
-		cout<<"\tmovl\t"<<"%eax, "<<this<<endl;
+		assignTempOffset(node);
+		emit(MOVB, _expr, AL);
+		emit(MOVSBL, AL, EAX).padded = true;
+		emit(MOVL, EAX, self);
 	}
 	else if(src>des){
-		assignTempOffset(this);
+		assignTempOffset(node);
 		//movl expr eax
 		//movb al this
-		cout<<"\tmovl\t"<<_expr<<", %eax"<<endl;
-		cout<<"\tmovb\t"<<"%al, "<< this<<endl;
+		emit(MOVL, _expr, EAX);
+		emit(MOVB, AL, self);
 	}
 	else{
-		assignTempOffset(this);
-		cout<<"\tmovl\t"<<_expr<<", %eax"<<endl;
-		cout<<"\tmovl\t"<<"%eax, "<< this<<endl;
+		assignTempOffset(node);
+		emit(MOVL, _expr, EAX);
+		emit(MOVL, EAX, self);
 	//	mol expr eax
 		//movl eax this
 	}
+	return NO_NODE;
 }
 
 
-void If::generate(){
+/* The children of an if statement are its test, its then part, and
+   its else part, if any, and those of a while statement are its test
+   and its statement. */
+
+template <>
+unsigned Generator::visit<Kind::If>(unsigned node, unsigned step)
+{
+    unsigned first = tree->firsts[node], count = tree->counts[node];
+    const Operand &_expr = locations[first];
+
+
+	if(step==0){
 	Label SKIP;
 	//Label *C=new Label();
 	Label ELSE;
-	_expr->generate();
-	cout<<"\tcmpl\t"<<"$0, "<<_expr<<endl;
-	if(_elseStmt ==nullptr){
-		cout<<"\tje\t"<<SKIP<<endl;
-		_thenStmt->generate();
-		cout<<SKIP<<":"<<endl;
+	labels[node]=SKIP.number;
+	return first;
+	}
+	Label SKIP(labels[node]), ELSE(labels[node]+1);
+	if(step==1){
+	emit(CMPL, immediate(0), _expr);
+	emit(JE, label((count<3?SKIP:ELSE).number));
+	return first+1;
+	}
+	if(count<3){
+		emit(DEFINE, label(SKIP.number));
+	}
+	else if(step==2){
+		emit(JMP, label(SKIP.number));
+		emit(DEFINE, label(ELSE.number));
+		return first+2;
 	}
 	else{
-		cout<<"\tje\t"<<ELSE<<endl;
-		_thenStmt->generate();	
-		cout<<"\tjmp\t"<<SKIP<<endl;
-		cout<<ELSE<<":"<<endl;
-		_elseStmt->generate();
-		cout<<SKIP<<":"<<endl;
+		emit(DEFINE, label(SKIP.number));
 	}
+	return NO_NODE;
 }
 
-void While::generate(){
+
+template <>
+unsigned Generator::visit<Kind::While>(unsigned node, unsigned step)
+{
+    unsigned first = tree->firsts[node];
+    const Operand &_expr = locations[first];
+
+
 	//Label *B=new Label();
 //	Label *C=new Label();
+	if(step==0){
 	Label LOOP;
 	Label EXIT;
-	cout<<LOOP<<":"<<endl;
-	_expr->generate();
-	cout<<"\tcmpl\t"<<"$0, "<<_expr<<endl;
-	cout<<"\tje\t"<<EXIT<<endl;
-	_stmt->generate();
-	cout<<"\tjmp\t"<<LOOP<<endl;
-	cout<<EXIT<<":"<<endl;
-}
-
-void LessThan::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\tcmpl\t%eax, "<<_right<<endl;
-	cout<<"\tsetl\t%al"<<endl;
-	cout<<"\tmovsbl\t%al, %eax"<<endl;
-	cout<<"\tmovl\t%eax, "<<this<<endl;
-}
-
-void GreaterThan::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\tcmpl\t%eax, "<<_right<<endl;
-	cout<<"\tsetg\t%al"<<endl;
-	cout<<"\tmovsbl\t%al, %eax"<<endl;
-	cout<<"\tmovl\t%eax, "<<this<<endl;
-}
-
-void GreaterOrEqual::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\tcmpl\t%eax, "<<_right<<endl;
-	cout<<"\tsetge\t%al"<<endl;
-	cout<<"\tmovsbl\t%al, %eax"<<endl;
-	cout<<"\tmovl\t%eax, "<<this<<endl;
-}
-
-void LessOrEqual::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\tcmpl\t%eax, "<<_right<<endl;
-	cout<<"\tsetle\t%al"<<endl;
-	cout<<"\tmovsbl\t%al, %eax"<<endl;
-	cout<<"\tmovl\t%eax, "<<this<<endl;
-}
-
-void Equal::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\tcmpl\t"<<_right<< ", %eax"<<endl;
-	cout<<"\tsete\t%al"<<endl;
-	cout<<"\tmovsbl\t%al, %eax"<<endl;
-	cout<<"\tmovl\t%eax, "<<this<<endl;
-}
-
-void NotEqual::generate(){
-	_left->generate();
-	_right->generate();
-	assignTempOffset(this);
-	cout<<"\tmovl\t"<<_left<<", %eax"<<endl;
-	cout<<"\tcmpl\t"<<_right<<", %eax"<<endl;
-	cout<<"\tsetne\t%al"<<endl;
-	cout<<"\tmovsbl\t%al, %eax"<<endl;
-	cout<<"\tmovl\t%eax, "<<this<<endl;
+	labels[node]=LOOP.number;
+	emit(DEFINE, label(LOOP.number));
+	return first;
+	}
+	Label LOOP(labels[node]), EXIT(labels[node]+1);
+	if(step==1){
+	emit(CMPL, immediate(0), _expr);
+	emit(JE, label(EXIT.number));
+	return first+1;
+	}
+	emit(JMP, label(LOOP.number));
+	emit(DEFINE, label(EXIT.number));
+	return NO_NODE;
+}
+
+
+template <>
+unsigned Generator::visit<Kind::LessThan>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
+
+
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(CMPL, EAX, _right);
+	emit(SETL, AL);
+	emit(MOVSBL, AL, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
+}
+
+
+template <>
+unsigned Generator::visit<Kind::GreaterThan>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
+
+
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(CMPL, EAX, _right);
+	emit(SETG, AL);
+	emit(MOVSBL, AL, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
+}
+
+
+template <>
+unsigned Generator::visit<Kind::GreaterOrEqual>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
+
+
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(CMPL, EAX, _right);
+	emit(SETGE, AL);
+	emit(MOVSBL, AL, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
+}
+
+
+template <>
+unsigned Generator::visit<Kind::LessOrEqual>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
+
+
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(CMPL, EAX, _right);
+	emit(SETLE, AL);
+	emit(MOVSBL, AL, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
+}
+
+
+template <>
+unsigned Generator::visit<Kind::Equal>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
+
+
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(CMPL, _right, EAX);
+	emit(SETE, AL);
+	emit(MOVSBL, AL, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
+}
+
+
+template <>
+unsigned Generator::visit<Kind::NotEqual>(unsigned node, unsigned step)
+{
+    unsigned left = tree->firsts[node], right = left + 1;
+    const Operand &_left = locations[left], &_right = locations[right];
+    const Operand &self = locations[node];
+
+
+	if(step==0)
+		return left;
+	if(step==1)
+		return right;
+	assignTempOffset(node);
+	emit(MOVL, _left, EAX);
+	emit(CMPL, _right, EAX);
+	emit(SETNE, AL);
+	emit(MOVSBL, AL, EAX);
+	emit(MOVL, EAX, self);
+	return NO_NODE;
+}
+
+
+template <Kind K>
+unsigned Generator::visit(unsigned node, unsigned step)
+{
+	emit(UNIMPLEMENTED);
+	return NO_NODE;
+}
+
+
+/*
+ * Function:	generateTree
+ *
+ * Description:	Generate code for the flat tree, walking it with an
+ *		explicit stack of nodes and their next steps.
+ */
+
+static void generateTree()
+{
+    static vector<unsigned> nodes, steps;
+    Generator generator;
+    unsigned node, child;
+
+
+    nodes.assign(1, 0);
+    steps.assign(1, 0);
+
+    while (!nodes.empty()) {
+	node = nodes.back();
+	child = dispatch(tree->kinds[node], generator, node, steps.back() ++);
+
+	if (child != NO_NODE) {
+	    nodes.push_back(child);
+	    steps.push_back(0);
+
+	} else {
+	    nodes.pop_back();
+	    steps.pop_back();
+	}
+    }
+}
+
+
+/*
+ * Function:	generate
+ *
+ * Description:	Generate code for the function in the given flat tree,
+ *		whose storage has already been allocated down to the given
+ *		offset, which entails emitting our prologue, the body of
+ *		the function, and the epilogue.
+ */
+
+void generate(const FlatTree &function, int frame)
+{
+	Label A;
+	GLabel=A;
+    Name name;
+
+
+    tree = &function;
+    name = tree->symbols[tree->operands[0]]->name();
+    offset = frame;
+
+
+    /* Generate our prologue. */
+
+    locations.assign(tree->kinds.size(), Operand());
+    labels.resize(tree->kinds.size());
+    code.clear();
+
+    emit(DEFINE, symbol(name));
+    emit(PUSHL, EBP);
+    emit(MOVL, ESP, EBP);
+    emit(SUBL, frameSize(name), ESP);
+
+
+    /* Generate the body of this function. */
+
+    maxargs = 0;
+    generateTree();
+
+    offset -= maxargs * SIZEOF_ARG;
+
+    while ((offset - PARAM_OFFSET) % STACK_ALIGNMENT)
+	offset --;
+
+
+    /* Generate our epilogue. */
+	emit(DEFINE, label(GLabel.number));//MAKE GLOBAL LABEL
+    emit(MOVL, EBP, ESP);
+    emit(POPL, EBP);
+    emit(RET);
+
+    writeInstructions(assembly, code);
+    assembly << '\n';
+
+    assembly << "\t.globl\t" << global_prefix << *name << '\n';
+    assembly << "\t.set\t" << *name << ".size, " << -offset << '\n';
+
+    assembly << '\n';
+}
+
+
+/*
+ * Function:	Function::generate
+ *
+ * Description:	Generate code for this function, which entails flattening
+ *		it and allocating space for local variables first.  The
+ *		allocated flat tree is recorded in the module being saved,
+ *		if any.
+ */
+
+void Function::generate()
+{
+    static FlatTree flat;
+    int frame = 0;
+
+
+    ::flatten(this, flat);
+    allocate(flat, frame);
+    recordFunction(flat, frame);
+    ::generate(flat, frame);
+}
+
+
+/*
+ * Function:	generateGlobals
+ *
+ * Description:	Generate code for any global variable declarations.
+ */
+
+void generateGlobals(const Symbols &globals)
+{
+    if (globals.size() > 0)
+	assembly << "\t.data" << '\n';
+
+    for (unsigned i = 0; i < globals.size(); i ++) {
+	assembly << "\t.comm\t" << global_prefix << *globals[i]->name();
+	assembly << ", " << globals[i]->type().size();
+	assembly << ", " << globals[i]->type().alignment() << '\n';
+    }
 }
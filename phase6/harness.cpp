@@ -0,0 +1,129 @@
+/*
+ * File:	harness.cpp
+ *
+ * Description:	This file contains the public function definitions for the
+ *		helpers shared by the benchmarks for Simple C.
+ */
+
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/wait.h>
+# include "harness.h"
+
+using namespace std;
+
+
+/*
+ * Function:	scratch
+ *
+ * Description:	Create a new directory under /tmp for the benchmark with
+ *		the given name and return its path, or exit if it cannot
+ *		be created.  The benchmark removes it when done.
+ */
+
+string scratch(const char *name)
+{
+    string dir;
+
+
+    dir = string("/tmp/") + name + "XXXXXX";
+
+    if (mkdtemp(&dir[0]) == NULL) {
+	perror(dir.c_str());
+	exit(EXIT_FAILURE);
+    }
+
+    return dir;
+}
+
+
+/*
+ * Function:	compile
+ *
+ * Description:	Run the compiler with the given arguments, the first of
+ *		which is the compiler itself, in a child process, reading
+ *		the given file, if any, and writing the given output and
+ *		error files, and return how long it took, or a negative
+ *		number if it failed.
+ */
+
+double compile(vector<const char *> args, const string &input,
+	const string &output, const string &errors)
+{
+    chrono::steady_clock::time_point start;
+    chrono::duration<double> secs;
+    int status, fd;
+    pid_t pid;
+
+
+    fflush(stdout);
+    args.push_back(NULL);
+    start = chrono::steady_clock::now();
+
+    if ((pid = fork()) == 0) {
+	if (!input.empty()) {
+	    if ((fd = open(input.c_str(), O_RDONLY)) < 0)
+		_exit(EXIT_FAILURE);
+
+	    dup2(fd, 0);
+	}
+
+	fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (fd < 0)
+	    _exit(EXIT_FAILURE);
+
+	dup2(fd, 1);
+
+	fd = open(errors.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (fd < 0)
+	    _exit(EXIT_FAILURE);
+
+	dup2(fd, 2);
+	execv(args[0], (char **) args.data());
+	_exit(EXIT_FAILURE);
+    }
+
+    waitpid(pid, &status, 0);
+    secs = chrono::steady_clock::now() - start;
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	return -1;
+
+    return secs.count();
+}
+
+
+/*
+ * Function:	same
+ *
+ * Description:	Return whether the two given files have the same contents.
+ */
+
+bool same(const string &a, const string &b)
+{
+    FILE *fp, *gp;
+    int c, d;
+
+
+    if ((fp = fopen(a.c_str(), "r")) == NULL)
+	return false;
+
+    if ((gp = fopen(b.c_str(), "r")) == NULL) {
+	fclose(fp);
+	return false;
+    }
+
+    do {
+	c = getc(fp);
+	d = getc(gp);
+    } while (c == d && c != EOF);
+
+    fclose(fp);
+    fclose(gp);
+    return c == d;
+}
@@ -0,0 +1,22 @@
+/*
+ * File:	harness.h
+ *
+ * Description:	This file contains the public function declarations for the
+ *		helpers shared by the benchmarks for Simple C, which run
+ *		the compiler in child processes on files they generate in
+ *		a scratch directory and compare the files it writes.
+ */
+
+# ifndef HARNESS_H
+# define HARNESS_H
+# include <string>
+# include <vector>
+
+std::string scratch(const char *name);
+
+double compile(std::vector<const char *> args, const std::string &input,
+	const std::string &output, const std::string &errors = "/dev/null");
+
+bool same(const std::string &a, const std::string &b);
+
+# endif /* HARNESS_H */
@@ -0,0 +1,140 @@
+/*
+ * File:	headerbench.cpp
+ *
+ * Description:	This file contains a benchmark for precompiled headers in
+ *		Simple C.  A prelude of many declarations and structures
+ *		is generated, along with a small unit that uses some of
+ *		them, and the prelude is saved as a header.  Then
+ *		compiling the prelude and the unit together is timed
+ *		against compiling the unit from the header, each in a
+ *		child process, and the two must produce the same assembly.
+ *
+ *		usage: headerbench [declarations [compiler]]
+ */
+
+# include <cstdio>
+# include <cstdlib>
+# include <string>
+# include <unistd.h>
+# include "harness.h"
+
+# define RUNS 5
+
+using namespace std;
+
+static string dir;
+
+
+/*
+ * Function:	generate
+ *
+ * Description:	Write a prelude with the given number of function
+ *		declarations, and a structure and a global variable for
+ *		every tenth of them, and a unit that uses a few of each.
+ */
+
+static void generate(const string &prelude, const string &unit,
+	unsigned count)
+{
+    FILE *fp;
+    unsigned i;
+
+
+    if ((fp = fopen(prelude.c_str(), "w")) == NULL) {
+	perror(prelude.c_str());
+	exit(EXIT_FAILURE);
+    }
+
+    fprintf(fp, "int printf();\n");
+
+    for (i = 0; i < count; i ++) {
+	if (i % 10 == 0) {
+	    fprintf(fp, "struct s%u { int a, b[%u]; struct s%u *next; };\n",
+		    i, i % 7 + 1, i);
+	    fprintf(fp, "struct s%u *g%u;\n", i, i);
+	}
+
+	fprintf(fp, "int f%u(), *h%u();\n", i, i);
+    }
+
+    fclose(fp);
+
+    if ((fp = fopen(unit.c_str(), "w")) == NULL) {
+	perror(unit.c_str());
+	exit(EXIT_FAILURE);
+    }
+
+    fprintf(fp, "int main(void)\n{\n    struct s0 x;\n\n");
+    fprintf(fp, "    x.a = f0() + f%u();\n", count - 1);
+    fprintf(fp, "    g0 = &x;\n    (*g0).next = g0;\n");
+    fprintf(fp, "    printf(\"%%d\\n\", (*g0).a + *h%u());\n", count / 2);
+    fprintf(fp, "    return 0;\n}\n");
+    fclose(fp);
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Save the header, then time the best of several
+ *		compilations with the prelude and with the header, and
+ *		report the speedup.
+ */
+
+int main(int argc, char *argv[])
+{
+    string prelude, unit, header, out1, out2;
+    double secs, cold = 0, load = 0;
+    const char *compiler;
+    unsigned count, i;
+    bool failed;
+
+
+    count = argc > 1 ? atoi(argv[1]) : 50000;
+    compiler = argc > 2 ? argv[2] : "./scc";
+
+    if (count == 0) {
+	fprintf(stderr, "usage: headerbench [declarations [compiler]]\n");
+	exit(EXIT_FAILURE);
+    }
+
+    dir = scratch("headerbench");
+
+    prelude = dir + "/prelude.c";
+    unit = dir + "/unit.c";
+    header = dir + "/prelude.pch";
+    out1 = dir + "/cold.s";
+    out2 = dir + "/header.s";
+
+    generate(prelude, unit, count);
+    failed = compile({compiler, "--save-header", header.c_str(),
+		      prelude.c_str()}, "", out1) < 0;
+
+    for (i = 0; i < RUNS && !failed; i ++) {
+	secs = compile({compiler, prelude.c_str(), unit.c_str()}, "", out1);
+	cold = i == 0 || secs < cold ? secs : cold;
+	failed = failed || secs < 0;
+
+	secs = compile({compiler, "--header", header.c_str(), unit.c_str()},
+		       "", out2);
+	load = i == 0 || secs < load ? secs : load;
+	failed = failed || secs < 0;
+    }
+
+    if (failed)
+	printf("%u declarations   FAILED\n", count);
+    else {
+	printf("%u declarations   prelude %7.1f ms   header %7.1f ms   "
+	       "speedup %4.2fx", count, cold * 1e3, load * 1e3, cold / load);
+	printf("%s\n", same(out1, out2) ? "" : "  MISMATCH");
+	failed = !same(out1, out2);
+    }
+
+    unlink(prelude.c_str());
+    unlink(unit.c_str());
+    unlink(header.c_str());
+    unlink(out1.c_str());
+    unlink(out2.c_str());
+    rmdir(dir.c_str());
+    exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
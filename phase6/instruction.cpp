@@ -0,0 +1,164 @@
+/*
+ * File:	instruction.cpp
+ *
+ * Description:	This file contains the public function definitions for
+ *		machine instructions in Simple C, which write them out in
+ *		the syntax of the GNU assembler.  The mnemonics are spelled
+ *		as the generator always wrote them, with a space after leal
+ *		and a tab after cltd.
+ */
+
+# include <cctype>
+# include <string>
+# include "instruction.h"
+# include "machine.h"
+
+using namespace std;
+
+static const char *const mnemonics[] = {
+    "movl", "movb", "movsbl", "movzbl", "leal ", "pushl", "popl", "addl",
+    "subl", "imul", "idiv", "negl", "cmpl", "cltd\t", "sete", "setne", "setl",
+    "setg", "setle", "setge", "jmp", "je", "jne", "call", "ret",
+};
+
+static const char *const registers[] = {
+    "", "%eax", "%ecx", "%edx", "%ebp", "%esp", "%al",
+};
+
+
+/*
+ * Function:	quote
+ *
+ * Description:	Return the given characters as a string literal for the
+ *		assembler, escaping anything that is not printable.  Octal
+ *		escapes always have three digits, so that a digit after one
+ *		is not taken as part of it.
+ */
+
+static string quote(const string &str)
+{
+    string s;
+    unsigned char c;
+
+
+    s += '"';
+
+    for (unsigned i = 0; i < str.size(); i ++) {
+	c = str[i];
+
+	if (c == '"' || c == '\\') {
+	    s += '\\';
+	    s += c;
+	} else if (c == '\n')
+	    s += "\\n";
+	else if (c == '\t')
+	    s += "\\t";
+	else if (isprint(c))
+	    s += c;
+	else {
+	    s += '\\';
+	    s += (char) ('0' + (c >> 6));
+	    s += (char) ('0' + (c >> 3 & 7));
+	    s += (char) ('0' + (c & 7));
+	}
+    }
+
+    s += '"';
+    return s;
+}
+
+
+/*
+ * Function:	operator <<
+ *
+ * Description:	Write the given operand.  The names of global variables
+ *		and symbols have the global prefix, but the sizes of frames,
+ *		which are local assembler symbols, do not.  A displacement
+ *		of zero is left out of a memory reference unless there is
+ *		nothing else.
+ */
+
+Output &operator <<(Output &out, const Operand &operand)
+{
+    if (operand.mode == Mode::Register)
+	out << registers[operand.base];
+
+    else if (operand.mode == Mode::Immediate)
+	out << '$' << operand.value;
+
+    else if (operand.mode == Mode::Frame)
+	out << '$' << *operand.name << ".size";
+
+    else if (operand.mode == Mode::Memory) {
+	if (operand.name != nullptr)
+	    out << global_prefix << *operand.name;
+
+	if (operand.value != 0 || (operand.name == nullptr &&
+		operand.base == NO_REGISTER && operand.index == NO_REGISTER))
+	    out << (operand.name != nullptr && operand.value > 0 ? "+" : "")
+		<< operand.value;
+
+	if (operand.base != NO_REGISTER || operand.index != NO_REGISTER) {
+	    out << '(' << registers[operand.base];
+
+	    if (operand.index != NO_REGISTER)
+		out << ',' << registers[operand.index] << ',' << operand.scale;
+
+	    out << ')';
+	}
+
+    } else if (operand.mode == Mode::Label)
+	out << ".L" << operand.value;
+
+    else if (operand.mode == Mode::Symbol)
+	out << global_prefix << *operand.name;
+
+    else if (operand.mode == Mode::String)
+	out << quote(*operand.name);
+
+    return out;
+}
+
+
+/*
+ * Function:	writeInstructions
+ *
+ * Description:	Write the given instructions, one to a line.  An operand
+ *		may be missing where the generator has nothing for it yet,
+ *		and is then written as nothing.
+ */
+
+void writeInstructions(Output &out, const Instructions &code)
+{
+    for (unsigned i = 0; i < code.size(); i ++) {
+	const Instruction &instruction = code[i];
+
+	if (instruction.opcode == DEFINE)
+	    out << instruction.first << ":\n";
+
+	else if (instruction.opcode == DATA)
+	    out << "\t.data\t\n";
+
+	else if (instruction.opcode == TEXT)
+	    out << "\t.text\t\n";
+
+	else if (instruction.opcode == ASCIZ)
+	    out << instruction.first << ": .asciz" << instruction.second
+		<< '\n';
+
+	else if (instruction.opcode == UNIMPLEMENTED)
+	    out << "oops you didnt implement something\n";
+
+	else {
+	    out << '\t' << mnemonics[instruction.opcode];
+
+	    if (instruction.count > 0)
+		out << (instruction.padded ? "\t " : "\t") << instruction.first;
+
+	    if (instruction.count > 1)
+		out << ", " << instruction.second;
+
+	    out << '\n';
+	}
+    }
+}
@@ -0,0 +1,126 @@
+/*
+ * File:	instruction.h
+ *
+ * Description:	This file contains the definitions for machine instructions
+ *		in Simple C.  The code generator builds the instructions of
+ *		a function as a list rather than writing them as text, and
+ *		writes them out only once the function is done, so that a
+ *		later pass can look at them and rewrite them first.
+ *
+ *		An instruction is an opcode and up to two operands, in the
+ *		order in which they are written, along with how many there
+ *		are.  An operand is a register; an immediate, which is a
+ *		value or the size of the frame of a function, a local
+ *		assembler symbol named after it; a memory reference with a
+ *		base, an index, a scale, and a displacement, or else a
+ *		global variable; a label; or a global symbol, such as the
+ *		function called.  The size of a frame is not interned as a
+ *		name of its own, since code is generated while function
+ *		bodies are still being parsed on other threads.  A few
+ *		pseudo-instructions define labels, put string literals in
+ *		the data section where they occur in the function, and mark
+ *		a node that the generator does not handle.
+ *
+ *		The text written is the same as when the generator wrote
+ *		it directly, down to its stray spaces and tabs, so that
+ *		its output can still be compared with that of earlier
+ *		phases.  A few mnemonics and pseudo-instructions are
+ *		spelled that way, and an instruction can be padded with an
+ *		extra space before its operands, as one always was.
+ */
+
+# ifndef INSTRUCTION_H
+# define INSTRUCTION_H
+# include <vector>
+# include "intern.h"
+# include "output.h"
+
+enum Register : unsigned char {
+    NO_REGISTER, EAX, ECX, EDX, EBP, ESP, AL
+};
+
+enum Opcode : unsigned char {
+    MOVL, MOVB, MOVSBL, MOVZBL, LEAL, PUSHL, POPL, ADDL, SUBL, IMUL, IDIV,
+    NEGL, CMPL, CLTD, SETE, SETNE, SETL, SETG, SETLE, SETGE, JMP, JE, JNE,
+    CALL, RET,
+
+    DEFINE, DATA, TEXT, ASCIZ, UNIMPLEMENTED
+};
+
+enum class Mode : unsigned char {
+    None, Register, Immediate, Frame, Memory, Label, Symbol, String
+};
+
+struct Operand {
+    Mode mode;
+    Register base, index;
+    unsigned char scale;
+    long value;
+    Name name;
+
+    Operand(Mode mode = Mode::None, long value = 0, Name name = nullptr)
+	: mode(mode), base(NO_REGISTER), index(NO_REGISTER), scale(1),
+	  value(value), name(name) {}
+
+    Operand(Register reg)
+	: mode(Mode::Register), base(reg), index(NO_REGISTER), scale(1),
+	  value(0), name(nullptr) {}
+};
+
+struct Instruction {
+    Opcode opcode;
+    unsigned char count;
+    bool padded;
+    Operand first, second;
+};
+
+typedef std::vector<Instruction> Instructions;
+
+
+/* Operands other than registers, which convert implicitly. */
+
+inline Operand immediate(long value)
+{
+    return Operand(Mode::Immediate, value);
+}
+
+inline Operand frameSize(Name function)
+{
+    return Operand(Mode::Frame, 0, function);
+}
+
+inline Operand memory(Register base, long displacement = 0,
+	Register index = NO_REGISTER, unsigned scale = 1)
+{
+    Operand operand(Mode::Memory, displacement);
+
+    operand.base = base;
+    operand.index = index;
+    operand.scale = scale;
+    return operand;
+}
+
+inline Operand global(Name name)
+{
+    return Operand(Mode::Memory, 0, name);
+}
+
+inline Operand label(unsigned number)
+{
+    return Operand(Mode::Label, number);
+}
+
+inline Operand symbol(Name name)
+{
+    return Operand(Mode::Symbol, 0, name);
+}
+
+inline Operand literal(Name name)
+{
+    return Operand(Mode::String, 0, name);
+}
+
+Output &operator <<(Output &out, const Operand &operand);
+void writeInstructions(Output &out, const Instructions &code);
+
+# endif /* INSTRUCTION_H */
@@ -0,0 +1,121 @@
+/*
+ * File:	intern.cpp
+ *
+ * Description:	This file contains the public and private function and
+ *		variable definitions for the string interning table for
+ *		Simple C.
+ *
+ *		The table is an open-addressing hash table with linear
+ *		probing, kept at most half full.  Each slot caches the full
+ *		hash value of its string, so that a probe only compares
+ *		characters when the hash values match.  Interned strings
+ *		are never freed, since names are kept in symbols and trees
+ *		for the entire compilation.
+ */
+
+# include <cstring>
+# include <vector>
+# include "intern.h"
+
+using namespace std;
+
+struct Slot {
+    unsigned hash;
+    Name name;
+};
+
+static vector<Slot> &table()
+{
+    static vector<Slot> slots(1024);
+    return slots;
+}
+
+static unsigned count;
+
+
+/*
+ * Function:	hashString
+ *
+ * Description:	Return the FNV-1a hash of the given characters.
+ */
+
+static unsigned hashString(const char *s, unsigned length)
+{
+    unsigned h = 2166136261u;
+
+    for (unsigned i = 0; i < length; i ++)
+	h = (h ^ (unsigned char) s[i]) * 16777619u;
+
+    return h;
+}
+
+
+/*
+ * Function:	grow
+ *
+ * Description:	Double the size of the table and reinsert every name.
+ */
+
+static void grow()
+{
+    vector<Slot> &slots = table();
+    vector<Slot> old(slots.size() * 2);
+    unsigned mask, i;
+
+
+    old.swap(slots);
+    mask = slots.size() - 1;
+
+    for (unsigned j = 0; j < old.size(); j ++)
+	if (old[j].name != nullptr) {
+	    for (i = old[j].hash & mask; slots[i].name != nullptr; i = (i + 1) & mask)
+		continue;
+
+	    slots[i] = old[j];
+	}
+}
+
+
+/*
+ * Function:	intern
+ *
+ * Description:	Return the name for the given characters, adding them to
+ *		the table if they aren't there already.
+ */
+
+Name intern(const char *s, unsigned length)
+{
+    vector<Slot> &slots = table();
+    unsigned h, mask, i;
+    Name name;
+
+
+    h = hashString(s, length);
+    mask = slots.size() - 1;
+
+    for (i = h & mask; slots[i].name != nullptr; i = (i + 1) & mask)
+	if (slots[i].hash == h && slots[i].name->size() == length &&
+		memcmp(slots[i].name->data(), s, length) == 0)
+	    return slots[i].name;
+
+    name = new string(s, length);
+    slots[i].hash = h;
+    slots[i].name = name;
+
+    if (++ count * 2 > slots.size())
+	grow();
+
+    return name;
+}
+
+
+/*
+ * Function:	intern
+ *
+ * Description:	Return the name for the given string.
+ */
+
+Name intern(const string &s)
+{
+    return intern(s.data(), s.size());
+}
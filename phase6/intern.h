@@ -0,0 +1,23 @@
+/*
+ * File:	intern.h
+ *
+ * Description:	This file contains the public function declarations for
+ *		the string interning table for Simple C.
+ *
+ *		Every distinct identifier is stored exactly once, and is
+ *		referred to by a name, which is simply a pointer to the
+ *		stored string.  Two names are equal exactly when their
+ *		pointers are equal, so symbols and scopes can compare names
+ *		without ever looking at their characters.
+ */
+
+# ifndef INTERN_H
+# define INTERN_H
+# include <string>
+
+typedef const std::string *Name;
+
+Name intern(const char *s, unsigned length);
+Name intern(const std::string &s);
+
+# endif /* INTERN_H */
@@ -0,0 +1,147 @@
+/*
+ * File:	keybench.cpp
+ *
+ * Description:	This file contains a microbenchmark for keyword
+ *		recognition in the lexical analyzer for Simple C.  The
+ *		perfect hash used by the lexical analyzer is compared
+ *		against the linear search of a table of strings that it
+ *		replaced, over a keyword-heavy corpus and an
+ *		identifier-heavy corpus.
+ *
+ *		usage: keybench [lexemes]
+ */
+
+# include <ctime>
+# include <cstdio>
+# include <cstdlib>
+# include <string>
+# include <vector>
+# include "lexer.h"
+# include "tokens.h"
+
+using namespace std;
+
+static string keywords[] = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do",
+    "double", "else", "enum", "extern", "float", "for", "goto", "if",
+    "int", "long", "register", "return", "short", "signed", "sizeof",
+    "static", "struct", "switch", "typedef", "union", "unsigned", "void",
+    "volatile", "while",
+};
+
+# define numKeywords (sizeof(keywords) / sizeof(keywords[0]))
+
+
+/* Identifiers that look like keywords, to make the hash work for its
+   living, and ordinary identifiers of the sort our generator produces. */
+
+static string identifiers[] = {
+    "autos", "brake", "cast", "chr", "constant", "dot", "doubled", "ele",
+    "enumerate", "fir", "goo", "iff", "it", "lung", "registers", "retain",
+    "sort", "sized", "stack", "switcher", "unions", "void_", "whale",
+    "n", "i", "value", "next", "function_with_long_name_1234", "g0", "gp12",
+    "arr", "str", "ch", "printf", "counter", "tmp", "result", "head",
+};
+
+# define numIdentifiers (sizeof(identifiers) / sizeof(identifiers[0]))
+
+
+/*
+ * Function:	linear
+ *
+ * Description:	Look up a lexeme the way the lexical analyzer used to,
+ *		with a linear search and a string comparison per keyword.
+ */
+
+static int linear(const string &lexeme)
+{
+    static const int tokens[] = {
+	AUTO, BREAK, CASE, CHAR, CONST, CONTINUE, DEFAULT, DO, DOUBLE, ELSE,
+	ENUM, EXTERN, FLOAT, FOR, GOTO, IF, INT, LONG, REGISTER, RETURN,
+	SHORT, SIGNED, SIZEOF, STATIC, STRUCT, SWITCH, TYPEDEF, UNION,
+	UNSIGNED, VOID, VOLATILE, WHILE,
+    };
+
+    for (unsigned i = 0; i < numKeywords; i ++)
+	if (keywords[i] == lexeme)
+	    return tokens[i];
+
+    return ID;
+}
+
+
+/*
+ * Function:	corpus
+ *
+ * Description:	Build a corpus in which the given percentage of lexemes
+ *		are keywords and the rest are identifiers.
+ */
+
+static void corpus(vector<string> &lexemes, unsigned count, int percent)
+{
+    lexemes.clear();
+
+    for (unsigned i = 0; i < count; i ++)
+	if (rand() % 100 < percent)
+	    lexemes.push_back(keywords[rand() % numKeywords]);
+	else
+	    lexemes.push_back(identifiers[rand() % numIdentifiers]);
+}
+
+
+/*
+ * Function:	measure
+ *
+ * Description:	Time both lookups over the corpus and report the results,
+ *		checking that they agree.
+ */
+
+static void measure(const char *name, const vector<string> &lexemes)
+{
+    clock_t start;
+    double hashed, searched;
+    unsigned long sum1 = 0, sum2 = 0;
+
+
+    start = clock();
+
+    for (unsigned i = 0; i < lexemes.size(); i ++)
+	sum1 += keyword(lexemes[i].data(), lexemes[i].size());
+
+    hashed = (double) (clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+
+    for (unsigned i = 0; i < lexemes.size(); i ++)
+	sum2 += linear(lexemes[i]);
+
+    searched = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%-16s hash %6.1f ns   linear %6.1f ns   speedup %5.1fx%s\n",
+	   name, hashed * 1e9 / lexemes.size(), searched * 1e9 / lexemes.size(),
+	   searched / hashed, sum1 != sum2 ? "  MISMATCH" : "");
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Benchmark both corpora.
+ */
+
+int main(int argc, char *argv[])
+{
+    unsigned count;
+    vector<string> lexemes;
+
+
+    count = argc > 1 ? atoi(argv[1]) : 10000000;
+    srand(1);
+
+    corpus(lexemes, count, 80);
+    measure("keyword-heavy", lexemes);
+
+    corpus(lexemes, count, 5);
+    measure("identifier-heavy", lexemes);
+
+    exit(EXIT_SUCCESS);
+}
@@ -9,22 +9,35 @@
 # include <cctype>
 # include <string>
 # include <cstdlib>
+# include <cstring>
 # include <climits>
 # include <iostream>
 # include "lexer.h"
+# include "source.h"
+# include "scan.h"
 # include "tokens.h"
 
 using namespace std;
-int numerrors, lineno = 1;
+int numerrors;
+__thread int lineno = 1;
+__thread vector<Diagnostic> *diagnostics;
+
+# define UNREAD (-2)
+
+static __thread int c = UNREAD;
 
 
 /* Yes, we could have used a map, but we'd probably initialize it with an
-   array anyway, and let's face it, it's pretty simple to search an array. */
+   array anyway.  Rather than search the array, though, we build a perfect
+   hash table for it at compile time, since every identifier is looked up
+   and identifiers are the most common token by far. */
 
-static struct {
-    string lexeme;
+struct Keyword {
+    const char *lexeme;
     int token;
-} keywords[] = {
+};
+
+static constexpr Keyword keywords[] = {
     {"auto",     AUTO},
     {"break",    BREAK},
     {"case",     CASE},
@@ -62,6 +75,107 @@ static struct {
 # define numKeywords (sizeof(keywords) / sizeof(keywords[0]))
 
 
+/* The hash function combines the length and the first and last characters
+   of a lexeme, with multipliers for the characters that are chosen when
+   the table is built so that no two keywords collide.  Each slot holds the
+   index and length of its keyword, so that a lookup costs one hash, one
+   length comparison, and at most one memcmp. */
+
+# define HASH_SIZE 128
+
+struct KeywordTable {
+    unsigned first, last;
+    unsigned char lengths[HASH_SIZE];
+    unsigned char slots[HASH_SIZE];
+};
+
+static constexpr unsigned hashKeyword(unsigned char first,
+	unsigned char last, unsigned length, unsigned a, unsigned b)
+{
+    return (first * a + last * b + length) % HASH_SIZE;
+}
+
+static constexpr unsigned length(const char *s)
+{
+    unsigned n = 0;
+
+    while (s[n] != '\0')
+	n ++;
+
+    return n;
+}
+
+
+/*
+ * Function:	buildKeywordTable
+ *
+ * Description:	Search for a pair of multipliers that hash every keyword to
+ *		a different slot, and return the resulting table.  This is
+ *		evaluated entirely at compile time.
+ */
+
+static constexpr KeywordTable buildKeywordTable()
+{
+    KeywordTable table = {};
+    const char *s = nullptr;
+    unsigned h = 0, n = 0, i = 0;
+    bool perfect = false;
+
+
+    for (unsigned a = 1; a < HASH_SIZE; a ++)
+	for (unsigned b = 1; b < HASH_SIZE; b ++) {
+	    for (h = 0; h < HASH_SIZE; h ++)
+		table.lengths[h] = 0;
+
+	    perfect = true;
+
+	    for (i = 0; i < numKeywords && perfect; i ++) {
+		s = keywords[i].lexeme;
+		n = length(s);
+		h = hashKeyword(s[0], s[n - 1], n, a, b);
+		perfect = table.lengths[h] == 0;
+		table.lengths[h] = n;
+		table.slots[h] = i;
+	    }
+
+	    if (perfect) {
+		table.first = a;
+		table.last = b;
+		return table;
+	    }
+	}
+
+    return table;
+}
+
+static constexpr KeywordTable table = buildKeywordTable();
+static_assert(table.first != 0, "no perfect hash found for the keywords");
+
+
+/*
+ * Function:	keyword
+ *
+ * Description:	Return the token for the given lexeme if it is a keyword,
+ *		and ID otherwise.
+ */
+
+int keyword(const char *s, unsigned n)
+{
+    unsigned h;
+
+
+    h = hashKeyword(s[0], s[n - 1], n, table.first, table.last);
+
+    if (table.lengths[h] != n)
+	return ID;
+
+    if (memcmp(keywords[table.slots[h]].lexeme, s, n) != 0)
+	return ID;
+
+    return keywords[table.slots[h]].token;
+}
+
+
 /*
  * Function:	report
  *
@@ -70,285 +184,466 @@ static struct {
  *		optional string argument, but C++'s stupid streams don't do
  *		positional arguments, so we actually resort to snprintf.
  *		You just can't beat C for doing things down and dirty.
+ *
+ *		If diagnostics are being collected, the error is saved
+ *		instead, so that it can be reported later, and it is not
+ *		counted until then.
  */
 
 void report(const string &str, const string &arg)
 {
     char buf[1000];
+    Diagnostic diagnostic;
+
 
     snprintf(buf, sizeof(buf), str.c_str(), arg.c_str());
-    cerr << "line " << lineno << ": " << buf << endl;
-    numerrors ++;
+
+    if (diagnostics != nullptr) {
+	diagnostic.line = lineno;
+	diagnostic.message = buf;
+	diagnostics->push_back(diagnostic);
+    } else {
+	cerr << "line " << lineno << ": " << buf << endl;
+	numerrors ++;
+    }
 }
 
 
+/* The lexical analyzer is driven by tables built at compile time.  Every
+   character (and EOF) belongs to a class, which selects how the token
+   starting with it is recognized.  Operators and other punctuation are
+   recognized by a small automaton: the first character of an operator
+   selects a state, and each state has a transition on the second
+   character that either accepts a two-character operator or yields zero,
+   in which case the first character is a token by itself.  Since EOF is
+   -1, the class and state tables are indexed by the character plus one. */
+
+enum { END, BLANK, LETTER, DIGIT, SLASH, DQUOTE, SQUOTE, PUNCT };
+
+static constexpr Keyword operators[] = {
+    {"||", OR},  {"&&", AND}, {"==", EQL}, {"!=", NEQ}, {"<=", LEQ},
+    {">=", GEQ}, {"->", ARROW}, {"++", INC}, {"--", DEC},
+
+    {"=", '='},  {"&", '&'},  {"!", '!'},  {"<", '<'},  {">", '>'},
+    {"-", '-'},  {"+", '+'},  {"*", '*'},  {"%", '%'},  {":", ':'},
+    {";", ';'},  {"(", '('},  {")", ')'},  {"[", '['},  {"]", ']'},
+    {"{", '{'},  {"}", '}'},  {".", '.'},  {",", ','},
+};
+
+# define numOperators (sizeof(operators) / sizeof(operators[0]))
+# define MAX_STATES 16
+
+struct LexerTable {
+    unsigned nstates;
+    unsigned char classes[257];
+    unsigned char states[257];
+    int tokens[256];
+    int transitions[MAX_STATES][MAX_STATES];
+};
+
+
 /*
- * Function:	lexan
+ * Function:	buildLexerTable
  *
- * Description:	Read and tokenize the standard input stream.  The lexeme is
- *		stored in a buffer.
+ * Description:	Build the character class table and the operator automaton.
+ *		Every character that appears in a two-character operator
+ *		is given its own state.  This is evaluated entirely at
+ *		compile time.
  */
 
-int lexan(string &lexbuf)
+static constexpr LexerTable buildLexerTable()
 {
-    int p;
-    unsigned i;
-    static int c = cin.get();
+    LexerTable table = {};
+    const char *s = nullptr;
+    unsigned nstates = 1;
+    int c = 0;
+
+
+    for (c = 0; c < 256; c ++) {
+	table.tokens[c] = ERROR;
+
+	if (c == ' ' || (c >= '\t' && c <= '\r'))
+	    table.classes[c + 1] = BLANK;
+	else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+	    table.classes[c + 1] = LETTER;
+	else if (c >= '0' && c <= '9')
+	    table.classes[c + 1] = DIGIT;
+	else if (c == '/')
+	    table.classes[c + 1] = SLASH;
+	else if (c == '"')
+	    table.classes[c + 1] = DQUOTE;
+	else if (c == '\'')
+	    table.classes[c + 1] = SQUOTE;
+	else
+	    table.classes[c + 1] = PUNCT;
+    }
 
+    table.classes[EOF + 1] = END;
 
-    /* The invariant here is that the next character has already been read
-       and is ready to be classified.  In this way, we eliminate having to
-       push back characters onto the stream, merely to read them again. */
+    for (unsigned i = 0; i < numOperators; i ++) {
+	s = operators[i].lexeme;
 
-    while (!cin.eof()) {
-	lexbuf.clear();
+	if (s[1] == '\0') {
+	    table.tokens[(unsigned char) s[0]] = operators[i].token;
+	    continue;
+	}
 
+	for (unsigned j = 0; j < 2; j ++)
+	    if (table.states[(unsigned char) s[j] + 1] == 0)
+		table.states[(unsigned char) s[j] + 1] = nstates ++;
 
-	/* Ignore white space */
+	table.transitions[table.states[(unsigned char) s[0] + 1]]
+	    [table.states[(unsigned char) s[1] + 1]] = operators[i].token;
+    }
 
-	while (isspace(c)) {
-	    if (c == '\n')
-		lineno ++;
+    table.nstates = nstates;
+    return table;
+}
 
-	    c = cin.get();
-	}
+static constexpr LexerTable lextab = buildLexerTable();
+static_assert(lextab.nstates <= MAX_STATES, "too many operator states");
 
 
-	/* Check for an identifier or a keyword */
+/*
+ * Function:	classify
+ *
+ * Description:	Return the class of a character, which may also be EOF.
+ */
 
-	if (isalpha(c) || c == '_') {
-	    do {
-		lexbuf += c;
-		c = cin.get();
-	    } while (isalnum(c) || c == '_');
+static inline int classify(int c)
+{
+    return lextab.classes[c + 1];
+}
 
-	    for (i = 0; i < numKeywords; i ++)
-		if (keywords[i].lexeme == lexbuf)
-		    return keywords[i].token;
 
-	    return ID;
+/*
+ * Function:	next
+ *
+ * Description:	Return the next character from the source buffer.  The
+ *		buffer is terminated by a null character, so we only need
+ *		to check the limit when we see one.
+ */
 
+static inline int next()
+{
+    int c = (unsigned char) *cursor;
 
-	/* Check for a number */
+    if (c == '\0' && cursor == limit)
+	return fillSource();
 
-	} else if (isdigit(c)) {
-	    do {
-		lexbuf += c;
-		c = cin.get();
-	    } while (isdigit(c));
+    cursor ++;
+    return c;
+}
 
-	    return NUM;
 
+/*
+ * Function:	finish
+ *
+ * Description:	Finish the token that starts at the mark and ends just
+ *		before the given position in the source buffer.
+ */
 
-	/* There must be an easier way to do this.  It might seem stupid at
-	   this point to recognize each token separately, but eventually
-	   we'll be returning separate token values to the parser, so we
-	   might as well do it now. */
+static inline int finish(Token &token, int kind, const char *end)
+{
+    token.kind = kind;
+    token.lexeme.text = mark;
+    token.lexeme.length = end - mark;
+    return kind;
+}
 
-	} else {
-	    lexbuf += c;
 
-	    switch(c) {
+/*
+ * Function:	complain
+ *
+ * Description:	Report a lexical error, or save it for the caller to report
+ *		if the lexical analyzer is running on a worker thread.
+ */
 
+static inline void complain(const char *str, bool deferred, const char *&error)
+{
+    if (deferred)
+	error = str;
+    else
+	report(str);
+}
 
-	    /* Check for '||' */
 
-	    case '|':
-		c = cin.get();
+/*
+ * Function:	scan
+ *
+ * Description:	Read and tokenize the source buffer.  The lexeme is not
+ *		copied, but refers to the text in the source buffer.  This
+ *		is the body of both lexan() and lexanDeferred(), and is
+ *		inlined into each, so the flag costs nothing.
+ */
 
-		if (c == '|') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return OR;
-		}
+static inline int scan(Token &token, bool deferred, const char *&error)
+{
+    int p, first, kind;
+    long number;
 
-		return ERROR;
 
+    if (c == UNREAD)
+	c = next();
 
-	    /* Check for '=' and '==' */
+    /* The invariant here is that the next character has already been read
+       and is ready to be classified.  In this way, we eliminate having to
+       push back characters onto the stream, merely to read them again.
+       The character is always just before the cursor, so the mark is set
+       there when a token starts, and the source keeps everything from the
+       mark onward contiguous if it must be refilled. */
 
-	    case '=':
-		c = cin.get();
+    while (c != EOF) {
+	mark = nullptr;
 
-		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return EQL;
-		}
 
-		return '=';
+	/* Ignore white space.  The character we've already read is
+	   counted here, and the rest of the run is skipped by the
+	   scanner, which stops at the null character at the limit. */
 
+	while (classify(c) == BLANK) {
+	    if (c == '\n')
+		lineno ++;
 
-	    /* Check for '&' and '&&' */
+	    cursor = scanner->space(cursor, lineno);
+	    c = next();
+	}
 
-	    case '&':
-		c = cin.get();
+	mark = cursor - 1;
 
-		if (c == '&') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return AND;
-		}
+	switch (classify(c)) {
 
-		return '&';
 
+	/* Check for an identifier or a keyword */
 
-	    /* Check for '!' and '!=' */
+	case LETTER:
+	    do {
+		cursor = scanner->identifier(cursor);
+		c = next();
+	    } while (classify(c) == LETTER || classify(c) == DIGIT);
 
-	    case '!':
-		c = cin.get();
+	    finish(token, ID, cursor - 1);
+	    token.kind = keyword(token.lexeme.text, token.lexeme.length);
 
-		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return NEQ;
-		}
+	    if (token.kind == ID)
+		token.name = deferred ? nullptr :
+		    intern(token.lexeme.text, token.lexeme.length);
 
-		return '!';
+	    return token.kind;
 
 
-	    /* Check for '<' and '<=' */
+	/* Check for a number */
 
-	    case '<':
-		c = cin.get();
+	case DIGIT:
+	    do {
+		cursor = scanner->digits(cursor);
+		c = next();
+	    } while (classify(c) == DIGIT);
 
-		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return LEQ;
-		}
+	    finish(token, NUM, cursor - 1);
 
-		return '<';
+	    if ((number = numval(token.lexeme)) == -1)
+		complain("invalid integer constant", deferred, error);
 
+	    token.value = number != -1 ? number : 0;
+	    return NUM;
 
-	    /* Check for '>' and '>=' */
 
-	    case '>':
-		c = cin.get();
+	/* Check for an operator or other punctuation.  The first
+	   character puts us in a state, and the transition on the
+	   second character either accepts a two-character operator or
+	   leaves us with the token for the first character alone.
+	   Illegal characters are simply single-character errors. */
 
-		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return GEQ;
-		}
+	case PUNCT:
+	    first = c;
+	    c = next();
+	    kind = lextab.transitions[lextab.states[first + 1]][lextab.states[c + 1]];
+
+	    if (kind != 0) {
+		c = next();
+		return finish(token, kind, cursor - 1);
+	    }
+
+	    return finish(token, lextab.tokens[first], cursor - 1);
 
-		return '>';
 
+	/* Check for '/' or a comment */
 
-	    /* Check for '-', '--', and '->' */
+	case SLASH:
+	    c = next();
 
-	    case '-':
-		c = cin.get();
+	    if (c != '*')
+		return finish(token, '/', cursor - 1);
 
-		if (c == '-') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return DEC;
+	    mark = nullptr;
 
-		} else if (c == '>') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return ARROW;
+	    do {
+		while (c != '*' && c != EOF) {
+		    if (c == '\n')
+			lineno ++;
+
+		    cursor = scanner->comment(cursor, lineno);
+		    c = next();
 		}
 
-		return '-';
+		c = next();
+	    } while (c != '/' && c != EOF);
+
+	    c = next();
+	    break;
 
 
-	    /* Check for '+' and '++' */
+	/* Check for a string literal.  The token is finished before
+	   reading past the closing quote, since a malformed literal
+	   may run into the next file, and a newline that ends one is
+	   left to be counted. */
 
-	    case '+':
-		c = cin.get();
+	case DQUOTE:
+	    do {
+		p = c;
 
-		if (c == '+') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return INC;
+		if (p != '\\') {
+		    cursor = scanner->string(cursor, '"');
+		    p = cursor[-1];
 		}
 
-		return '+';
+		c = next();
+	    } while ((c != '"' || p == '\\') && c != '\n' && c != EOF);
+
+	    if (c == '\n' || c == EOF)
+		complain("malformed string literal", deferred, error);
 
+	    finish(token, STRING, cursor);
+	    token.name = deferred ? nullptr : strval(token.lexeme);
 
-	    /* Check for simple, single character tokens */
+	    if (c != '\n')
+		c = next();
 
-	    case '*': case '%': case ':': case ';':
-	    case '(': case ')': case '[': case ']':
-	    case '{': case '}': case '.': case ',':
-		c = cin.get();
-		return lexbuf[0];
+	    return STRING;
 
 
-	    /* Check for '/' or a comment */
+	/* Check for a character literal */
+
+	case SQUOTE:
+	    do {
+		p = c;
+		c = next();
+	    } while ((c != '\'' || p == '\\') && c != '\n' && c != EOF);
 
-	    case '/':
-		c = cin.get();
+	    finish(token, CHARACTER, cursor);
 
-		if (c == '*') {
-		    do {
-			while (c != '*' && !cin.eof()) {
-			    if (c == '\n')
-				lineno ++;
+	    if (c == '\n' || c == EOF)
+		number = -1;
+	    else
+		number = charval(string(mark, cursor - mark));
 
-			    c = cin.get();
-			}
+	    if (number == -1)
+		complain("malformed character literal", deferred, error);
 
-			c = cin.get();
-		    } while (c != '/' && !cin.eof());
+	    token.value = number != -1 ? number : 0;
 
-		    c = cin.get();
-		    break;
+	    if (c != '\n')
+		c = next();
 
-		} else
-		    return '/';
+	    return CHARACTER;
 
 
-	    /* Check for a string literal */
+	/* Handle EOF here as well */
+
+	case END:
+	    break;
+	}
+    }
 
-	    case '"':
-		do {
-		    p = c;
-		    c = cin.get();
-		    lexbuf += c;
-		} while ((c != '"' || p == '\\') && c != '\n' && !cin.eof());
+    token.kind = DONE;
+    token.lexeme.text = "";
+    token.lexeme.length = 0;
+    return DONE;
+}
+
+
+/*
+ * Function:	lexan
+ *
+ * Description:	Read and tokenize the source buffer.  For an identifier,
+ *		its interned name is also returned, so the parser never
+ *		needs to copy the lexeme.
+ */
 
-		if (c == '\n' || cin.eof())
-		    report("malformed string literal");
+int lexan(Token &token)
+{
+    const char *error;
 
-		c = cin.get();
-		return STRING;
+    return scan(token, false, error);
+}
 
 
-	    /* Check for a character literal */
+/*
+ * Function:	lexanDeferred
+ *
+ * Description:	Read and tokenize the source buffer on a worker thread.
+ *		Identifiers and strings are not interned, since the table is
+ *		not shared between threads, and an error is returned rather
+ *		than reported, since it would be reported out of order.
+ */
 
-	    case '\'':
-		do {
-		    p = c;
-		    c = cin.get();
-		    lexbuf += c;
-		} while ((c != '\'' || p == '\\') && c != '\n' && !cin.eof());
+int lexanDeferred(Token &token, const char *&error)
+{
+    error = nullptr;
+    return scan(token, true, error);
+}
 
-		if (c == '\n' || cin.eof() || charval(lexbuf) == -1)
-		    report("malformed character literal");
 
-		c = cin.get();
-		return CHARACTER;
+/*
+ * Function:	restartLexer
+ *
+ * Description:	Forget the character already read, so that the next token
+ *		is read starting at the cursor.
+ */
 
+void restartLexer()
+{
+    c = UNREAD;
+}
 
-	    /* Handle EOF here as well */
 
-	    case EOF:
-		return DONE;
+/*
+ * Function:	saveLexer
+ *
+ * Description:	Save the character already read and the line number, which
+ *		along with the source buffer are all the state there is.
+ */
 
+void saveLexer(LexerState &state)
+{
+    state.next = c;
+    state.line = lineno;
+}
 
-	    /* Everything else is illegal */
 
-	    default:
-		c = cin.get();
-		return ERROR;
-	    }
-	}
-    }
+/*
+ * Function:	restoreLexer
+ *
+ * Description:	Restore the character already read and the line number.
+ */
 
-    return DONE;
+void restoreLexer(const LexerState &state)
+{
+    c = state.next;
+    lineno = state.line;
+}
+
+
+/*
+ * Function:	operator <<
+ *
+ * Description:	Write a lexeme to the given stream.
+ */
+
+ostream &operator <<(ostream &ostr, const Lexeme &lexeme)
+{
+    return ostr.write(lexeme.text, lexeme.length);
 }
 
 
@@ -413,3 +708,124 @@ int charval(const string &str)
 
     return s[0];
 }
+
+
+/*
+ * Function:	numval
+ *
+ * Description:	Convert a number into an integer value.  As in C, a number
+ *		with a leading zero is in octal.  Return -1 if the number
+ *		has a digit that is not allowed, or is too large for an
+ *		unsigned int.
+ */
+
+long numval(const Lexeme &lexeme)
+{
+    unsigned long value = 0, base;
+    unsigned digit;
+
+
+    base = lexeme.length > 1 && lexeme.text[0] == '0' ? 8 : 10;
+
+    for (unsigned i = 0; i < lexeme.length; i ++) {
+	digit = lexeme.text[i] - '0';
+
+	if (digit >= base)
+	    return -1;
+
+	value = value * base + digit;
+
+	if (value > UINT_MAX)
+	    return -1;
+    }
+
+    return value;
+}
+
+
+/*
+ * Function:	escape
+ *
+ * Description:	Convert the escape sequence starting after a backslash at
+ *		the given position into a character, and move past it.  As
+ *		in C, an octal escape has at most three digits, but a
+ *		hexadecimal escape has as many as there are.  An unknown
+ *		escape stands for the character itself.
+ */
+
+static int escape(const char *&s, const char *end)
+{
+    int value = 0, digit;
+    unsigned n;
+
+
+    switch (*s) {
+    case 'n':
+	s ++;
+	return '\n';
+    case 't':
+	s ++;
+	return '\t';
+    case 'v':
+	s ++;
+	return '\v';
+    case 'b':
+	s ++;
+	return '\b';
+    case 'r':
+	s ++;
+	return '\r';
+    case 'f':
+	s ++;
+	return '\f';
+    case 'a':
+	s ++;
+	return '\a';
+    case 'x':
+	for (s ++; s < end && isxdigit(*s); s ++) {
+	    digit = isdigit(*s) ? *s - '0' : tolower(*s) - 'a' + 10;
+	    value = (value * 16 + digit) & UCHAR_MAX;
+	}
+
+	return value;
+    }
+
+    if (*s < '0' || *s > '7')
+	return (unsigned char) *s ++;
+
+    for (n = 0; n < 3 && s < end && *s >= '0' && *s <= '7'; n ++)
+	value = value * 8 + *s ++ - '0';
+
+    return value & UCHAR_MAX;
+}
+
+
+/*
+ * Function:	strval
+ *
+ * Description:	Convert a string literal into its characters, with the
+ *		quotes removed and the escapes undone, and intern them.
+ *		A malformed literal may be missing its closing quote.
+ */
+
+Name strval(const Lexeme &lexeme)
+{
+    const char *s, *end;
+    string value;
+
+
+    s = lexeme.text + 1;
+    end = lexeme.text + lexeme.length;
+
+    if (end > s && end[-1] == '"')
+	end --;
+
+    while (s < end)
+	if (*s == '\\' && s + 1 < end) {
+	    s ++;
+	    value += escape(s, end);
+	} else
+	    value += *s ++;
+
+    return intern(value);
+}
@@ -3,15 +3,68 @@
  *
  * Description:	This file contains the public function and variable
  *		declarations for the lexical analyzer for Simple C.
+ *
+ *		A token refers to its lexeme in the source buffer rather
+ *		than holding a copy, so a lexeme is only valid until the
+ *		source is released.  An identifier also carries its
+ *		interned name, which is valid forever.  Literals are
+ *		converted once, by the lexical analyzer: a number or
+ *		character carries its value, and a string carries its
+ *		characters with the escapes undone, interned in the same
+ *		table as names, which thereby serves as the literal pool.
+ *
+ *		The state of the lexical analyzer and of the source buffer
+ *		is private to each thread, so that the source can be lexed
+ *		in pieces on several threads at once.  A thread can also
+ *		save its state, lex something else, and then restore it.
+ *
+ *		Errors are written to the standard error as they are
+ *		reported, unless diagnostics are being collected, in which
+ *		case they are saved along with their line numbers.  Each
+ *		thread collects its own diagnostics.
  */
 
 # ifndef LEXER_H
 # define LEXER_H
+# include <iosfwd>
+# include <vector>
+# include "intern.h"
+
+struct Lexeme {
+    const char *text;
+    unsigned length;
+};
+
+struct Token {
+    int kind;
+    Lexeme lexeme;
+    Name name;
+    unsigned value;
+};
+
+struct Diagnostic {
+    int line;
+    std::string message;
+};
+
+struct LexerState {
+    int next, line;
+};
 
-extern int lineno, numerrors;
+extern int numerrors;
+extern __thread int lineno;
+extern __thread std::vector<Diagnostic> *diagnostics;
 
-int lexan(std::string &lexbuf);
+int lexan(Token &token);
+int lexanDeferred(Token &token, const char *&error);
+void restartLexer();
+void saveLexer(LexerState &state);
+void restoreLexer(const LexerState &state);
+int keyword(const char *s, unsigned n);
 int charval(const std::string &str);
+long numval(const Lexeme &lexeme);
+Name strval(const Lexeme &lexeme);
 void report(const std::string &str, const std::string &arg = "");
+std::ostream &operator <<(std::ostream &ostr, const Lexeme &lexeme);
 
 # endif /* LEXER_H */
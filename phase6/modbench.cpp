@@ -0,0 +1,123 @@
+/*
+ * File:	modbench.cpp
+ *
+ * Description:	This file contains a benchmark for modules in Simple C.  A
+ *		source file of many functions is generated and compiled
+ *		once to save it as a module.  Then a cold compilation of
+ *		the source is timed against generating code from the
+ *		module, each in a child process, and the two must produce
+ *		the same assembly.  Both include the code generator, which
+ *		is all that loading a module does not skip.
+ *
+ *		usage: modbench [functions [compiler]]
+ */
+
+# include <cstdio>
+# include <cstdlib>
+# include <string>
+# include <unistd.h>
+# include "harness.h"
+
+# define RUNS 3
+
+using namespace std;
+
+static string dir;
+
+
+/*
+ * Function:	generate
+ *
+ * Description:	Write a source file with the given number of functions,
+ *		which use locals, a structure, a global array, strings,
+ *		loops, conditions, and calls to one another.
+ */
+
+static void generate(const string &path, unsigned count)
+{
+    FILE *fp;
+    unsigned i;
+
+
+    if ((fp = fopen(path.c_str(), "w")) == NULL) {
+	perror(path.c_str());
+	exit(EXIT_FAILURE);
+    }
+
+    fprintf(fp, "struct node { int value; struct node *next; };\n");
+    fprintf(fp, "int printf(), table[100];\nstruct node head;\n\n");
+    fprintf(fp, "int f0(int n) { return n; }\n\n");
+
+    for (i = 1; i < count; i ++) {
+	fprintf(fp, "int f%u(int n)\n{\n", i);
+	fprintf(fp, "    int i, sum;\n    char *s;\n    struct node *p;\n\n");
+	fprintf(fp, "    sum = 0;\n    i = 0;\n    p = &head;\n");
+	fprintf(fp, "    s = \"f%u: %%d\\n\";\n\n", i);
+	fprintf(fp, "    while (i < n && i < 100) {\n");
+	fprintf(fp, "\tif (table[i] %% %u == 0 || !(i > n / 2))\n", i % 7 + 2);
+	fprintf(fp, "\t    sum = sum + table[i] * %u - f%u(i);\n", i, i - 1);
+	fprintf(fp, "\telse\n\t    sum = sum - (*p).value;\n");
+	fprintf(fp, "\ti = i + 1;\n    }\n\n");
+	fprintf(fp, "    printf(s, sum);\n    return sum;\n}\n\n");
+    }
+
+    fclose(fp);
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Save the module, then time the best of several cold
+ *		compilations and loads, and report the speedup.
+ */
+
+int main(int argc, char *argv[])
+{
+    double secs, cold = 0, load = 0;
+    string source, module, out1, out2;
+    const char *compiler;
+    unsigned count, i;
+    bool failed;
+
+
+    count = argc > 1 ? atoi(argv[1]) : 20000;
+    compiler = argc > 2 ? argv[2] : "./scc";
+
+    dir = scratch("modbench");
+
+    source = dir + "/source.c";
+    module = dir + "/source.mod";
+    out1 = dir + "/cold.s";
+    out2 = dir + "/load.s";
+
+    generate(source, count);
+    failed = compile({compiler, "--save-module", module.c_str()}, source,
+		     out1) < 0;
+
+    for (i = 0; i < RUNS && !failed; i ++) {
+	secs = compile({compiler}, source, out1);
+	cold = i == 0 || secs < cold ? secs : cold;
+	failed = failed || secs < 0;
+
+	secs = compile({compiler, "--load-module", module.c_str()}, "", out2);
+	load = i == 0 || secs < load ? secs : load;
+	failed = failed || secs < 0;
+    }
+
+    if (failed)
+	printf("%u functions   FAILED\n", count);
+    else {
+	printf("%u functions   cold %7.1f ms   load %7.1f ms   speedup %4.2fx",
+	       count, cold * 1e3, load * 1e3, cold / load);
+	printf("%s\n", same(out1, out2) ? "" : "  MISMATCH");
+	failed = !same(out1, out2);
+    }
+
+    unlink(source.c_str());
+    unlink(module.c_str());
+    unlink(out1.c_str());
+    unlink(out2.c_str());
+    rmdir(dir.c_str());
+    exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
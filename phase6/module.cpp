@@ -0,0 +1,1014 @@
+/*
+ * File:	module.cpp
+ *
+ * Description:	This file contains the public and private function and
+ *		variable definitions for modules in Simple C.
+ *
+ *		A module file consists of a header, a record for each
+ *		function, and tables of the structures, global variables,
+ *		types, and names.  Everything is stored as 32-bit words,
+ *		except for the kinds of nodes, which are bytes, and the
+ *		characters of names, and each part starts on a word
+ *		boundary.  A record for a function holds the arrays of its
+ *		flat tree as they are, so that they can be copied straight
+ *		from the mapped file, except for the first children, which
+ *		follow from the counts.  Its symbols are records of their
+ *		own, with their offsets, and its types, names, and symbols
+ *		are indices into the tables of the module and of the
+ *		record.
+ *
+ *		Loading a module is just mapping the file and fixing up the
+ *		indices: interning the names, building the types, and
+ *		building the symbols and scopes of each function in an
+ *		arena that is reset once its code has been generated.  The
+ *		indices are checked as they are fixed up, since a damaged
+ *		file must not crash the code generator.
+ *
+ *		As with the token cache, a module is written under a
+ *		temporary name and then renamed, and only if the unit was
+ *		compiled without errors.
+ *
+ *		A precompiled header is a module without any functions,
+ *		saved after compiling a prelude shared by many units.  It
+ *		adds a table of every symbol declared in the outermost
+ *		scope, and the paths of the prelude with the hash of their
+ *		contents, so that a header whose prelude has changed since
+ *		is never loaded.  Only declarations are saved, so the code
+ *		of any function defined in the prelude is not.
+ */
+
+# include <climits>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <string>
+# include <unordered_map>
+# include <vector>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "module.h"
+# include "cache.h"
+# include "checker.h"
+# include "generator.h"
+
+# define MODULE_MAGIC	0x444f4d53
+# define MODULE_VERSION	2
+# define HEADER_MAGIC	0x52444853
+# define NONE		UINT_MAX
+# define KINDS		((unsigned) Kind::LogicalOr + 1)
+
+using namespace std;
+
+typedef unsigned long long Offset;
+
+struct ModuleHeader {
+    unsigned magic, version;
+    Offset size, structures, globals, types, names, declarations, sources;
+    unsigned functions, structureCount, globalCount, typeCount, nameCount;
+    unsigned declarationCount, sourceCount;
+    Hash hash;
+};
+
+struct FunctionRecord {
+    unsigned nodes, types, symbols, slots, names, scopes;
+    int offset;
+};
+
+struct SymbolRecord {
+    unsigned name, type;
+    int offset;
+};
+
+static_assert(sizeof(SymbolRecord) == 3 * sizeof(unsigned),
+	      "symbol records are not three words");
+
+enum { SCALAR_TYPE, ARRAY_TYPE, FUNCTION_TYPE, UNSPECIFIED_TYPE, ERROR_TYPE };
+
+static FILE *fp;
+static string path, temp;
+static ModuleHeader header, loaded;
+
+static vector<Name> names;
+static unordered_map<Name, unsigned> nameIndices;
+static vector<Type> types;
+static vector<unsigned> typeWords;
+
+static const char *first, *last;
+static void *mapping;
+static Arena scratch;
+
+static void unmapFile();
+
+
+/*
+ * Function:	words
+ *
+ * Description:	Return the number of words needed for the given number of
+ *		bytes.
+ */
+
+static inline size_t words(size_t bytes)
+{
+    return (bytes + sizeof(unsigned) - 1) / sizeof(unsigned);
+}
+
+
+/*
+ * Function:	nameIndex
+ *
+ * Description:	Return the index of the given name in the table of names,
+ *		adding it if necessary.
+ */
+
+static unsigned nameIndex(Name name)
+{
+    unordered_map<Name, unsigned>::iterator it;
+
+
+    it = nameIndices.find(name);
+
+    if (it != nameIndices.end())
+	return it->second;
+
+    names.push_back(name);
+    nameIndices[name] = names.size() - 1;
+    return names.size() - 1;
+}
+
+
+/*
+ * Function:	identical
+ *
+ * Description:	Return whether the two given types are identical.  A
+ *		function type without parameters is equal to any function
+ *		type with the same result, but is not the same type.
+ */
+
+static bool identical(const Type &left, const Type &right)
+{
+    if (left != right)
+	return false;
+
+    if (!left.isFunction())
+	return true;
+
+    return (left.parameters() == nullptr) == (right.parameters() == nullptr);
+}
+
+
+/*
+ * Function:	typeIndex
+ *
+ * Description:	Return the index of the given type in the table of types,
+ *		adding it if necessary.  There are few distinct types, so
+ *		they are just searched, as in a flat tree.  The parameters
+ *		of a function type are added before it, so that a type
+ *		only ever refers to types before it.
+ */
+
+static unsigned typeIndex(const Type &type)
+{
+    vector<unsigned> params;
+    Parameters *parameters;
+    unsigned i;
+
+
+    for (i = 0; i < types.size(); i ++)
+	if (identical(types[i], type))
+	    return i;
+
+    parameters = type.isFunction() ? type.parameters() : nullptr;
+
+    if (parameters != nullptr)
+	for (i = 0; i < parameters->size(); i ++)
+	    params.push_back(typeIndex((*parameters)[i]));
+
+    if (type.isError())
+	typeWords.push_back(ERROR_TYPE);
+    else if (type.isArray())
+	typeWords.push_back(ARRAY_TYPE);
+    else if (parameters != nullptr)
+	typeWords.push_back(FUNCTION_TYPE);
+    else if (type.isFunction())
+	typeWords.push_back(UNSPECIFIED_TYPE);
+    else
+	typeWords.push_back(SCALAR_TYPE);
+
+    typeWords.push_back(type.isError() ? NONE : nameIndex(type.specifier()));
+    typeWords.push_back(type.isError() ? 0 : type.indirection());
+    typeWords.push_back(type.isArray() ? type.length() : 0);
+    typeWords.push_back(params.size());
+    typeWords.insert(typeWords.end(), params.begin(), params.end());
+
+    types.push_back(type);
+    return types.size() - 1;
+}
+
+
+/*
+ * Function:	discard
+ *
+ * Description:	Remove the temporary file of a module that was never
+ *		finished, such as when the compiler gives up on a syntax
+ *		error.
+ */
+
+static void discard()
+{
+    if (fp != NULL) {
+	fclose(fp);
+	unlink(temp.c_str());
+	fp = NULL;
+    }
+}
+
+
+/*
+ * Function:	create
+ *
+ * Description:	Create the temporary file for the given module, leaving
+ *		room for the header, which is written last, once the
+ *		tables are known.
+ */
+
+static bool create(const char *file)
+{
+    static bool registered;
+
+
+    path = file;
+    temp = path + "." + to_string(getpid());
+
+    if ((fp = fopen(temp.c_str(), "wb")) == NULL)
+	return false;
+
+    if (!registered)
+	atexit(discard);
+
+    registered = true;
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, fp);
+    header.size = sizeof(header);
+    return true;
+}
+
+
+/*
+ * Function:	openModule
+ *
+ * Description:	Start saving the unit being compiled as a module in the
+ *		given file.
+ */
+
+bool openModule(const char *file)
+{
+    return create(file);
+}
+
+
+/*
+ * Function:	recordFunction
+ *
+ * Description:	Append a record for the function in the given flat tree,
+ *		whose storage has been allocated down to the given offset,
+ *		to the module being saved, if any.  The symbols of a
+ *		function, including those only declared in its scopes, are
+ *		gathered into records of their own, once each.
+ */
+
+void recordFunction(const FlatTree &tree, int offset)
+{
+    static unordered_map<const Symbol *, unsigned> indices;
+    static vector<const Symbol *> symbols;
+    static vector<unsigned> buffer;
+    FunctionRecord record;
+    const Symbols *members;
+    unsigned i, j, n;
+
+
+    if (fp == NULL)
+	return;
+
+    indices.clear();
+    symbols.clear();
+    buffer.clear();
+
+    n = tree.kinds.size();
+    buffer.resize(words(n));
+    memcpy(buffer.data(), tree.kinds.data(), n);
+
+    buffer.insert(buffer.end(), tree.counts.begin(), tree.counts.end());
+    buffer.insert(buffer.end(), tree.types.begin(), tree.types.end());
+    buffer.insert(buffer.end(), tree.operands.begin(), tree.operands.end());
+
+    for (i = 0; i < tree.typeTable.size(); i ++)
+	buffer.push_back(typeIndex(tree.typeTable[i]));
+
+    for (i = 0; i < tree.symbols.size(); i ++)
+	if (indices.insert({tree.symbols[i], symbols.size()}).second)
+	    symbols.push_back(tree.symbols[i]);
+
+    for (i = 0; i < tree.scopes.size(); i ++) {
+	members = &tree.scopes[i]->symbols();
+
+	for (j = 0; j < members->size(); j ++)
+	    if (indices.insert({(*members)[j], symbols.size()}).second)
+		symbols.push_back((*members)[j]);
+    }
+
+    for (i = 0; i < symbols.size(); i ++) {
+	buffer.push_back(nameIndex(symbols[i]->name()));
+	buffer.push_back(typeIndex(symbols[i]->type()));
+	buffer.push_back(symbols[i]->_offset);
+    }
+
+    for (i = 0; i < tree.symbols.size(); i ++)
+	buffer.push_back(indices[tree.symbols[i]]);
+
+    for (i = 0; i < tree.names.size(); i ++)
+	buffer.push_back(nameIndex(tree.names[i]));
+
+    for (i = 0; i < tree.scopes.size(); i ++) {
+	members = &tree.scopes[i]->symbols();
+	buffer.push_back(members->size());
+
+	for (j = 0; j < members->size(); j ++)
+	    buffer.push_back(indices[(*members)[j]]);
+    }
+
+    record.nodes = n;
+    record.types = tree.typeTable.size();
+    record.symbols = symbols.size();
+    record.slots = tree.symbols.size();
+    record.names = tree.names.size();
+    record.scopes = tree.scopes.size();
+    record.offset = offset;
+
+    fwrite(&record, sizeof(record), 1, fp);
+    fwrite(buffer.data(), sizeof(unsigned), buffer.size(), fp);
+
+    header.size += sizeof(record) + buffer.size() * sizeof(unsigned);
+    header.functions ++;
+}
+
+
+/*
+ * Function:	symbolWords
+ *
+ * Description:	Append the name and type of each of the given symbols to
+ *		the given table.
+ */
+
+static void symbolWords(const Symbols &symbols, vector<unsigned> &table)
+{
+    for (unsigned i = 0; i < symbols.size(); i ++) {
+	table.push_back(nameIndex(symbols[i]->name()));
+	table.push_back(typeIndex(symbols[i]->type()));
+    }
+}
+
+
+/*
+ * Function:	writeWords
+ *
+ * Description:	Write the given table at the end of the file, and set the
+ *		given offset to where it starts.
+ */
+
+static void writeWords(const vector<unsigned> &table, Offset &offset)
+{
+    offset = header.size;
+    fwrite(table.data(), sizeof(unsigned), table.size(), fp);
+    header.size += table.size() * sizeof(unsigned);
+}
+
+
+/*
+ * Function:	finish
+ *
+ * Description:	Finish the file being saved with the tables of
+ *		structures, the given global variables and declarations,
+ *		the given sources, types, and names, and the header, and
+ *		give it its real name.  The tables are written in that
+ *		order, since each may add to the ones after it.
+ */
+
+static bool finish(const Symbols &globals, const Symbols &declarations,
+	const vector<unsigned> &sources)
+{
+    vector<unsigned> structures, variables, symbols, table;
+    vector<Name> tags;
+    Symbols fields;
+    unsigned i, j;
+    bool saved;
+
+
+    tags = getStructures();
+
+    for (i = 0; i < tags.size(); i ++) {
+	fields = getFields(tags[i]);
+	structures.push_back(nameIndex(tags[i]));
+	structures.push_back(fields.size());
+	symbolWords(fields, structures);
+    }
+
+    symbolWords(globals, variables);
+    symbolWords(declarations, symbols);
+
+    for (i = 0; i < names.size(); i ++) {
+	j = table.size();
+	table.push_back(names[i]->size());
+	table.resize(j + 1 + words(names[i]->size()));
+	memcpy(&table[j + 1], names[i]->data(), names[i]->size());
+    }
+
+    header.version = MODULE_VERSION;
+    header.structureCount = tags.size();
+    header.globalCount = globals.size();
+    header.declarationCount = declarations.size();
+    header.sourceCount = sources.size();
+    header.typeCount = types.size();
+    header.nameCount = names.size();
+
+    writeWords(structures, header.structures);
+    writeWords(variables, header.globals);
+    writeWords(symbols, header.declarations);
+    writeWords(sources, header.sources);
+    writeWords(typeWords, header.types);
+    writeWords(table, header.names);
+
+    rewind(fp);
+    fwrite(&header, sizeof(header), 1, fp);
+    saved = fclose(fp) == 0 && rename(temp.c_str(), path.c_str()) == 0;
+
+    if (!saved)
+	unlink(temp.c_str());
+
+    fp = NULL;
+    return saved;
+}
+
+
+/*
+ * Function:	closeModule
+ *
+ * Description:	Finish the module being saved, if any, with the given
+ *		global variables.
+ */
+
+void closeModule(const Symbols &globals)
+{
+    if (fp == NULL)
+	return;
+
+    if (numerrors > 0) {
+	discard();
+	return;
+    }
+
+    header.magic = MODULE_MAGIC;
+    finish(globals, Symbols(), vector<unsigned>());
+}
+
+
+/*
+ * Function:	saveHeader
+ *
+ * Description:	Save the outermost scope, the structures, and the given
+ *		global variables of the unit just compiled from the given
+ *		files as a precompiled header in the given file.  Nothing
+ *		is saved if the unit has errors or was read from the
+ *		standard input, since the header could never be checked
+ *		against its prelude.  The files are saved by their real
+ *		paths, so that the header can be used from any directory.
+ */
+
+bool saveHeader(const char *file, int count, char *paths[],
+	const Symbols &globals)
+{
+    char resolved[PATH_MAX];
+    vector<unsigned> sources;
+    Hash hash;
+    int i;
+
+
+    if (count == 0 || numerrors > 0 || !hashSources(count, paths, hash))
+	return false;
+
+    if (!create(file))
+	return false;
+
+    names.clear();
+    nameIndices.clear();
+    types.clear();
+    typeWords.clear();
+
+    for (i = 0; i < count; i ++) {
+	if (realpath(paths[i], resolved) == NULL) {
+	    discard();
+	    return false;
+	}
+
+	sources.push_back(nameIndex(intern(resolved)));
+    }
+
+    header.magic = HEADER_MAGIC;
+    header.hash = hash;
+    return finish(globals, getDeclarations(), sources);
+}
+
+
+/*
+ * Function:	corrupt
+ *
+ * Description:	Report that the module is damaged and give up.  Some of
+ *		its code may already have been generated.
+ */
+
+static void corrupt()
+{
+    report("module %s is corrupt", path);
+    exit(EXIT_FAILURE);
+}
+
+
+/*
+ * Function:	take
+ *
+ * Description:	Return the given number of words at the current position
+ *		in the mapped file, and move past them.
+ */
+
+static const unsigned *take(size_t count)
+{
+    const unsigned *p = (const unsigned *) first;
+
+
+    if (count > (size_t) (last - first) / sizeof(unsigned))
+	corrupt();
+
+    first += count * sizeof(unsigned);
+    return p;
+}
+
+
+/*
+ * Function:	check
+ *
+ * Description:	Check that the given index is less than the given limit.
+ */
+
+static inline unsigned check(unsigned index, size_t limit)
+{
+    if (index >= limit)
+	corrupt();
+
+    return index;
+}
+
+
+/*
+ * Function:	loadNames
+ *
+ * Description:	Intern the names of the mapped module.
+ */
+
+static void loadNames(const char *base)
+{
+    const unsigned *p;
+    unsigned i, length;
+
+
+    names.clear();
+    first = base + loaded.names;
+
+    for (i = 0; i < loaded.nameCount; i ++) {
+	length = *take(1);
+	p = take(words(length));
+	names.push_back(intern((const char *) p, length));
+    }
+}
+
+
+/*
+ * Function:	loadSymbols
+ *
+ * Description:	Build the given number of symbols from the names and
+ *		types at the current position in the mapped module.
+ */
+
+static void loadSymbols(unsigned count, Symbols &symbols)
+{
+    const unsigned *p;
+
+
+    for (unsigned i = 0; i < count; i ++) {
+	p = take(2);
+	symbols.push_back(new (permanent) Symbol(names[check(p[0],
+	    names.size())], types[check(p[1], types.size())]));
+    }
+}
+
+
+/*
+ * Function:	loadTables
+ *
+ * Description:	Fix up the rest of the tables of the mapped module: build
+ *		its types, and define its structures.  The global
+ *		variables are returned.
+ */
+
+static void loadTables(const char *base, Symbols &globals)
+{
+    const unsigned *p;
+    unsigned i, j, kind;
+    Parameters *params;
+    Symbols fields;
+    Scope *scope;
+    Name name;
+
+
+    types.clear();
+    first = base + loaded.types;
+
+    for (i = 0; i < loaded.typeCount; i ++) {
+	p = take(5);
+	kind = p[0];
+	name = kind == ERROR_TYPE ? nullptr : names[check(p[1], names.size())];
+
+	if (kind == FUNCTION_TYPE) {
+	    params = new (permanent) Parameters();
+
+	    for (j = 0; j < p[4]; j ++)
+		params->push_back(types[check(*take(1), types.size())]);
+
+	    types.push_back(Type(name, p[2], params));
+
+	} else if (kind == UNSPECIFIED_TYPE)
+	    types.push_back(Type(name, p[2], (Parameters *) nullptr));
+	else if (kind == ARRAY_TYPE)
+	    types.push_back(Type(name, p[2], (unsigned long) p[3]));
+	else if (kind == SCALAR_TYPE)
+	    types.push_back(Type(name, p[2]));
+	else if (kind == ERROR_TYPE)
+	    types.push_back(Type());
+	else
+	    corrupt();
+    }
+
+    first = base + loaded.structures;
+
+    for (i = 0; i < loaded.structureCount; i ++) {
+	p = take(2);
+	name = names[check(p[0], names.size())];
+	scope = new (permanent) Scope();
+	fields.clear();
+	loadSymbols(p[1], fields);
+
+	for (j = 0; j < fields.size(); j ++)
+	    scope->insert(fields[j]);
+
+	defineStructure(name, scope);
+    }
+
+    first = base + loaded.globals;
+    loadSymbols(loaded.globalCount, globals);
+}
+
+
+/*
+ * Function:	arity
+ *
+ * Description:	Return the number of children a node of the given kind
+ *		has, or NONE if it may have any number.  An if statement
+ *		has two, or three with an else part.
+ */
+
+static unsigned arity(Kind kind)
+{
+    switch (kind) {
+    case Kind::Block:
+    case Kind::Call:
+	return NONE;
+
+    case Kind::String:
+    case Kind::Character:
+    case Kind::Identifier:
+    case Kind::Number:
+	return 0;
+
+    case Kind::Function:
+    case Kind::Return:
+    case Kind::Not:
+    case Kind::Negate:
+    case Kind::Dereference:
+    case Kind::Address:
+    case Kind::Cast:
+	return 1;
+
+    default:
+	return 2;
+    }
+}
+
+
+/*
+ * Function:	loadFunction
+ *
+ * Description:	Fix up the record of the next function in the mapped
+ *		module into the given flat tree, and return the offset its
+ *		storage was allocated down to.  Its symbols and scopes are
+ *		built in the scratch arena.  The first child of each node
+ *		is not stored, since the children of the nodes are in the
+ *		order of the nodes, and it is found from the counts, which
+ *		are checked so that every child comes after its parent and
+ *		the tree can be walked without going astray.
+ */
+
+static int loadFunction(FlatTree &tree)
+{
+    const FunctionRecord *record;
+    const SymbolRecord *records;
+    const unsigned *p, *handles;
+    const Kind *kinds;
+    vector<Symbol *> symbols;
+    Scope *scope;
+    unsigned i, j, n, next, count, operand;
+
+
+    record = (const FunctionRecord *) take(words(sizeof(FunctionRecord)));
+    n = record->nodes;
+
+    if (n == 0)
+	corrupt();
+
+    kinds = (const Kind *) take(words(n));
+    tree.kinds.assign(kinds, kinds + n);
+    p = take(n);
+    tree.counts.assign(p, p + n);
+    handles = take(n);
+    tree.types.assign(handles, handles + n);
+    p = take(n);
+    tree.operands.assign(p, p + n);
+
+    tree.typeTable.clear();
+    p = take(record->types);
+
+    for (i = 0; i < record->types; i ++)
+	tree.typeTable.push_back(types[check(p[i], types.size())]);
+
+    records = (const SymbolRecord *) take(record->symbols * 3);
+
+    for (i = 0; i < record->symbols; i ++) {
+	symbols.push_back(new (scratch) Symbol(names[check(records[i].name,
+	    names.size())], types[check(records[i].type, types.size())]));
+	symbols.back()->_offset = records[i].offset;
+    }
+
+    tree.symbols.clear();
+    p = take(record->slots);
+
+    for (i = 0; i < record->slots; i ++)
+	tree.symbols.push_back(symbols[check(p[i], symbols.size())]);
+
+    tree.names.clear();
+    p = take(record->names);
+
+    for (i = 0; i < record->names; i ++)
+	tree.names.push_back(names[check(p[i], names.size())]);
+
+    tree.scopes.clear();
+
+    for (i = 0; i < record->scopes; i ++) {
+	count = *take(1);
+	p = take(count);
+	scope = new (scratch) Scope();
+
+	for (j = 0; j < count; j ++)
+	    scope->insert(symbols[check(p[j], symbols.size())]);
+
+	tree.scopes.push_back(scope);
+    }
+
+    tree.firsts.resize(n);
+    next = 1;
+
+    for (i = 0; i < n; i ++) {
+	check((unsigned) tree.kinds[i], KINDS);
+	check(handles[i], tree.typeTable.size());
+	count = tree.counts[i];
+
+	if ((count > 0 && next <= i) || count > n - next)
+	    corrupt();
+
+	if (arity(tree.kinds[i]) != count && arity(tree.kinds[i]) != NONE)
+	    if (tree.kinds[i] != Kind::If || count != 3)
+		corrupt();
+
+	tree.firsts[i] = count > 0 ? next : 0;
+	next += count;
+	operand = tree.operands[i];
+
+	if (tree.kinds[i] == Kind::Identifier || tree.kinds[i] == Kind::Call)
+	    check(operand, tree.symbols.size());
+	else if (tree.kinds[i] == Kind::String)
+	    check(operand, tree.names.size());
+	else if (tree.kinds[i] == Kind::Block)
+	    check(operand, tree.scopes.size());
+    }
+
+    if (next != n || tree.kinds[0] != Kind::Function)
+	corrupt();
+
+    check(tree.operands[0], tree.symbols.size());
+    return record->offset;
+}
+
+
+/*
+ * Function:	mapFile
+ *
+ * Description:	Map the given file and check that it has a header with
+ *		the given magic number, the current version, and the
+ *		right size, and tables that lie within it.  Return the
+ *		start of the mapping, or null if it cannot be used.
+ */
+
+static const char *mapFile(const char *file, unsigned magic)
+{
+    struct stat st;
+    const char *base;
+    int fd;
+
+
+    path = file;
+
+    if ((fd = open(file, O_RDONLY)) < 0)
+	return nullptr;
+
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(loaded)) {
+	close(fd);
+	return nullptr;
+    }
+
+    mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+	mapping = nullptr;
+	return nullptr;
+    }
+
+    base = (const char *) mapping;
+    memcpy(&loaded, base, sizeof(loaded));
+
+    if (loaded.magic != magic || loaded.version != MODULE_VERSION ||
+	    loaded.size != (Offset) st.st_size) {
+	unmapFile();
+	return nullptr;
+    }
+
+    last = base + loaded.size;
+
+    if (loaded.structures > loaded.size || loaded.globals > loaded.size ||
+	    loaded.types > loaded.size || loaded.names > loaded.size ||
+	    loaded.declarations > loaded.size || loaded.sources > loaded.size)
+	corrupt();
+
+    return base;
+}
+
+
+/*
+ * Function:	unmapFile
+ *
+ * Description:	Unmap the mapped file, if any, and forget its names and
+ *		types, which are indexed differently in a module being
+ *		saved.
+ */
+
+static void unmapFile()
+{
+    if (mapping != nullptr)
+	munmap(mapping, loaded.size);
+
+    mapping = nullptr;
+    names.clear();
+    types.clear();
+}
+
+
+/*
+ * Function:	replayModule
+ *
+ * Description:	Map the given module and generate code for it, just as if
+ *		its source had been compiled.
+ */
+
+bool replayModule(const char *file)
+{
+    static FlatTree tree;
+    const char *base;
+    Symbols globals;
+    int offset;
+
+
+    if ((base = mapFile(file, MODULE_MAGIC)) == nullptr)
+	return false;
+
+    loadNames(base);
+    loadTables(base, globals);
+    first = base + sizeof(loaded);
+
+    for (unsigned i = 0; i < loaded.functions; i ++) {
+	offset = loadFunction(tree);
+	generate(tree, offset);
+	scratch.reset();
+    }
+
+    generateGlobals(globals);
+    unmapFile();
+    return true;
+}
+
+
+/*
+ * Function:	openHeader
+ *
+ * Description:	Map the given precompiled header and check that its
+ *		prelude has not changed since it was saved.  If it has,
+ *		then the header is dropped and the paths of the prelude
+ *		are returned, so that it can be compiled instead.  Return
+ *		false if the header cannot be used at all.
+ */
+
+bool openHeader(const char *file, vector<string> &prelude)
+{
+    vector<char *> paths;
+    const unsigned *p;
+    const char *base;
+    unsigned i;
+    Hash hash;
+
+
+    if ((base = mapFile(file, HEADER_MAGIC)) == nullptr)
+	return false;
+
+    if (loaded.functions > 0 || loaded.sourceCount == 0) {
+	unmapFile();
+	return false;
+    }
+
+    loadNames(base);
+    first = base + loaded.sources;
+    p = take(loaded.sourceCount);
+
+    for (i = 0; i < loaded.sourceCount; i ++)
+	prelude.push_back(*names[check(p[i], names.size())]);
+
+    for (i = 0; i < prelude.size(); i ++)
+	paths.push_back(&prelude[i][0]);
+
+    if (hashSources(paths.size(), paths.data(), hash) && hash == loaded.hash) {
+	prelude.clear();
+	return true;
+    }
+
+    unmapFile();
+    return true;
+}
+
+
+/*
+ * Function:	loadHeader
+ *
+ * Description:	Load the precompiled header that was opened, if any:
+ *		define its structures and declare its symbols in the
+ *		outermost scope, and add its global variables to the given
+ *		ones.  This must be done once the global state is being
+ *		journaled, if it is, so that the declarations are seen by
+ *		the function bodies parsed in stages.
+ */
+
+void loadHeader(Symbols &globals)
+{
+    Symbols declarations;
+    const char *base;
+    unsigned i;
+
+
+    if (mapping == nullptr)
+	return;
+
+    base = (const char *) mapping;
+    loadTables(base, globals);
+    first = base + loaded.declarations;
+    loadSymbols(loaded.declarationCount, declarations);
+
+    for (i = 0; i < declarations.size(); i ++)
+	declareSymbol(declarations[i]);
+
+    unmapFile();
+}
@@ -0,0 +1,38 @@
+/*
+ * File:	module.h
+ *
+ * Description:	This file contains the public function declarations for
+ *		modules in Simple C.
+ *
+ *		A module is a translation unit that has been checked and
+ *		had its storage allocated, saved in a binary file: the
+ *		flat tree of each function with its symbols and their
+ *		offsets, the structures, the global variables, and the
+ *		names and types they all refer to.  Code can be generated
+ *		from a module again without lexing, parsing, or checking
+ *		the source.  A function is recorded as it is generated,
+ *		and the rest of the module is written once the whole unit
+ *		has been compiled without errors.
+ *
+ *		A precompiled header is a module of just the declarations
+ *		of a prelude.  Loading it declares them as if the prelude
+ *		had been compiled first, unless the prelude has changed.
+ */
+
+# ifndef MODULE_H
+# define MODULE_H
+# include <string>
+# include <vector>
+# include "flat.h"
+
+bool openModule(const char *path);
+void recordFunction(const FlatTree &tree, int offset);
+void closeModule(const Symbols &globals);
+bool replayModule(const char *path);
+
+bool saveHeader(const char *path, int count, char *paths[],
+	const Symbols &globals);
+bool openHeader(const char *path, std::vector<std::string> &prelude);
+void loadHeader(Symbols &globals);
+
+# endif /* MODULE_H */
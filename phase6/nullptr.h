@@ -17,7 +17,7 @@
 
 # ifndef NULLPTR_H
 # define NULLPTR_H
-# ifndef nullptr
+# if !defined(nullptr) && __cplusplus < 201103L
 
 const class nullptr_t {
     void operator &() const;
@@ -0,0 +1,145 @@
+/*
+ * File:	outbench.cpp
+ *
+ * Description:	This file contains a benchmark for buffered output in Simple
+ *		C.  The same stream of instructions, with stack offsets,
+ *		immediates, labels, and globals in them, is written to a
+ *		file through cout, ending each line with endl as the code
+ *		generator once did, and through an output object.  The two
+ *		files must be the same.
+ *
+ *		usage: outbench [instructions]
+ */
+
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <iostream>
+# include <string>
+# include <fcntl.h>
+# include <unistd.h>
+# include "harness.h"
+# include "output.h"
+
+# define RUNS 3
+
+using namespace std;
+
+static string dir;
+
+
+/*
+ * Function:	redirect
+ *
+ * Description:	Make the standard output the given file, emptied.
+ */
+
+static void redirect(const string &path)
+{
+    int fd;
+
+
+    if ((fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) {
+	perror(path.c_str());
+	exit(EXIT_FAILURE);
+    }
+
+    dup2(fd, 1);
+    close(fd);
+}
+
+
+/*
+ * Function:	end
+ *
+ * Description:	End a line, flushing cout as endl does, but not an output
+ *		object, which has no need to.
+ */
+
+static void end(ostream &out)
+{
+    out << endl;
+}
+
+static void end(Output &out)
+{
+    out << '\n';
+}
+
+
+/*
+ * Function:	write
+ *
+ * Description:	Write the given number of instructions to the given
+ *		stream, which may be cout or an output object.
+ */
+
+template <class Stream>
+static void write(Stream &out, unsigned count, const string &name)
+{
+    for (unsigned i = 0; i < count; i ++) {
+	out << "\tmovl\t" << -(long) (i % 97 * 4) << "(%ebp), %eax";
+	end(out);
+	out << "\taddl\t$" << i << ", %eax";
+	end(out);
+	out << "\tmovl\t%eax, " << name;
+	end(out);
+	out << "\tje\t.L" << i / 3;
+	end(out);
+    }
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Time the best of several runs of each way of writing, and
+ *		report the speedup.
+ */
+
+int main(int argc, char *argv[])
+{
+    chrono::steady_clock::time_point start;
+    chrono::duration<double> secs;
+    double streamed = 0, buffered = 0;
+    string out1, out2, name;
+    unsigned count, i;
+    bool failed;
+    int saved;
+
+
+    count = argc > 1 ? atoi(argv[1]) : 500000;
+
+    dir = scratch("outbench");
+
+    out1 = dir + "/cout.s";
+    out2 = dir + "/output.s";
+    name = "global";
+    saved = dup(1);
+
+    for (i = 0; i < RUNS; i ++) {
+	redirect(out1);
+	start = chrono::steady_clock::now();
+	write(cout, count, name);
+	secs = chrono::steady_clock::now() - start;
+	streamed = i == 0 || secs.count() < streamed ? secs.count() : streamed;
+
+	redirect(out2);
+	start = chrono::steady_clock::now();
+	write(assembly, count, name);
+	assembly.flush();
+	secs = chrono::steady_clock::now() - start;
+	buffered = i == 0 || secs.count() < buffered ? secs.count() : buffered;
+    }
+
+    dup2(saved, 1);
+    failed = !same(out1, out2);
+    printf("%u instructions   cout %7.1f ms   output %7.1f ms   "
+	   "speedup %4.2fx%s\n", count * 4, streamed * 1e3, buffered * 1e3,
+	   streamed / buffered, failed ? "  MISMATCH" : "");
+
+    unlink(out1.c_str());
+    unlink(out2.c_str());
+    rmdir(dir.c_str());
+    exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
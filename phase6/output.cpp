@@ -0,0 +1,169 @@
+/*
+ * File:	output.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		buffered output in Simple C.
+ *
+ *		A full set of blocks is a megabyte, so even a large program
+ *		is written with a handful of system calls.
+ */
+
+# include <cerrno>
+# include <sys/uio.h>
+# include "output.h"
+
+# define BLOCK_SIZE	(64 * 1024)
+# define BLOCKS		16		/* number of blocks written at once */
+
+using namespace std;
+
+Output assembly(1);
+
+
+/*
+ * Function:	Output::Output (constructor)
+ *
+ * Description:	Initialize this output object to write to the given file
+ *		descriptor.  No memory is allocated until it is needed.
+ */
+
+Output::Output(int fd)
+    : _used(0), _next(nullptr), _limit(nullptr), _fd(fd)
+{
+}
+
+
+/*
+ * Function:	Output::~Output (destructor)
+ *
+ * Description:	Write out anything left in this output object and free
+ *		its memory.
+ */
+
+Output::~Output()
+{
+    flush();
+
+    for (unsigned i = 0; i < _blocks.size(); i ++)
+	delete[] _blocks[i];
+}
+
+
+/*
+ * Function:	Output::grow
+ *
+ * Description:	Move on to the next block, writing out the blocks first if
+ *		they are all full.
+ */
+
+void Output::grow()
+{
+    if (_used == BLOCKS)
+	flush();
+
+    if (_used == _blocks.size())
+	_blocks.push_back(new char[BLOCK_SIZE]);
+
+    _next = _blocks[_used ++];
+    _limit = _next + BLOCK_SIZE;
+}
+
+
+/*
+ * Function:	Output::spill
+ *
+ * Description:	Append the given characters, which do not fit in the
+ *		current block, across as many blocks as they need.
+ */
+
+void Output::spill(const char *s, size_t n)
+{
+    size_t room;
+
+
+    while (n > (room = _limit - _next)) {
+	memcpy(_next, s, room);
+	_next += room;
+	s += room;
+	n -= room;
+	grow();
+    }
+
+    if (n > 0) {
+	memcpy(_next, s, n);
+	_next += n;
+    }
+}
+
+
+/*
+ * Function:	Output::number
+ *
+ * Description:	Append the given number in decimal, with a minus sign if
+ *		it is negative, just as an ostream would.
+ */
+
+Output &Output::number(unsigned long n, bool negative)
+{
+    char buf[24], *p;
+
+
+    p = buf + sizeof(buf);
+
+    do {
+	*-- p = '0' + n % 10;
+	n /= 10;
+    } while (n > 0);
+
+    if (negative)
+	*-- p = '-';
+
+    write(p, buf + sizeof(buf) - p);
+    return *this;
+}
+
+
+/*
+ * Function:	Output::flush
+ *
+ * Description:	Write out the blocks in use with as few calls as possible,
+ *		since writev() may write less than it was asked to, and
+ *		start over with the first block.  An error in writing is
+ *		ignored, just as it is by cout.
+ */
+
+void Output::flush()
+{
+    struct iovec iov[BLOCKS];
+    unsigned i, count;
+    ssize_t n;
+
+
+    for (i = 0; i < _used; i ++) {
+	iov[i].iov_base = _blocks[i];
+	iov[i].iov_len = i + 1 < _used ? BLOCK_SIZE : _next - _blocks[i];
+    }
+
+    count = _used;
+    i = 0;
+
+    while (i < count) {
+	if ((n = writev(_fd, iov + i, count - i)) < 0) {
+	    if (errno == EINTR)
+		continue;
+
+	    break;
+	}
+
+	while (i < count && (size_t) n >= iov[i].iov_len)
+	    n -= iov[i ++].iov_len;
+
+	if (i < count) {
+	    iov[i].iov_base = (char *) iov[i].iov_base + n;
+	    iov[i].iov_len -= n;
+	}
+    }
+
+    _used = 0;
+    _next = _limit = nullptr;
+}
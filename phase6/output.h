@@ -0,0 +1,87 @@
+/*
+ * File:	output.h
+ *
+ * Description:	This file contains the class definition for buffered output
+ *		in Simple C.  The code generator writes the assembly through
+ *		an output object rather than through cout, which flushed
+ *		standard output at the end of every instruction and so made
+ *		a system call for each one.
+ *
+ *		Text is appended to a list of large blocks, which are kept
+ *		once allocated.  Once they are all full, they are written
+ *		out together with a single call to writev(), and then
+ *		reused.  Whatever is left is written when the object is
+ *		flushed or destroyed, which happens when the program exits,
+ *		even after an error.  Integers are formatted by hand.
+ */
+
+# ifndef OUTPUT_H
+# define OUTPUT_H
+# include <cstddef>
+# include <cstring>
+# include <string>
+# include <vector>
+
+class Output {
+    std::vector<char *> _blocks;
+    unsigned _used;
+    char *_next, *_limit;
+    int _fd;
+
+    void grow();
+    void spill(const char *s, std::size_t n);
+    Output &number(unsigned long n, bool negative);
+
+public:
+    Output(int fd);
+    ~Output();
+
+    void flush();
+
+    void write(const char *s, std::size_t n) {
+	if (n >= (std::size_t) (_limit - _next))
+	    spill(s, n);
+	else {
+	    std::memcpy(_next, s, n);
+	    _next += n;
+	}
+    }
+
+    Output &operator <<(char c) {
+	if (_next == _limit)
+	    grow();
+
+	*_next ++ = c;
+	return *this;
+    }
+
+    Output &operator <<(const char *s) {
+	write(s, std::strlen(s));
+	return *this;
+    }
+
+    Output &operator <<(const std::string &s) {
+	write(s.data(), s.size());
+	return *this;
+    }
+
+    Output &operator <<(long n) {
+	return number(n < 0 ? -(unsigned long) n : n, n < 0);
+    }
+
+    Output &operator <<(unsigned long n) {
+	return number(n, false);
+    }
+
+    Output &operator <<(int n) {
+	return *this << (long) n;
+    }
+
+    Output &operator <<(unsigned n) {
+	return number(n, false);
+    }
+};
+
+extern Output assembly;
+
+# endif /* OUTPUT_H */
@@ -0,0 +1,182 @@
+/*
+ * File:	parbench.cpp
+ *
+ * Description:	This file contains a scaling benchmark for the parallel
+ *		lexical analyzer for Simple C.  The token stream of a large
+ *		source file is produced by the lexical analyzer alone and
+ *		then in parallel on increasing numbers of threads, up to
+ *		twice the number of cores.  Each parallel stream is checked
+ *		against the sequential one, token by token and line by line.
+ *
+ *		The lexical analyzer can only be run once per process, so
+ *		each run is made in a child process of its own.  If no file
+ *		is given, a synthetic source file is generated, with enough
+ *		comments and literals that chunks often start inside them.
+ *
+ *		usage: parbench [file | megabytes]
+ */
+
+# include <ctime>
+# include <cstdio>
+# include <cstdlib>
+# include <string>
+# include <thread>
+# include <unistd.h>
+# include <sys/stat.h>
+# include <sys/time.h>
+# include <sys/wait.h>
+# include "lexer.h"
+# include "source.h"
+# include "parlex.h"
+# include "tokens.h"
+
+using namespace std;
+
+static char dir[] = "/tmp/parbenchXXXXXX";
+
+
+/*
+ * Function:	generate
+ *
+ * Description:	Write a synthetic source file of about the given size.
+ */
+
+static void generate(const string &path, unsigned long size)
+{
+    FILE *fp;
+    unsigned n;
+
+
+    if ((fp = fopen(path.c_str(), "w")) == NULL) {
+	perror(path.c_str());
+	exit(EXIT_FAILURE);
+    }
+
+    for (n = 0; (unsigned long) ftell(fp) < size; n ++)
+	fprintf(fp, "/*\n * Function:\tf%u\n *\n * Description:\tDon't be "
+		"fooled by \"quotes\" or 'ticks' in here.\n */\n\n"
+		"int f%u(int a, char *s)\n{\n    int i, n;\n\n"
+		"    n = 0;\n\n    for (i = 0; s[i] != '\\0'; i ++)\n"
+		"\tif (s[i] == '\"' || s[i] == '/')\n\t    n = n + %u;\n\n"
+		"    printf(\"f%u: /* %%d */ \\\"done\\\"\\n\", n);\n"
+		"    return n;\n}\n\n", n, n, n, n);
+
+    fclose(fp);
+}
+
+
+/*
+ * Function:	now
+ *
+ * Description:	Return the wall clock time in seconds.  CPU time would
+ *		count the work of every thread, which is not the point.
+ */
+
+static double now()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+
+/*
+ * Function:	measure
+ *
+ * Description:	Produce the token stream for the file in a child process
+ *		and report how long it took and a checksum of the stream.
+ *		The text of each lexeme may be in a different buffer from
+ *		one run to the next, so only its ends are checked.
+ *		Zero threads means the lexical analyzer alone.
+ */
+
+static unsigned long measure(char *path, unsigned threads, double &secs)
+{
+    int fds[2], status;
+    unsigned long sum = 0;
+    double start;
+    Token token;
+
+
+    if (pipe(fds) < 0) {
+	perror("pipe");
+	exit(EXIT_FAILURE);
+    }
+
+    if (fork() == 0) {
+	start = now();
+
+	if (!openParallel(1, &path, threads))
+	    openSource(1, &path);
+
+	while ((parallel ? parallelToken(token) : lexan(token)) != DONE) {
+	    sum = sum * 31 + token.kind;
+	    sum = sum * 31 + token.lexeme.length;
+	    sum = sum * 31 + token.lexeme.text[0];
+	    sum = sum * 31 + token.lexeme.text[token.lexeme.length - 1];
+	    sum = sum * 31 + lineno;
+	    releaseSource();
+	}
+
+	secs = now() - start;
+	write(fds[1], &sum, sizeof(sum));
+	write(fds[1], &secs, sizeof(secs));
+	_exit(EXIT_SUCCESS);
+    }
+
+    close(fds[1]);
+    read(fds[0], &sum, sizeof(sum));
+    read(fds[0], &secs, sizeof(secs));
+    close(fds[0]);
+    wait(&status);
+    return sum;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Benchmark the sequential and parallel lexical analyzers.
+ */
+
+int main(int argc, char *argv[])
+{
+    struct stat st;
+    string source;
+    unsigned cores;
+    unsigned long expected, actual;
+    double base, secs;
+
+
+    if (mkdtemp(dir) == NULL) {
+	perror(dir);
+	exit(EXIT_FAILURE);
+    }
+
+    if (argc > 1 && stat(argv[1], &st) == 0)
+	source = argv[1];
+    else {
+	source = string(dir) + "/source.c";
+	generate(source, (argc > 1 ? atoi(argv[1]) : 256) * 1048576UL);
+    }
+
+    stat(source.c_str(), &st);
+    cores = thread::hardware_concurrency();
+    printf("source   %8.1f MB, %u cores\n", st.st_size / 1048576.0, cores);
+
+    expected = measure(&source[0], 0, base);
+    printf("lexan    %8.1f ms\n", base * 1e3);
+
+    for (unsigned n = 2; n <= 2 * cores || n <= 4; n *= 2) {
+	actual = measure(&source[0], n, secs);
+	printf("%2u threads %6.1f ms  speedup %5.2fx%s\n", n, secs * 1e3,
+	       base / secs, actual != expected ? "  MISMATCH" : "");
+    }
+
+    if (source == string(dir) + "/source.c")
+	unlink(source.c_str());
+
+    rmdir(dir);
+    exit(EXIT_SUCCESS);
+}
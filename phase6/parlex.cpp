@@ -0,0 +1,465 @@
+/*
+ * File:	parlex.cpp
+ *
+ * Description:	This file contains the public and private function and
+ *		variable definitions for the parallel lexical analyzer for
+ *		Simple C.
+ *
+ *		The source file is mapped in its entirety and split into
+ *		chunks at line boundaries.  Each worker lexes a chunk as if
+ *		it began outside of any token, and keeps going past the end
+ *		of the chunk until a token starts beyond it.  Line numbers
+ *		are counted from the start of the chunk.
+ *
+ *		That guess is usually right, but a chunk may begin inside a
+ *		comment or a literal.  So, as the parser consumes the tokens,
+ *		we reconcile each chunk with the one before it.  Where the
+ *		previous chunk stopped is the start of a real token.  If the
+ *		next chunk has a token starting at the same place, then
+ *		from there on the two agree, since the lexical analyzer has
+ *		no state between tokens other than its position.  If not,
+ *		we lex from that place ourselves until we reach a token the
+ *		chunk does have, which happens as soon as the comment or
+ *		literal that fooled the worker is behind us.
+ *
+ *		Workers don't intern identifiers or strings or report
+ *		errors.  These are done as the tokens are handed to the
+ *		parser, so the interning table needs no locking and the
+ *		errors come out in order and with the right line numbers.
+ */
+
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <vector>
+# include <thread>
+# include <mutex>
+# include <condition_variable>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "parlex.h"
+# include "source.h"
+# include "tokens.h"
+
+# ifndef CHUNK_SIZE
+# define CHUNK_SIZE (1024 * 1024)
+# endif
+
+# ifndef PARALLEL_MINIMUM
+# define PARALLEL_MINIMUM (8 * 1024 * 1024)
+# endif
+
+# define CHUNKS_AHEAD 2
+
+using namespace std;
+
+struct Lexed {
+    const char *text;
+    unsigned length;
+    unsigned value;
+    int kind;
+    int line;
+};
+
+struct Error {
+    unsigned token;
+    const char *message;
+};
+
+struct Chunk {
+    const char *start, *end, *stop;
+    vector<Lexed> *tokens;
+    vector<Error> *errors;
+    int line;
+    bool done;
+};
+
+
+/* Only a few chunks are lexed ahead of the parser, so the chunks take
+   turns using the same few vectors for their tokens.  Reusing them saves
+   allocating and faulting in fresh memory for every chunk.  The pool is
+   allocated and never freed, since the workers may still be running when
+   the compiler exits. */
+
+struct Storage {
+    vector<Lexed> tokens;
+    vector<Error> errors;
+};
+
+struct Pool {
+    mutex lock;
+    condition_variable ready, room;
+    vector<Chunk> chunks;
+    vector<Storage> slots;
+    unsigned claimed, released, ahead;
+};
+
+bool parallel;
+
+static Pool *pool;
+static const char *source, *finish;
+
+static unsigned current, taken, error;
+static int delta;
+static bool relexing, over;
+
+
+/*
+ * Function:	lexChunk
+ *
+ * Description:	Lex the given chunk, stopping at the first token that
+ *		starts beyond it or at the end of the source.
+ */
+
+static void lexChunk(Chunk &chunk)
+{
+    Token token;
+    const char *message;
+    Lexed lexed;
+    Error e;
+
+
+    openBuffer(chunk.start, finish);
+    restartLexer();
+    lineno = 0;
+    chunk.tokens->clear();
+    chunk.errors->clear();
+
+    while (lexanDeferred(token, message) != DONE) {
+	if (token.lexeme.text >= chunk.end)
+	    break;
+
+	if (message != nullptr) {
+	    e.token = chunk.tokens->size();
+	    e.message = message;
+	    chunk.errors->push_back(e);
+	}
+
+	lexed.text = token.lexeme.text;
+	lexed.length = token.lexeme.length;
+	lexed.value = token.value;
+	lexed.kind = token.kind;
+	lexed.line = lineno;
+	chunk.tokens->push_back(lexed);
+    }
+
+    chunk.stop = token.kind == DONE ? finish : token.lexeme.text;
+    chunk.line = lineno;
+}
+
+
+/*
+ * Function:	work
+ *
+ * Description:	Lex chunks in order until there are none left.  A worker
+ *		may not get too far ahead of the parser, so that only a few
+ *		chunks of tokens exist at any one time.
+ */
+
+static void work()
+{
+    unsigned i;
+
+
+    while (true) {
+	{
+	    unique_lock<mutex> guard(pool->lock);
+
+	    while (pool->claimed < pool->chunks.size() &&
+		    pool->claimed >= pool->released + pool->ahead)
+		pool->room.wait(guard);
+
+	    if (pool->claimed == pool->chunks.size())
+		return;
+
+	    i = pool->claimed ++;
+	}
+
+	lexChunk(pool->chunks[i]);
+
+	{
+	    lock_guard<mutex> guard(pool->lock);
+	    pool->chunks[i].done = true;
+	}
+
+	pool->ready.notify_all();
+    }
+}
+
+
+/*
+ * Function:	await
+ *
+ * Description:	Wait for the given chunk to be lexed.
+ */
+
+static Chunk &await(unsigned i)
+{
+    unique_lock<mutex> guard(pool->lock);
+
+    while (!pool->chunks[i].done)
+	pool->ready.wait(guard);
+
+    return pool->chunks[i];
+}
+
+
+/*
+ * Function:	nextChunk
+ *
+ * Description:	Move on to the next chunk, releasing the current one so
+ *		that a worker can reuse its vectors for another chunk.
+ */
+
+static Chunk &nextChunk()
+{
+    {
+	lock_guard<mutex> guard(pool->lock);
+	pool->released = ++ current;
+    }
+
+    pool->room.notify_all();
+    return await(current);
+}
+
+
+/*
+ * Function:	locate
+ *
+ * Description:	Return the index of the token of the current chunk that
+ *		starts at the given place, or -1 if there isn't one.  Any
+ *		chunk that stops before that place is skipped.
+ */
+
+static int locate(const char *text)
+{
+    Chunk *chunk = &await(current);
+    unsigned lo, hi, mid;
+
+
+    while (chunk->stop <= text)
+	chunk = &nextChunk();
+
+    lo = 0;
+    hi = chunk->tokens->size();
+
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+
+	if ((*chunk->tokens)[mid].text < text)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    if (lo < chunk->tokens->size() && (*chunk->tokens)[lo].text == text)
+	return lo;
+
+    return -1;
+}
+
+
+/*
+ * Function:	resume
+ *
+ * Description:	Resume taking tokens from the current chunk at the given
+ *		token, which is on the given line.
+ */
+
+static void resume(int token, int line)
+{
+    Chunk &chunk = pool->chunks[current];
+
+
+    taken = token;
+    delta = line - (*chunk.tokens)[token].line;
+
+    for (error = 0; error < chunk.errors->size(); error ++)
+	if ((*chunk.errors)[error].token >= taken)
+	    break;
+
+    relexing = false;
+}
+
+
+/*
+ * Function:	reconcile
+ *
+ * Description:	Continue from where the last chunk stopped, which is the
+ *		start of a token on the given line.  If the next chunk agrees,
+ *		we take its tokens.  Otherwise, we lex from there ourselves.
+ */
+
+static void reconcile(const char *text, int line)
+{
+    int token;
+
+
+    if ((token = locate(text)) >= 0)
+	resume(token, line);
+    else {
+	openBuffer(text, finish);
+	restartLexer();
+	lineno = line;
+	relexing = true;
+    }
+}
+
+
+/*
+ * Function:	openParallel
+ *
+ * Description:	Start lexing the given source file on the given number of
+ *		threads.  Return false if the source isn't worth lexing in
+ *		parallel, in which case nothing has been done.
+ */
+
+bool openParallel(int count, char *paths[], unsigned threads)
+{
+    struct stat st;
+    const char *start, *end;
+    long pagesize;
+    char *base;
+    void *addr;
+    Chunk chunk;
+    int fd;
+
+
+    if (count != 1 || threads < 2)
+	return false;
+
+    if ((fd = open(paths[0], O_RDONLY)) < 0)
+	return false;
+
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) ||
+	    st.st_size < PARALLEL_MINIMUM || st.st_size == 0) {
+	close(fd);
+	return false;
+    }
+
+
+    /* As in source.cpp, the file is mapped over an anonymous
+       reservation with an extra page for the sentinel and padding. */
+
+    pagesize = sysconf(_SC_PAGESIZE);
+    addr = mmap(NULL, st.st_size + pagesize, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (addr == MAP_FAILED ||
+	    mmap(addr, st.st_size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+	close(fd);
+	return false;
+    }
+
+    close(fd);
+    base = (char *) addr;
+    base[st.st_size] = '\0';
+    source = base;
+    finish = base + st.st_size;
+
+    pool = new Pool();
+    pool->ahead = CHUNKS_AHEAD * threads;
+    pool->slots.resize(pool->ahead);
+    chunk.stop = NULL;
+    chunk.line = 0;
+    chunk.done = false;
+
+    for (start = source; start < finish; start = end) {
+	end = start + CHUNK_SIZE < finish ? start + CHUNK_SIZE : finish;
+
+	if (end < finish)
+	    end = (const char *) memchr(end, '\n', finish - end);
+
+	end = end != NULL && end < finish ? end + 1 : finish;
+
+	chunk.start = start;
+	chunk.end = end;
+	chunk.tokens = &pool->slots[pool->chunks.size() % pool->ahead].tokens;
+	chunk.errors = &pool->slots[pool->chunks.size() % pool->ahead].errors;
+	pool->chunks.push_back(chunk);
+    }
+
+    for (unsigned i = 0; i < threads; i ++)
+	thread(work).detach();
+
+    delta = 1;
+    parallel = true;
+    return true;
+}
+
+
+/*
+ * Function:	parallelToken
+ *
+ * Description:	Return the next token, just as lexan() would.
+ */
+
+int parallelToken(Token &token)
+{
+    const char *message;
+    Chunk *chunk;
+    Lexed *lexed;
+    int index;
+
+
+    while (!over) {
+	if (relexing) {
+	    if (lexanDeferred(token, message) == DONE)
+		break;
+
+	    if ((index = locate(token.lexeme.text)) >= 0)
+		resume(index, lineno);
+	    else {
+		if (token.kind == ID)
+		    token.name = intern(token.lexeme.text, token.lexeme.length);
+		else if (token.kind == STRING)
+		    token.name = strval(token.lexeme);
+
+		if (message != nullptr)
+		    report(message);
+
+		return token.kind;
+	    }
+	}
+
+	chunk = &await(current);
+
+	if (taken == chunk->tokens->size()) {
+	    lineno = chunk->line + delta;
+
+	    if (chunk->stop == finish)
+		break;
+
+	    reconcile(chunk->stop, lineno);
+	    continue;
+	}
+
+	lexed = &(*chunk->tokens)[taken];
+	lineno = lexed->line + delta;
+	token.kind = lexed->kind;
+	token.lexeme.text = lexed->text;
+	token.lexeme.length = lexed->length;
+	token.value = lexed->value;
+
+	if (token.kind == ID)
+	    token.name = intern(lexed->text, lexed->length);
+	else if (token.kind == STRING)
+	    token.name = strval(token.lexeme);
+
+	if (error < chunk->errors->size() &&
+		(*chunk->errors)[error].token == taken)
+	    report((*chunk->errors)[error ++].message);
+
+	taken ++;
+	return token.kind;
+    }
+
+    over = true;
+    token.kind = DONE;
+    token.lexeme.text = "";
+    token.lexeme.length = 0;
+    return DONE;
+}
@@ -0,0 +1,22 @@
+/*
+ * File:	parlex.h
+ *
+ * Description:	This file contains the public function and variable
+ *		declarations for the parallel lexical analyzer for Simple C.
+ *
+ *		A large source file is split into chunks that are lexed by
+ *		a pool of threads while the parser consumes the tokens.  The
+ *		tokens, line numbers, and error messages are exactly those
+ *		that the lexical analyzer would have produced by itself.
+ */
+
+# ifndef PARLEX_H
+# define PARLEX_H
+# include "lexer.h"
+
+extern bool parallel;
+
+bool openParallel(int count, char *paths[], unsigned threads);
+int parallelToken(Token &token);
+
+# endif /* PARLEX_H */
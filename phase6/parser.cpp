@@ -6,48 +6,196 @@
  *		Simple C.
  */
 
+# include <chrono>
+# include <climits>
+# include <condition_variable>
 # include <cstdlib>
+# include <cstring>
 # include <iostream>
+# include <mutex>
+# include <set>
+# include <thread>
 # include "lexer.h"
+# include "source.h"
+# include "cache.h"
+# include "parlex.h"
+# include "preproc.h"
+# include "watch.h"
 # include "tokens.h"
 # include "checker.h"
 # include "generator.h"
+# include "arena.h"
+# include "flat.h"
+# include "module.h"
+
+# define STREAM_SIZE	(1 << 20)	/* tokens to make room for in stages */
 
 using namespace std;
 
-static int lookahead, nexttoken;
-static string lexbuf, nextbuf;
+static __thread int lookahead;
+static __thread Token tokens[2];
+static __thread unsigned first, count;
+static Name integer = intern("int"), character = intern("char");
 
-static Type returnType;
+static thread_local Type returnType;
 static Expression *expression();
 static Statement *statement();
 
 static Symbols globals;
+static Arena scratch;
+static bool skimming;
+
+
+/* In watch mode, we remember the range of tokens of each top-level
+   declaration, along with its changes to the global state and its
+   diagnostics.  The line numbers of the diagnostics are relative to the
+   first token, so that they stay right when lines are added above. */
+
+struct Declaration {
+    unsigned first, last;
+    bool broken;
+    Changes changes;
+    vector<Diagnostic> diagnostics;
+};
+
+struct SyntaxError {};
+
+static vector<Declaration> watched;
+
+
+/* When parsing in stages, the entire token stream is read first, along
+   with any lexical errors, which are kept with the token they were
+   reported on.  The top-level declarations are then parsed in order, but
+   the body of each function definition is skipped by matching braces.
+   Each declaration is kept as a unit, with its diagnostics and, for a
+   function definition, the range of tokens of its body, the scope of
+   its parameters, the arena that holds them and its tree, and the
+   number of changes to the global state before it.  Last, the bodies
+   are parsed and checked on worker threads, each against the global
+   state as it was at that point, while the main thread writes the
+   diagnostics and the code of each unit in order.
+
+   A body is not claimed until fewer than a window of bodies have been
+   claimed and not yet written, so that only so many trees are held at
+   once, however far the workers could run ahead.
+
+   The diagnostics of a function definition are those of its signature,
+   of its body, and of the token after its body, which the parser reads
+   before generating code for the function.  Each thread reads the
+   stream from its own position, and a lexical error is reported again
+   only by the thread that owns the token.  A field reported missing by
+   a body is reported only if no earlier body did, as it would be if
+   the first report had added the field to its structure.  A body that
+   would have failed an assertion is abandoned, and the main thread
+   fails in the same way once it has written everything before it. */
+
+struct Tokenized {
+    Token token;
+    int line;
+    unsigned errors;
+};
+
+struct Unit {
+    unsigned first, last, horizon;
+    bool body, broken, failed, done;
+    Symbol *symbol;
+    Scope *scope;
+    Arena *arena;
+    Type type, unsizable;
+    Function *function;
+    vector<Diagnostic> before, during, after;
+    MissingFields missing;
+};
+
+struct Stages {
+    vector<Tokenized> stream;
+    vector<Diagnostic> lexical;
+    Changes history;
+    vector<Unit> units;
+    vector<unsigned> bodies;
+    unsigned claimed, retired, window;
+    bool stopping;
+    mutex lock;
+    condition_variable ready;
+};
+
+static Stages *stages;
+static __thread unsigned position, owned;
 
 
 /*
  * Function:	error
  *
- * Description:	Report a syntax error to standard error.
+ * Description:	Report a syntax error to standard error.  In watch mode,
+ *		only the declaration being parsed is abandoned.
  */
 
 static void error()
 {
+    const Lexeme &lexeme = tokens[first].lexeme;
+
+
     if (lookahead == DONE)
 	report("syntax error at end of file");
     else
-	report("syntax error at '%s'", lexbuf);
+	report("syntax error at '%s'", string(lexeme.text, lexeme.length));
+
+    if (watching || stages != nullptr)
+	throw SyntaxError();
 
     exit(EXIT_FAILURE);
 }
 
 
+/*
+ * Function:	fetch
+ *
+ * Description:	Read the next token.  When parsing in stages, the token is
+ *		taken from the stream, and any lexical errors on it are
+ *		reported again if this thread owns it.  Reading past the
+ *		end of the stream just reads the end again.
+ */
+
+static int fetch(Token &token)
+{
+    const Tokenized *tokenized;
+    unsigned i, j;
+
+
+    if (stages == nullptr)
+	return preprocess(token);
+
+    if (position == stages->stream.size()) {
+	tokenized = &stages->stream.back();
+	token = tokenized->token;
+	lineno = tokenized->line;
+	return DONE;
+    }
+
+    i = position ++;
+    tokenized = &stages->stream[i];
+    token = tokenized->token;
+    lineno = tokenized->line;
+
+    if (i < owned) {
+	j = i > 0 ? stages->stream[i - 1].errors : 0;
+
+	while (j < tokenized->errors)
+	    diagnostics->push_back(stages->lexical[j ++]);
+    }
+
+    return token.kind;
+}
+
+
 /*
  * Function:	match
  *
  * Description:	Match the next token against the specified token.  A
  *		failure indicates a syntax error and will terminate the
- *		program since our parser does not do error recovery.
+ *		program since our parser does not do error recovery.  The
+ *		tokens read ahead are kept in a small ring, so advancing is
+ *		just a matter of moving to the next slot.
  */
 
 static void match(int t)
@@ -55,12 +203,14 @@ static void match(int t)
     if (lookahead != t)
 	error();
 
-    if (nexttoken) {
-	lookahead = nexttoken;
-	lexbuf = nextbuf;
-	nexttoken = 0;
-    } else
-	lookahead = lexan(lexbuf);
+    first = (first + 1) % 2;
+
+    if (-- count == 0) {
+	fetch(tokens[first]);
+	count = 1;
+    }
+
+    lookahead = tokens[first].kind;
 }
 
 
@@ -73,39 +223,42 @@ static void match(int t)
 
 static int peek()
 {
-    if (!nexttoken)
-	nexttoken = lexan(nextbuf);
+    if (count < 2) {
+	fetch(tokens[(first + 1) % 2]);
+	count = 2;
+    }
 
-    return nexttoken;
+    return tokens[(first + 1) % 2].kind;
 }
 
 
 /*
- * Function:	expect
+ * Function:	identifier
  *
- * Description:	Match the next token against the specified token, and
- *		return its lexeme.  We must save the contents of the buffer
- *		from the lexical analyzer before matching, since matching
- *		will advance to the next token.
+ * Description:	Match the next token as an identifier and return its
+ *		interned name.
  */
 
-static string expect(int t)
+static Name identifier()
 {
-    string buf = lexbuf;
-    match(t);
-    return buf;
+    Name name = tokens[first].name;
+    match(ID);
+    return name;
 }
 
 
 /*
  * Function:	number
  *
- * Description:	Match the next token as a number and return its value.
+ * Description:	Match the next token as a number and return its value,
+ *		which was computed by the lexical analyzer.
  */
 
 static unsigned long number()
 {
-    return strtoul(expect(NUM).c_str(), NULL, 0);
+    unsigned value = tokens[first].value;
+    match(NUM);
+    return value;
 }
 
 
@@ -133,13 +286,20 @@ static bool isSpecifier(int token)
  *		  struct identifier
  */
 
-static string specifier()
+static Name specifier()
 {
-    if (lookahead == INT || lookahead == CHAR)
-	return expect(lookahead);
+    if (lookahead == INT) {
+	match(INT);
+	return integer;
+    }
+
+    if (lookahead == CHAR) {
+	match(CHAR);
+	return character;
+    }
 
     match(STRUCT);
-    return expect(ID);
+    return identifier();
 }
 
 
@@ -178,14 +338,14 @@ static unsigned pointers()
  *		  pointers identifier [ num ]
  */
 
-static void declarator(const string &typespec)
+static void declarator(Name typespec)
 {
     unsigned indirection;
-    string name;
+    Name name;
 
 
     indirection = pointers();
-    name = expect(ID);
+    name = identifier();
 
     if (lookahead == '[') {
 	match('[');
@@ -214,7 +374,7 @@ static void declarator(const string &typespec)
 
 static void declaration()
 {
-    string typespec;
+    Name typespec;
 
 
     typespec = specifier();
@@ -246,10 +406,138 @@ static void declarations()
 }
 
 
+/* The binary operators are parsed by their precedence, rather than by
+   a function for each level of precedence, so that an operand needn't
+   pass through every level to reach the operator after it.  The table
+   gives the precedence of each token as a binary operator, or zero if it
+   isn't one, and the function that checks it.  Every binary operator in
+   Simple C is left associative.  Note that Simple C does not have shift
+   or bitwise operators. */
+
+struct BinaryOperator {
+    unsigned precedence;
+    Expression *(*check)(Expression *left, Expression *right);
+};
+
+struct OperatorTable {
+    BinaryOperator binary[DONE + 1];
+};
+
+
+/*
+ * Function:	buildOperatorTable
+ *
+ * Description:	Build the table of binary operators.  This is evaluated
+ *		entirely at compile time.
+ */
+
+static constexpr OperatorTable buildOperatorTable()
+{
+    OperatorTable table = {};
+
+
+    table.binary[OR] = {1, checkLogicalOr};
+    table.binary[AND] = {2, checkLogicalAnd};
+    table.binary[EQL] = {3, checkEqual};
+    table.binary[NEQ] = {3, checkNotEqual};
+    table.binary['<'] = {4, checkLessThan};
+    table.binary['>'] = {4, checkGreaterThan};
+    table.binary[LEQ] = {4, checkLessOrEqual};
+    table.binary[GEQ] = {4, checkGreaterOrEqual};
+    table.binary['+'] = {5, checkAdd};
+    table.binary['-'] = {5, checkSubtract};
+    table.binary['*'] = {6, checkMultiply};
+    table.binary['/'] = {6, checkDivide};
+    table.binary['%'] = {6, checkRemainder};
+    return table;
+}
+
+static constexpr OperatorTable operators = buildOperatorTable();
+
+
+/* Machine-generated code can nest expressions far more deeply than the
+   native stack allows for recursive descent, so expressions are parsed
+   with an explicit stack instead.  The stack holds whatever is waiting
+   for the operand being parsed: casts and prefix operators, binary
+   operators with their left operands, and the parentheses, brackets,
+   and calls that enclose the operand.  The parser moves between three
+   states: starting an operand, applying postfix operators to a primary
+   expression, and finishing an operand once no postfix operator
+   follows.  The checker functions are called in exactly the same order
+   as they would be by recursive descent, so the diagnostics are the
+   same as well. */
+
+enum { PREFIX, TYPECAST, INFIX, PAREN, INDEX, ARGS };
+enum { OPERAND, POSTFIX, FINISH };
+
+struct Waiting {
+    int kind, token;
+    const BinaryOperator *op;
+    Expression *left;
+    Symbol *symbol;
+    Expressions args;
+    Type type;
+};
+
+static thread_local vector<Waiting> waiting;
+
+
+/*
+ * Function:	wait
+ *
+ * Description:	Push an entry of the given kind onto the stack of things
+ *		waiting for the current operand, and return it.
+ */
+
+static Waiting &wait(int kind)
+{
+    waiting.push_back(Waiting());
+    waiting.back().kind = kind;
+    return waiting.back();
+}
+
+
 /*
- * Function:	primaryExpression
+ * Function:	expression
+ *
+ * Description:	Parse an expression, or more specifically, a logical-or
+ *		expression, since Simple C does not allow comma or
+ *		assignment as an expression operator.
  *
- * Description:	Parse a primary expression.
+ *		expression:
+ *		  cast-expression
+ *		  expression || expression			(1)
+ *		  expression && expression			(2)
+ *		  expression == expression			(3)
+ *		  expression != expression			(3)
+ *		  expression < expression			(4)
+ *		  expression > expression			(4)
+ *		  expression <= expression			(4)
+ *		  expression >= expression			(4)
+ *		  expression + expression			(5)
+ *		  expression - expression			(5)
+ *		  expression * expression			(6)
+ *		  expression / expression			(6)
+ *		  expression % expression			(6)
+ *
+ *		cast-expression:
+ *		  prefix-expression
+ *		  ( specifier pointers ) cast-expression
+ *
+ *		prefix-expression:
+ *		  postfix-expression
+ *		  ! prefix-expression
+ *		  - prefix-expression
+ *		  * prefix-expression
+ *		  & prefix-expression
+ *		  sizeof prefix-expression
+ *		  sizeof ( specifier pointers )
+ *
+ *		postfix-expression:
+ *		  primary-expression
+ *		  postfix-expression [ expression ]
+ *		  postfix-expression . identifier
+ *		  postfix-expression -> identifier
  *
  *		primary-expression:
  *		  ( expression )
@@ -263,588 +551,506 @@ static void declarations()
  *		expression-list:
  *		  expression
  *		  expression , expression-list
+ *
+ *		If the token after an opening parenthesis is a type
+ *		specifier, we have a cast rather than a parenthesized
+ *		expression.  A cast cannot follow a prefix operator.
+ *		Binary operators of higher precedence are checked first,
+ *		and of the same precedence from left to right.
  */
 
-static Expression *primaryExpression()
+static Expression *expression()
 {
-    Symbol *symbol;
+    const BinaryOperator *op;
+    unsigned indirection;
     Expression *expr;
     Expressions args;
+    Symbol *symbol;
+    Name typespec;
+    int state;
+    bool cast;
+
+
+    waiting.clear();
+    state = OPERAND;
+    expr = nullptr;
+
+    while (true) {
+	if (state == OPERAND) {
+
+	    /* Any casts and prefix operators wait for the operand. */
+
+	    cast = true;
+
+	    while (true) {
+		if (cast && lookahead == '(' && isSpecifier(peek())) {
+		    match('(');
+		    typespec = specifier();
+		    indirection = pointers();
+		    match(')');
+		    wait(TYPECAST).type = Type(typespec, indirection);
+
+		} else if (lookahead == '!' || lookahead == '-' ||
+			lookahead == '*' || lookahead == '&') {
+		    wait(PREFIX).token = lookahead;
+		    match(lookahead);
+		    cast = false;
+
+		} else if (lookahead == SIZEOF) {
+		    match(SIZEOF);
+
+		    if (lookahead == '(' && isSpecifier(peek())) {
+			match('(');
+			typespec = specifier();
+			indirection = pointers();
+			match(')');
+			expr = checkSizeof(Type(typespec, indirection));
+			state = FINISH;
+			break;
+		    }
+
+		    wait(PREFIX).token = SIZEOF;
+		    cast = false;
+
+		} else
+		    break;
+	    }
 
+	    if (state == FINISH)
+		continue;
 
-    if (lookahead == '(') {
-	match('(');
-	expr = expression();
-	match(')');
 
-    } else if (lookahead == CHARACTER) {
-	expr = new Character(expect(CHARACTER));
+	    /* A parenthesized expression or the arguments of a call wait
+	       for their contents, which are a new operand. */
 
-    } else if (lookahead == STRING) {
-	expr = new String(expect(STRING));
+	    if (lookahead == '(') {
+		match('(');
+		wait(PAREN);
+		continue;
 
-    } else if (lookahead == NUM) {
-	expr = new Number(expect(NUM));
+	    } else if (lookahead == CHARACTER) {
+		expr = new Character(tokens[first].value);
+		match(CHARACTER);
 
-    } else if (lookahead == ID) {
-	symbol = checkIdentifier(expect(ID));
+	    } else if (lookahead == STRING) {
+		expr = new String(tokens[first].name);
+		match(STRING);
 
-	if (lookahead == '(') {
-	    match('(');
+	    } else if (lookahead == NUM) {
+		expr = new Number(number());
 
-	    if (lookahead != ')') {
-		args.push_back(expression());
+	    } else if (lookahead == ID) {
+		symbol = checkIdentifier(identifier());
 
-		while (lookahead == ',') {
-		    match(',');
-		    args.push_back(expression());
-		}
-	    }
+		if (lookahead == '(') {
+		    match('(');
 
-	    expr = checkCall(symbol, args);
-	    match(')');
+		    if (lookahead != ')') {
+			wait(ARGS).symbol = symbol;
+			continue;
+		    }
 
-	} else
-	    expr = new Identifier(symbol);
+		    expr = checkCall(symbol, args);
+		    match(')');
 
-    } else {
-	expr = nullptr;
-	error();
-    }
+		} else
+		    expr = new Identifier(symbol);
 
-    return expr;
-}
+	    } else
+		error();
 
+	    state = POSTFIX;
 
-/*
- * Function:	postfixExpression
- *
- * Description:	Parse a postfix expression.
- *
- *		postfix-expression:
- *		  primary-expression
- *		  postfix-expression [ expression ]
- *		  postfix-expression . identifier
- *		  postfix-expression -> identifier
- */
+	} else if (state == POSTFIX) {
 
-static Expression *postfixExpression()
-{
-    Expression *left, *right;
+	    /* An index waits for its expression, which is a new operand. */
 
+	    while (lookahead == '.' || lookahead == ARROW) {
+		if (lookahead == '.') {
+		    match('.');
+		    expr = checkDirectField(expr, identifier());
 
-    left = primaryExpression();
+		} else {
+		    match(ARROW);
+		    expr = checkIndirectField(expr, identifier());
+		}
+	    }
 
-    while (1) {
-	if (lookahead == '[') {
-	    match('[');
-	    right = expression();
-	    left = checkArray(left, right);
-	    match(']');
+	    if (lookahead == '[') {
+		match('[');
+		wait(INDEX).left = expr;
+		state = OPERAND;
 
-	} else if (lookahead == '.') {
-	    match('.');
-	    left = checkDirectField(left, expect(ID));
+	    } else
+		state = FINISH;
 
-	} else if (lookahead == ARROW) {
-	    match(ARROW);
-	    left = checkIndirectField(left, expect(ID));
+	} else {
 
-	} else
-	    break;
-    }
+	    /* Apply the prefix operators and casts, and then any binary
+	       operators of at least the precedence of the next one. */
+
+	    while (!waiting.empty() && (waiting.back().kind == PREFIX ||
+		    waiting.back().kind == TYPECAST)) {
+		if (waiting.back().kind == TYPECAST)
+		    expr = checkCast(waiting.back().type, expr);
+		else if (waiting.back().token == '!')
+		    expr = checkNot(expr);
+		else if (waiting.back().token == '-')
+		    expr = checkNegate(expr);
+		else if (waiting.back().token == '*')
+		    expr = checkDereference(expr);
+		else if (waiting.back().token == '&')
+		    expr = checkAddress(expr);
+		else
+		    expr = checkSizeof(expr->type());
+
+		waiting.pop_back();
+	    }
 
-    return left;
-}
+	    op = &operators.binary[lookahead];
 
+	    while (!waiting.empty() && waiting.back().kind == INFIX &&
+		    waiting.back().op->precedence >= op->precedence) {
+		expr = waiting.back().op->check(waiting.back().left, expr);
+		waiting.pop_back();
+	    }
 
-/*
- * Function:	prefixExpression
- *
- * Description:	Parse a prefix expression.
- *
- *		prefix-expression:
- *		  postfix-expression
- *		  ! prefix-expression
- *		  - prefix-expression
- *		  * prefix-expression
- *		  & prefix-expression
- *		  sizeof prefix-expression
- *		  sizeof ( specifier pointers )
- */
+	    if (op->precedence > 0) {
+		wait(INFIX).op = op;
+		waiting.back().left = expr;
+		match(lookahead);
+		state = OPERAND;
+		continue;
+	    }
 
-static Expression *prefixExpression()
-{
-    Expression *expr;
-    unsigned indirection;
-    string typespec;
 
+	    /* Otherwise, the operand is complete, and so is whatever
+	       encloses it. */
 
-    if (lookahead == '!') {
-	match('!');
-	expr = prefixExpression();
-	expr = checkNot(expr);
+	    if (waiting.empty())
+		return expr;
 
-    } else if (lookahead == '-') {
-	match('-');
-	expr = prefixExpression();
-	expr = checkNegate(expr);
+	    if (waiting.back().kind == PAREN)
+		match(')');
 
-    } else if (lookahead == '*') {
-	match('*');
-	expr = prefixExpression();
-	expr = checkDereference(expr);
+	    else if (waiting.back().kind == INDEX) {
+		expr = checkArray(waiting.back().left, expr);
+		match(']');
 
-    } else if (lookahead == '&') {
-	match('&');
-	expr = prefixExpression();
-	expr = checkAddress(expr);
+	    } else {
+		waiting.back().args.push_back(expr);
 
-    } else if (lookahead == SIZEOF) {
-	match(SIZEOF);
+		if (lookahead == ',') {
+		    match(',');
+		    state = OPERAND;
+		    continue;
+		}
 
-	if (lookahead == '(' && isSpecifier(peek())) {
-	    match('(');
-	    typespec = specifier();
-	    indirection = pointers();
-	    match(')');
-	    expr = checkSizeof(Type(typespec, indirection));
+		expr = checkCall(waiting.back().symbol, waiting.back().args);
+		match(')');
+	    }
 
-	} else {
-	    expr = prefixExpression();
-	    expr = checkSizeof(expr->type());
+	    waiting.pop_back();
+	    state = POSTFIX;
 	}
-
-    } else
-	expr = postfixExpression();
-
-    return expr;
+    }
 }
 
 
 /*
- * Function:	castExpression
+ * Function:	statements
  *
- * Description:	Parse a cast expression.  If the token after the opening
- *		parenthesis is not a type specifier, we could have a
- *		parenthesized expression instead.
+ * Description:	Parse a possibly empty sequence of statements.  Rather than
+ *		checking if the next token starts a statement, we check if
+ *		the next token ends the sequence, since a sequence of
+ *		statements is always terminated by a closing brace.
  *
- *		cast-expression:
- *		  prefix-expression
- *		  ( specifier pointers ) cast-expression
+ *		statements:
+ *		  empty
+ *		  statement statements
  */
 
-static Expression *castExpression()
+static Statements statements()
 {
-    Expression *expr;
-    unsigned indirection;
-    string typespec;
-
+    Statements stmts;
 
-    if (lookahead == '(' && isSpecifier(peek())) {
-	match('(');
-	typespec = specifier();
-	indirection = pointers();
-	match(')');
-	expr = castExpression();
-	expr = checkCast(Type(typespec, indirection), expr);
 
-    } else
-	expr = prefixExpression();
+    while (lookahead != '}')
+	stmts.push_back(statement());
 
-    return expr;
+    return stmts;
 }
 
 
-/*
- * Function:	multiplicativeExpression
- *
- * Description:	Parse a multiplicative expression.
- *
- *		multiplicative-expression:
- *		  cast-expression
- *		  multiplicative-expression * cast-expression
- *		  multiplicative-expression / cast-expression
- *		  multiplicative-expression % cast-expression
- */
-
-static Expression *multiplicativeExpression()
-{
-    Expression *left, *right;
-
-
-    left = castExpression();
+/* Statements can be nested as deeply as expressions, so they are parsed
+   with an explicit stack as well.  Each entry is a statement waiting for
+   the statements it contains: a block for its statements, a while or if
+   statement for its body, or an if statement for its else part, in which
+   case it also holds the statement before the else. */
 
-    while (1) {
-	if (lookahead == '*') {
-	    match('*');
-	    right = castExpression();
-	    left = checkMultiply(left, right);
+struct Enclosing {
+    int kind;
+    Expression *expr;
+    Statement *stmt;
+    Statements stmts;
+};
 
-	} else if (lookahead == '/') {
-	    match('/');
-	    right = castExpression();
-	    left = checkDivide(left, right);
+static thread_local vector<Enclosing> enclosing;
 
-	} else if (lookahead == '%') {
-	    match('%');
-	    right = castExpression();
-	    left = checkRemainder(left, right);
 
-	} else
-	    break;
-    }
+/*
+ * Function:	enclose
+ *
+ * Description:	Push a statement of the given kind with the given test
+ *		expression onto the stack of enclosing statements.
+ */
 
-    return left;
+static void enclose(int kind, Expression *expr)
+{
+    enclosing.push_back(Enclosing());
+    enclosing.back().kind = kind;
+    enclosing.back().expr = expr;
 }
 
 
 /*
- * Function:	additiveExpression
+ * Function:	statement
  *
- * Description:	Parse an additive expression.
+ * Description:	Parse a statement.  Note that Simple C has so few
+ *		statements that we handle them all in this one function.
  *
- *		additive-expression:
- *		  multiplicative-expression
- *		  additive-expression + multiplicative-expression
- *		  additive-expression - multiplicative-expression
+ *		statement:
+ *		  { declarations statements }
+ *		  return expression ;
+ *		  while ( expression ) statement
+ *		  if ( expression ) statement
+ *		  if ( expression ) statement else statement
+ *		  expression = expression ;
+ *		  expression ;
  */
 
-static Expression *additiveExpression()
+static Statement *statement()
 {
-    Expression *left, *right;
-
-
-    left = multiplicativeExpression();
-
-    while (1) {
-	if (lookahead == '+') {
-	    match('+');
-	    right = multiplicativeExpression();
-	    left = checkAdd(left, right);
+    Scope *decls;
+    Statement *stmt;
+    Expression *expr;
 
-	} else if (lookahead == '-') {
-	    match('-');
-	    right = multiplicativeExpression();
-	    left = checkSubtract(left, right);
 
-	} else
-	    break;
-    }
+    enclosing.clear();
 
-    return left;
-}
+    while (true) {
+	stmt = nullptr;
 
+	if (lookahead == '{') {
+	    match('{');
+	    openScope();
+	    declarations();
+	    enclose('{', nullptr);
 
-/*
- * Function:	relationalExpression
- *
- * Description:	Parse a relational expression.  Note that Simple C does not
- *		have shift operators, so we go immediately to additive
- *		expressions.
- *
- *		relational-expression:
- *		  additive-expression
- *		  relational-expression < additive-expression
- *		  relational-expression > additive-expression
- *		  relational-expression <= additive-expression
- *		  relational-expression >= additive-expression
- */
+	} else if (lookahead == RETURN) {
+	    match(RETURN);
+	    expr = expression();
+	    checkReturn(expr, returnType);
+	    match(';');
+	    stmt = new Return(expr);
 
-static Expression *relationalExpression()
-{
-    Expression *left, *right;
+	} else if (lookahead == WHILE) {
+	    match(WHILE);
+	    match('(');
+	    expr = expression();
+	    checkTest(expr);
+	    match(')');
+	    enclose(WHILE, expr);
 
+	} else if (lookahead == IF) {
+	    match(IF);
+	    match('(');
+	    expr = expression();
+	    checkTest(expr);
+	    match(')');
+	    enclose(IF, expr);
 
-    left = additiveExpression();
+	} else {
+	    expr = expression();
 
-    while (1) {
-	if (lookahead == '<') {
-	    match('<');
-	    right = additiveExpression();
-	    left = checkLessThan(left, right);
+	    if (lookahead == '=') {
+		match('=');
+		stmt = checkAssignment(expr, expression());
 
-	} else if (lookahead == '>') {
-	    match('>');
-	    right = additiveExpression();
-	    left = checkGreaterThan(left, right);
+	    } else
+		stmt = expr;
 
-	} else if (lookahead == LEQ) {
-	    match(LEQ);
-	    right = additiveExpression();
-	    left = checkLessOrEqual(left, right);
+	    match(';');
+	}
 
-	} else if (lookahead == GEQ) {
-	    match(GEQ);
-	    right = additiveExpression();
-	    left = checkGreaterOrEqual(left, right);
 
-	} else
-	    break;
-    }
+	/* Hand each finished statement to the statement enclosing it,
+	   until one needs another statement. */
 
-    return left;
-}
+	while (true) {
+	    if (stmt == nullptr) {
+		if (enclosing.back().kind != '{' || lookahead != '}')
+		    break;
 
+		decls = closeScope();
+		match('}');
+		stmt = new Block(decls, enclosing.back().stmts);
+		enclosing.pop_back();
+	    }
 
-/*
- * Function:	equalityExpression
- *
- * Description:	Parse an equality expression.
- *
- *		equality-expression:
- *		  relational-expression
- *		  equality-expression == relational-expression
- *		  equality-expression != relational-expression
- */
+	    if (enclosing.empty())
+		return stmt;
 
-static Expression *equalityExpression()
-{
-    Expression *left, *right;
+	    Enclosing &outer = enclosing.back();
 
+	    if (outer.kind == '{') {
+		outer.stmts.push_back(stmt);
+		stmt = nullptr;
 
-    left = relationalExpression();
+	    } else if (outer.kind == WHILE) {
+		stmt = new While(outer.expr, stmt);
+		enclosing.pop_back();
 
-    while (1) {
-	if (lookahead == EQL) {
-	    match(EQL);
-	    right = relationalExpression();
-	    left = checkEqual(left, right);
+	    } else if (outer.kind == IF && lookahead == ELSE) {
+		match(ELSE);
+		outer.kind = ELSE;
+		outer.stmt = stmt;
+		break;
 
-	} else if (lookahead == NEQ) {
-	    match(NEQ);
-	    right = relationalExpression();
-	    left = checkNotEqual(left, right);
+	    } else if (outer.kind == IF) {
+		stmt = new If(outer.expr, stmt, nullptr);
+		enclosing.pop_back();
 
-	} else
-	    break;
+	    } else {
+		stmt = new If(outer.expr, outer.stmt, stmt);
+		enclosing.pop_back();
+	    }
+	}
     }
-
-    return left;
 }
 
 
 /*
- * Function:	logicalAndExpression
+ * Function:	parameter
  *
- * Description:	Parse a logical-and expression.  Note that Simple C does
- *		not have bitwise-and expressions.
+ * Description:	Parse a parameter, which in Simple C is always a scalar
+ *		variable with optional pointer declarators.
  *
- *		logical-and-expression:
- *		  equality-expression
- *		  logical-and-expression && equality-expression
+ *		parameter:
+ *		  specifier pointers identifier
  */
 
-static Expression *logicalAndExpression()
+static Type parameter()
 {
-    Expression *left, *right;
-
+    Name typespec, name;
+    unsigned indirection;
 
-    left = equalityExpression();
 
-    while (lookahead == AND) {
-	match(AND);
-	right = equalityExpression();
-	left = checkLogicalAnd(left, right);
-    }
+    typespec = specifier();
+    indirection = pointers();
+    name = identifier();
 
-    return left;
+    Type type = Type(typespec, indirection);
+    return declareParameter(name, type)->type();
 }
 
 
 /*
- * Function:	expression
- *
- * Description:	Parse an expression, or more specifically, a logical-or
- *		expression, since Simple C does not allow comma or
- *		assignment as an expression operator.
- *
- *		expression:
- *		  logical-and-expression
- *		  expression || logical-and-expression
- */
-
-static Expression *expression()
-{
-    Expression *left, *right;
-
-
-    left = logicalAndExpression();
-
-    while (lookahead == OR) {
-	match(OR);
-	right = logicalAndExpression();
-	left = checkLogicalOr(left, right);
-    }
-
-    return left;
-}
-
-
-/*
- * Function:	statements
- *
- * Description:	Parse a possibly empty sequence of statements.  Rather than
- *		checking if the next token starts a statement, we check if
- *		the next token ends the sequence, since a sequence of
- *		statements is always terminated by a closing brace.
+ * Function:	parameters
  *
- *		statements:
- *		  empty
- *		  statement statements
- */
-
-static Statements statements()
-{
-    Statements stmts;
-
-
-    while (lookahead != '}')
-	stmts.push_back(statement());
-
-    return stmts;
-}
-
-
-/*
- * Function:	statement
+ * Description:	Parse the parameters of a function, but not the opening or
+ *		closing parentheses.
  *
- * Description:	Parse a statement.  Note that Simple C has so few
- *		statements that we handle them all in this one function.
+ *		parameters:
+ *		  void
+ *		  parameter-list
  *
- *		statement:
- *		  { declarations statements }
- *		  return expression ;
- *		  while ( expression ) statement
- *		  if ( expression ) statement
- *		  if ( expression ) statement else statement
- *		  expression = expression ;
- *		  expression ;
+ *		parameter-list:
+ *		  parameter
+ *		  parameter , parameter-list
  */
 
-static Statement *statement()
+static Parameters *parameters()
 {
-    Scope *decls;
-    Statement *stmt;
-    Statements stmts;
-    Expression *expr;
-
-
-    if (lookahead == '{') {
-	match('{');
-	openScope();
-	declarations();
-	stmts = statements();
-	decls = closeScope();
-	match('}');
-	return new Block(decls, stmts);
-    }
-
-    if (lookahead == RETURN) {
-	match(RETURN);
-	expr = expression();
-	checkReturn(expr, returnType);
-	match(';');
-	return new Return(expr);
-    }
+    Parameters *params = new (permanent) Parameters();
 
-    if (lookahead == WHILE) {
-	match(WHILE);
-	match('(');
-	expr = expression();
-	checkTest(expr);
-	match(')');
-	stmt = statement();
-	return new While(expr, stmt);
-    }
 
-    if (lookahead == IF) {
-	match(IF);
-	match('(');
-	expr = expression();
-	checkTest(expr);
-	match(')');
-	stmt = statement();
+    if (lookahead == VOID)
+	match(VOID);
 
-	if (lookahead != ELSE)
-	    return new If(expr, stmt, nullptr);
+    else {
+	params->push_back(parameter());
 
-	match(ELSE);
-	return new If(expr, stmt, statement());
+	while (lookahead == ',') {
+	    match(',');
+	    params->push_back(parameter());
+	}
     }
 
-    expr = expression();
-
-    if (lookahead == '=') {
-	match('=');
-	stmt = checkAssignment(expr, expression());
-
-    } else
-	stmt = expr;
-
-    match(';');
-    return stmt;
+    return params;
 }
 
 
 /*
- * Function:	parameter
- *
- * Description:	Parse a parameter, which in Simple C is always a scalar
- *		variable with optional pointer declarators.
+ * Function:	skipBody
  *
- *		parameter:
- *		  specifier pointers identifier
+ * Description:	Skip over the body of a function by matching braces, up
+ *		to its closing brace or the end of the file, whichever is
+ *		first.  The statements are neither parsed nor checked.
  */
 
-static Type parameter()
+static void skipBody()
 {
-    string typespec, name;
-    unsigned indirection;
+    unsigned depth = 1;
 
 
-    typespec = specifier();
-    indirection = pointers();
-    name = expect(ID);
+    match('{');
 
-    Type type = Type(typespec, indirection);
-    return declareParameter(name, type)->type();
+    while (lookahead != DONE) {
+	if (lookahead == '{')
+	    depth ++;
+	else if (lookahead == '}' && -- depth == 0)
+	    break;
+
+	match(lookahead);
+    }
 }
 
 
 /*
- * Function:	parameters
- *
- * Description:	Parse the parameters of a function, but not the opening or
- *		closing parentheses.
+ * Function:	deferBody
  *
- *		parameters:
- *		  void
- *		  parameter-list
- *
- *		parameter-list:
- *		  parameter
- *		  parameter , parameter-list
+ * Description:	Skip over the body of the given function when parsing in
+ *		stages, and remember what is needed to parse it later: its
+ *		range of tokens, the scope of its parameters, its return
+ *		type, and how much of the global state it can see.  The
+ *		tokens in the body are owned by whoever parses it.  A body
+ *		that runs off the end of the file is left to report so, but
+ *		one without an opening brace is a syntax error in the
+ *		declaration, and is never waited for.
  */
 
-static Parameters *parameters()
+static void deferBody(Symbol *symbol)
 {
-    Parameters *params = new Parameters();
+    Unit &unit = stages->units.back();
 
 
-    if (lookahead == VOID)
-	match(VOID);
+    unit.symbol = symbol;
+    unit.scope = closeScope();
+    unit.type = returnType;
+    unit.horizon = stages->history.size();
+    unit.first = position - count;
 
-    else {
-	params->push_back(parameter());
+    owned = 0;
+    skipBody();
+    unit.body = true;
+    unit.last = position - count;
+    owned = UINT_MAX;
 
-	while (lookahead == ',') {
-	    match(',');
-	    params->push_back(parameter());
-	}
+    if (lookahead != DONE) {
+	diagnostics = &unit.after;
+	match('}');
     }
-
-    return params;
 }
 
 
@@ -853,7 +1059,9 @@ static Parameters *parameters()
  *
  * Description:	Parse a top level declaration, which is either a structure
  *		type definition, function definition, or global variable
- *		declaration.
+ *		declaration.  Everything local to a function definition is
+ *		allocated in an arena of its own, which is reset once the
+ *		function has been generated.
  *
  *		type-definition:
  *		  struct identifier { declaration declarations } ;
@@ -876,7 +1084,7 @@ static Parameters *parameters()
 
 static void topLevelDeclaration()
 {
-    string typespec, name;
+    Name typespec, name;
     unsigned indirection;
     Function *function;
     Statements stmts;
@@ -886,7 +1094,7 @@ static void topLevelDeclaration()
 
     typespec = specifier();
 
-    if (typespec != "int" && typespec != "char" && lookahead == '{') {
+    if (typespec != integer && typespec != character && lookahead == '{') {
 	match('{');
 	openScope();
 	declaration();
@@ -897,7 +1105,7 @@ static void topLevelDeclaration()
 
     } else {
 	indirection = pointers();
-	name = expect(ID);
+	name = identifier();
 
 	if (lookahead == '[') {
 	    match('[');
@@ -913,10 +1121,35 @@ static void topLevelDeclaration()
 		declareFunction(name, Type(typespec, indirection, nullptr));
 
 	    } else {
+		if (stages != nullptr)
+		    arena = stages->units.back().arena = new Arena();
+		else
+		    arena = &scratch;
+
 		openScope();
 		returnType = Type(typespec, indirection);
 		symbol = defineFunction(name, Type(typespec, indirection, parameters()));
 		match(')');
+
+		if (stages != nullptr) {
+		    deferBody(symbol);
+		    arena = &permanent;
+		    return;
+		}
+
+		if (skimming) {
+		    skipBody();
+
+		    if (lookahead == DONE)
+			error();
+
+		    match('}');
+		    closeScope();
+		    arena = &permanent;
+		    scratch.reset();
+		    return;
+		}
+
 		match('{');
 		declarations();
 		stmts = statements();
@@ -924,9 +1157,11 @@ static void topLevelDeclaration()
 		function = new Function(symbol, new Block(decls, stmts));
 		match('}');
 
-		if (numerrors == 0)
+		if (numerrors == 0 && !watching)
 		    function->generate();
 
+		arena = &permanent;
+		scratch.reset();
 		return;
 	    }
 
@@ -938,7 +1173,7 @@ static void topLevelDeclaration()
 	while (lookahead == ',') {
 	    match(',');
 	    indirection = pointers();
-	    name = expect(ID);
+	    name = identifier();
 
 	    if (lookahead == '[') {
 		match('[');
@@ -962,23 +1197,618 @@ static void topLevelDeclaration()
 }
 
 
+/*
+ * Function:	checkDeclaration
+ *
+ * Description:	Parse and check the top-level declaration that starts with
+ *		the token with the given index in the watched file.  Since
+ *		the parser does not do error recovery, a declaration with a
+ *		syntax error extends to the end of the file.
+ */
+
+static void checkDeclaration(Declaration &decl, unsigned index)
+{
+    int line;
+
+
+    decl.first = index;
+    decl.broken = false;
+    journal(&decl.changes);
+    diagnostics = &decl.diagnostics;
+
+    seekWatch(index);
+    first = 0;
+    lookahead = fetch(tokens[first]);
+    count = 1;
+
+    try {
+	topLevelDeclaration();
+	decl.last = tellWatch() - count;
+
+    } catch (SyntaxError) {
+	resetScopes();
+	arena = &permanent;
+	scratch.reset();
+	decl.last = watchCount();
+	decl.broken = true;
+    }
+
+    journal(nullptr);
+    diagnostics = nullptr;
+    line = watchLine(decl.first);
+
+    for (unsigned i = 0; i < decl.diagnostics.size(); i ++)
+	decl.diagnostics[i].line -= line;
+}
+
+
+/*
+ * Function:	recheck
+ *
+ * Description:	Check the declarations that overlap the damage to the
+ *		watched file.  The effects of every declaration from the
+ *		first damaged one on are undone.  We then check the
+ *		declarations in turn until we reach the start of an old
+ *		declaration after the damage, and those checked so far have
+ *		changed the global state just as the ones they replaced.
+ *		From there on, every declaration would be checked exactly
+ *		as before, so the old ones are kept and their effects are
+ *		redone.  Return the number of declarations checked.
+ */
+
+static unsigned recheck(const Damage &damage)
+{
+    unsigned k, i, index, checked;
+    vector<Declaration> old;
+    Changes before, after;
+    long shift;
+
+
+    shift = (long) damage.added - (long) damage.removed;
+
+    for (k = 0; k < watched.size(); k ++)
+	if (watched[k].last > damage.first)
+	    break;
+
+    for (i = watched.size(); i > k; i --)
+	undoChanges(watched[i - 1].changes);
+
+    old.assign(make_move_iterator(watched.begin() + k),
+	       make_move_iterator(watched.end()));
+    watched.resize(k);
+
+    index = k > 0 ? watched[k - 1].last : 0;
+    checked = 0;
+    i = 0;
+
+    while (index < watchCount()) {
+	if (index >= damage.first + damage.added) {
+	    while (i < old.size() &&
+		    (old[i].first < damage.first + damage.removed ||
+		     old[i].first + shift < index))
+		i ++;
+
+	    if (i < old.size() && old[i].first + shift == index) {
+		before.clear();
+		after.clear();
+
+		for (unsigned j = 0; j < i; j ++)
+		    before.insert(before.end(), old[j].changes.begin(),
+				  old[j].changes.end());
+
+		for (unsigned j = k; j < watched.size(); j ++)
+		    after.insert(after.end(), watched[j].changes.begin(),
+				 watched[j].changes.end());
+
+		if (sameChanges(before, after))
+		    break;
+	    }
+	}
+
+	watched.push_back(Declaration());
+	checkDeclaration(watched.back(), index);
+	index = watched.back().last;
+	checked ++;
+    }
+
+    if (index < watchCount())
+	for (; i < old.size(); i ++) {
+	    old[i].first += shift;
+	    old[i].last += shift;
+	    redoChanges(old[i].changes);
+	    watched.push_back(move(old[i]));
+	}
+
+    return checked;
+}
+
+
+/*
+ * Function:	summarize
+ *
+ * Description:	Report every error in the watched file, and then how much
+ *		was done to bring it up to date and how long it took.  The
+ *		lexical errors are merged with the others by line number.
+ */
+
+static void summarize(unsigned relexed, unsigned checked, double secs)
+{
+    vector<Diagnostic> lexical, errors;
+    Diagnostic diagnostic;
+    unsigned i, j;
+    int line;
+
+
+    watchErrors(lexical);
+
+    for (i = 0; i < watched.size(); i ++) {
+	line = watchLine(watched[i].first);
+
+	for (j = 0; j < watched[i].diagnostics.size(); j ++) {
+	    diagnostic = watched[i].diagnostics[j];
+	    diagnostic.line += line;
+	    errors.push_back(diagnostic);
+	}
+    }
+
+    for (i = j = 0; i < lexical.size() || j < errors.size(); ) {
+	if (j == errors.size() ||
+		(i < lexical.size() && lexical[i].line <= errors[j].line))
+	    diagnostic = lexical[i ++];
+	else
+	    diagnostic = errors[j ++];
+
+	cerr << "line " << diagnostic.line << ": " << diagnostic.message << endl;
+    }
+
+    cout << relexed << " tokens lexed, " << checked << " of ";
+    cout << watched.size() << " declarations checked, ";
+    cout << i + j << " errors, " << secs * 1e3 << " ms" << endl;
+}
+
+
+/*
+ * Function:	watch
+ *
+ * Description:	Check the given source file, and then check it again
+ *		whenever it changes, doing as little work as possible.
+ *		Code is not generated in watch mode.
+ */
+
+static void watch(char *path)
+{
+    chrono::steady_clock::time_point start;
+    chrono::duration<double> secs;
+    Damage damage;
+    unsigned checked;
+
+
+    start = chrono::steady_clock::now();
+
+    if (!openWatch(path)) {
+	cerr << path << ": cannot read file" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    openScope();
+    damage.first = damage.removed = 0;
+    damage.added = watchCount();
+
+    while (true) {
+	checked = recheck(damage);
+	secs = chrono::steady_clock::now() - start;
+	summarize(damage.added, checked, secs.count());
+
+	do {
+	    waitWatch();
+	    start = chrono::steady_clock::now();
+	} while (!updateWatch(damage));
+    }
+}
+
+
+/*
+ * Function:	parseBody
+ *
+ * Description:	Parse and check the body of the function in the given unit
+ *		against the global state as it was when the body was
+ *		skipped, in the arena of the unit.  This is done on a
+ *		worker thread.
+ */
+
+static void parseBody(Unit &unit)
+{
+    Statements stmts;
+    Scope *decls;
+
+
+    diagnostics = &unit.during;
+    snapshot(&stages->history, unit.horizon, &unit.missing);
+    returnType = unit.type;
+
+    tokens[0] = stages->stream[unit.first].token;
+    lineno = stages->stream[unit.first].line;
+    position = unit.first + 1;
+    owned = unit.last + 1;
+    lookahead = '{';
+    first = 0;
+    count = 1;
+
+    arena = unit.arena;
+
+    try {
+	reopenScope(unit.scope);
+	match('{');
+	declarations();
+	stmts = statements();
+	decls = closeScope();
+	unit.function = new Function(unit.symbol, new Block(decls, stmts));
+	match('}');
+
+    } catch (SyntaxError) {
+	unit.broken = true;
+
+    } catch (Unsizable &failure) {
+	unit.broken = unit.failed = true;
+	unit.unsizable = failure.type;
+    }
+
+    lock_guard<mutex> guard(stages->lock);
+    unit.done = true;
+    stages->ready.notify_all();
+}
+
+
+/*
+ * Function:	parseBodies
+ *
+ * Description:	Claim and parse function bodies until none are left, or
+ *		until told to stop, waiting for bodies to be written if too
+ *		many have been claimed.
+ */
+
+static void parseBodies()
+{
+    unsigned index;
+
+
+    while (true) {
+	{
+	    unique_lock<mutex> guard(stages->lock);
+
+	    while (!stages->stopping && stages->claimed < stages->bodies.size()
+		    && stages->claimed >= stages->retired + stages->window)
+		stages->ready.wait(guard);
+
+	    if (stages->stopping || stages->claimed == stages->bodies.size())
+		return;
+
+	    index = stages->bodies[stages->claimed ++];
+	}
+
+	parseBody(stages->units[index]);
+    }
+}
+
+
+/*
+ * Function:	emit
+ *
+ * Description:	Report the given diagnostics.
+ */
+
+static void emit(const vector<Diagnostic> &errors)
+{
+    for (unsigned i = 0; i < errors.size(); i ++) {
+	cerr << "line " << errors[i].line << ": " << errors[i].message << endl;
+	numerrors ++;
+    }
+}
+
+
+/*
+ * Function:	forget
+ *
+ * Description:	Drop the diagnostics of the given unit for the fields that
+ *		an earlier unit already reported missing.
+ */
+
+static void forget(Unit &unit)
+{
+    static set<pair<Scope *, Name>> reported;
+    unsigned i;
+
+
+    for (i = unit.missing.size(); i > 0; i --) {
+	const MissingField &field = unit.missing[i - 1];
+
+	if (!reported.insert({field.fields, field.symbol->name()}).second)
+	    unit.during.erase(unit.during.begin() + field.diagnostic);
+    }
+}
+
+
+/*
+ * Function:	parseStaged
+ *
+ * Description:	Parse the source in stages, with the function bodies
+ *		parsed on the given number of worker threads.  The
+ *		diagnostics and code are the same as if the source were
+ *		parsed in one pass, and a syntax error or a failed
+ *		assertion still stops everything at the point where it was
+ *		found.
+ */
+
+static void parseStaged(unsigned threads)
+{
+    vector<thread> workers;
+    bool broken = false;
+    Token token;
+    unsigned i;
+
+
+    /* Read the entire token stream.  Room is made for a large stream up
+       front, since copying it each time it grows costs nearly as much as
+       lexing it, and the room that is not used is never touched. */
+
+    stages = new Stages();
+    stages->claimed = 0;
+    stages->retired = 0;
+    stages->window = 4 * threads;
+    stages->stopping = false;
+    stages->stream.reserve(STREAM_SIZE);
+    diagnostics = &stages->lexical;
+
+    do {
+	preprocess(token);
+	stages->stream.push_back({token, lineno, (unsigned) stages->lexical.size()});
+    } while (token.kind != DONE);
+
+
+    /* Parse the top-level declarations, skipping the function bodies. */
+
+    journal(&stages->history);
+    loadHeader(globals);
+    owned = UINT_MAX;
+    position = 0;
+
+    stages->units.push_back(Unit());
+    diagnostics = &stages->units.back().before;
+    lookahead = fetch(tokens[first]);
+    count = 1;
+
+    while (lookahead != DONE) {
+	try {
+	    topLevelDeclaration();
+
+	} catch (SyntaxError) {
+	    stages->units.back().broken = true;
+	    arena = &permanent;
+	    break;
+	}
+
+	if (stages->units.back().body)
+	    stages->bodies.push_back(stages->units.size() - 1);
+
+	stages->units.push_back(Unit());
+	diagnostics = &stages->units.back().before;
+    }
+
+    journal(nullptr);
+    indexChanges(&stages->history);
+    diagnostics = nullptr;
+
+
+    /* Parse the bodies, and write everything out in order. */
+
+    for (i = 0; i < threads; i ++)
+	workers.push_back(thread(parseBodies));
+
+    for (i = 0; i < stages->units.size() && !broken; i ++) {
+	Unit &unit = stages->units[i];
+
+	emit(unit.before);
+
+	if (unit.body) {
+	    unique_lock<mutex> guard(stages->lock);
+
+	    while (!unit.done)
+		stages->ready.wait(guard);
+
+	    guard.unlock();
+	    forget(unit);
+	    emit(unit.during);
+
+	    if (unit.failed)
+		unit.unsizable.size();
+
+	    if (!unit.broken) {
+		emit(unit.after);
+
+		if (numerrors == 0)
+		    unit.function->generate();
+	    }
+	}
+
+	delete unit.arena;
+
+	if (unit.body) {
+	    lock_guard<mutex> guard(stages->lock);
+	    stages->retired ++;
+	    stages->ready.notify_all();
+	}
+
+	broken = unit.broken;
+    }
+
+    stages->lock.lock();
+    stages->stopping = true;
+    stages->ready.notify_all();
+    stages->lock.unlock();
+
+    for (i = 0; i < threads; i ++)
+	workers[i].join();
+
+    if (broken)
+	exit(EXIT_FAILURE);
+}
+
+
 /*
  * Function:	main
  *
- * Description:	Analyze the standard input stream.
+ * Description:	Analyze the source files named on the command line, or
+ *		the standard input stream if none are named.  Once a
+ *		top-level declaration has been generated, nothing refers to
+ *		its text any longer, so the source read so far is released,
+ *		unless the function bodies are being parsed in parallel.
+ *		The sizes of the trees generated can be reported at the
+ *		end on the standard error stream.  The checked unit can be
+ *		saved as a module, and code generated from a module
+ *		instead of from source.  The declarations of a prelude can
+ *		be saved as a precompiled header, and a later unit started
+ *		from the header instead of from the prelude, which is
+ *		compiled first after all if it has changed since.  Each
+ *		directory given with --include-path is searched for
+ *		headers, in order.
+ *
+ *		usage: scc [--token-cache dir] [--lex-threads n]
+ *			   [--parse-threads n] [--skim] [--tree-stats]
+ *			   [--include-path dir] [--save-module file]
+ *			   [--header file | --save-header file] [file ...]
+ *		       scc --load-module file
+ *		       scc --watch file
  */
 
-int main()
+int main(int argc, char *argv[])
 {
+    const char *cache = NULL, *module = NULL, *header = NULL, *save = NULL;
+    unsigned threads = thread::hardware_concurrency(), parsers = 0;
+    vector<string> prelude;
+    vector<char *> args;
+    bool stats = false;
+
+
+    while (argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+	if (strcmp(argv[1], "--watch") == 0 && argc == 3)
+	    watch(argv[2]);
+
+	else if (strcmp(argv[1], "--token-cache") == 0 && argc > 2) {
+	    cache = argv[2];
+	    argc -= 2;
+	    argv += 2;
+	} else if (strcmp(argv[1], "--lex-threads") == 0 && argc > 2) {
+	    threads = atoi(argv[2]);
+	    argc -= 2;
+	    argv += 2;
+	} else if (strcmp(argv[1], "--parse-threads") == 0 && argc > 2) {
+	    parsers = atoi(argv[2]);
+	    argc -= 2;
+	    argv += 2;
+	} else if (strcmp(argv[1], "--include-path") == 0 && argc > 2) {
+	    includeDirectory(argv[2]);
+	    argc -= 2;
+	    argv += 2;
+	} else if (strcmp(argv[1], "--skim") == 0) {
+	    skimming = true;
+	    argc -= 1;
+	    argv += 1;
+	} else if (strcmp(argv[1], "--tree-stats") == 0) {
+	    stats = true;
+	    argc -= 1;
+	    argv += 1;
+	} else if (strcmp(argv[1], "--save-module") == 0 && argc > 2) {
+	    module = argv[2];
+	    argc -= 2;
+	    argv += 2;
+	} else if (strcmp(argv[1], "--header") == 0 && argc > 2 && !save) {
+	    header = argv[2];
+	    argc -= 2;
+	    argv += 2;
+	} else if (strcmp(argv[1], "--save-header") == 0 && argc > 2 &&
+		!header) {
+	    save = argv[2];
+	    argc -= 2;
+	    argv += 2;
+	} else if (strcmp(argv[1], "--load-module") == 0 && argc == 3) {
+	    if (!replayModule(argv[2])) {
+		cerr << "scc: cannot load module " << argv[2] << endl;
+		exit(EXIT_FAILURE);
+	    }
+
+	    exit(EXIT_SUCCESS);
+	} else {
+	    cerr << "usage: scc [--token-cache dir] [--lex-threads n]";
+	    cerr << " [--parse-threads n] [--skim] [--tree-stats]";
+	    cerr << " [--include-path dir] [--save-module file]";
+	    cerr << " [--header file | --save-header file] [file ...]" << endl;
+	    cerr << "       scc --load-module file" << endl;
+	    cerr << "       scc --watch file" << endl;
+	    exit(EXIT_FAILURE);
+	}
+    }
+
+    if (header != NULL && !openHeader(header, prelude)) {
+	cerr << "scc: cannot load header " << header << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (!prelude.empty()) {
+	args.push_back(argv[0]);
+
+	for (unsigned i = 0; i < prelude.size(); i ++)
+	    args.push_back(&prelude[i][0]);
+
+	args.insert(args.end(), argv + 1, argv + argc);
+
+	if (argc == 1)
+	    args.push_back((char *) "-");
+
+	argc = args.size();
+	argv = args.data();
+    }
+
+    if (module != NULL && !skimming && !openModule(module)) {
+	cerr << "scc: cannot save module " << module << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (cache == NULL || !openCache(cache, argc - 1, argv + 1))
+	if (!openParallel(argc - 1, argv + 1, threads))
+	    openSource(argc - 1, argv + 1);
+
+    openPreprocessor(argc - 1, argv + 1);
     openScope();
-    lookahead = lexan(lexbuf);
 
-    while (lookahead != DONE)
-	topLevelDeclaration();
+    if (parsers > 0 && !skimming)
+	parseStaged(parsers);
+
+    else {
+	loadHeader(globals);
+	lookahead = fetch(tokens[first]);
+	count = 1;
 
-    if (numerrors == 0)
+	while (lookahead != DONE) {
+	    topLevelDeclaration();
+	    releaseSource();
+	}
+    }
+
+    if (skimming)
+	writeInterface(cout);
+    else if (numerrors == 0)
 	generateGlobals(globals);
 
+    closeModule(globals);
+
+    if (save != NULL && !saveHeader(save, argc - 1, argv + 1, globals)) {
+	cerr << "scc: cannot save header " << save << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (stats)
+	writeTreeStats(cerr);
+
     closeScope();
     exit(EXIT_SUCCESS);
 }
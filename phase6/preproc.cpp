@@ -0,0 +1,1434 @@
+/*
+ * File:	preproc.cpp
+ *
+ * Description:	This file contains the public and private function and
+ *		variable definitions for the preprocessor for Simple C.
+ *
+ *		The lexical analyzer knows nothing of lines, but every
+ *		token comes with its line number, so a directive is a '#'
+ *		that is the first token on its line, and it runs up to the
+ *		first token on a later line, which is held back until the
+ *		directive is done.  A backslash at the end of a line
+ *		continues the directive.  The lexical analyzer returns a
+ *		'#' or a backslash as an error token, so either is still a
+ *		syntax error anywhere else.
+ *
+ *		Macros are expanded as the tokens go by, and what a macro
+ *		expands to is pushed back in front of the tokens still to
+ *		be read, so that it is read again.  Each token carries the
+ *		set of macros it was produced by, and is never expanded by
+ *		one of them again, so an expansion cannot go on forever.
+ *		The arguments of a function-like macro are expanded before
+ *		they are substituted, except when they are stringized or
+ *		pasted.
+ *
+ *		A header is read whole and tokenized as a buffer of its own,
+ *		as a chunk of a large file is in parlex.cpp, with the state
+ *		of the lexical analyzer in the middle of the file that
+ *		includes the header saved and then restored.  Its tokens
+ *		are kept for as long as the compiler runs, with any lexical
+ *		errors, which are reported whenever the tokens are read
+ *		outside of a skipped group.  A header that consists of a
+ *		single #ifndef group has the macro it tests remembered as
+ *		its guard, and once the guard is defined, including the
+ *		header again is a no-op that reads nothing at all, as it is
+ *		for #pragma once.
+ */
+
+# include <algorithm>
+# include <cctype>
+# include <climits>
+# include <cstdlib>
+# include <cstring>
+# include <string>
+# include <unordered_map>
+# include <vector>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/stat.h>
+# include "preproc.h"
+# include "arena.h"
+# include "cache.h"
+# include "source.h"
+# include "scan.h"
+# include "tokens.h"
+# include "watch.h"
+
+# define MAX_DEPTH 200		/* deepest nesting of included headers */
+
+using namespace std;
+
+enum { PARAM = DONE + 1, STRINGIZE, PASTE };
+
+struct Hidden {
+    Name name;
+    const Hidden *next;
+};
+
+struct Pretoken {
+    Token token;
+    int line;
+    bool spaced;
+    const Hidden *hidden;
+    const char *error;
+};
+
+struct HeaderFile {
+    string directory;
+    vector<Pretoken> tokens;
+    Name guard;
+    bool once, included;
+};
+
+struct Input {
+    HeaderFile *file;
+    unsigned next, conditionals;
+    int line;
+    bool holding;
+    Pretoken held;
+};
+
+struct Conditional {
+    bool taking, taken, elsed;
+};
+
+struct Macro {
+    bool function;
+    unsigned params;
+    vector<Pretoken> body;
+};
+
+static const char *const operators[] = {
+    "||", "&&", "==", "!=", "<=", ">=", "->", "++", "--",
+};
+
+static const int kinds[] = {
+    OR, AND, EQL, NEQ, LEQ, GEQ, ARROW, INC, DEC,
+};
+
+static vector<string> directories, sources;
+static unordered_map<string, HeaderFile *> files;
+static unordered_map<Name, Macro *> macros;
+static vector<Input> inputs(1);
+static vector<Conditional> conditionals;
+static vector<Pretoken> pending;
+static vector<Diagnostic> ignored;
+static int position = 1;
+static Name defined = intern("defined");
+
+static const vector<Pretoken> *expr;
+static unsigned at;
+static bool invalid;
+
+static bool expand(Pretoken &pt, vector<Pretoken> &stack);
+static bool take(Pretoken &pt, vector<Pretoken> &stack);
+static long expression();
+
+
+/*
+ * Function:	spelled
+ *
+ * Description:	Return whether the given token is spelled as given.
+ */
+
+static bool spelled(const Token &token, const char *s)
+{
+    return token.lexeme.length == strlen(s) &&
+	memcmp(token.lexeme.text, s, token.lexeme.length) == 0;
+}
+
+
+/*
+ * Function:	spelling
+ *
+ * Description:	Return the spelling of the given token.
+ */
+
+static inline string spelling(const Token &token)
+{
+    return string(token.lexeme.text, token.lexeme.length);
+}
+
+
+/*
+ * Function:	stable
+ *
+ * Description:	Make the lexeme of the given token refer to interned text
+ *		rather than to the source buffer, which may be released
+ *		before the token is read.
+ */
+
+static void stable(Token &token)
+{
+    Name text;
+
+
+    text = token.kind == ID ? token.name : intern(spelling(token));
+    token.lexeme.text = text->data();
+}
+
+
+/*
+ * Function:	hides
+ *
+ * Description:	Return whether the given macro is in the given set.
+ */
+
+static bool hides(const Hidden *hidden, Name name)
+{
+    for (; hidden != nullptr; hidden = hidden->next)
+	if (hidden->name == name)
+	    return true;
+
+    return false;
+}
+
+
+/*
+ * Function:	hide
+ *
+ * Description:	Return the union of the two given sets, sharing the second.
+ */
+
+static const Hidden *hide(const Hidden *hidden, const Hidden *base)
+{
+    for (; hidden != nullptr; hidden = hidden->next)
+	if (!hides(base, hidden->name))
+	    base = new (permanent) Hidden {hidden->name, base};
+
+    return base;
+}
+
+
+/*
+ * Function:	directoryOf
+ *
+ * Description:	Return the directory part of the given path.
+ */
+
+static string directoryOf(const string &path)
+{
+    size_t slash = path.rfind('/');
+
+
+    if (slash == string::npos)
+	return ".";
+
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+
+/*
+ * Function:	includeDirectory
+ *
+ * Description:	Add the given directory to those searched for headers.
+ */
+
+void includeDirectory(const char *dir)
+{
+    directories.push_back(dir);
+}
+
+
+/*
+ * Function:	openPreprocessor
+ *
+ * Description:	Prepare to preprocess the given source files, whose
+ *		directories are searched for quoted headers.
+ */
+
+void openPreprocessor(int count, char *paths[])
+{
+    string dir;
+
+
+    for (int i = 0; i < count; i ++) {
+	dir = strcmp(paths[i], "-") == 0 ? "." : directoryOf(paths[i]);
+
+	if (find(sources.begin(), sources.end(), dir) == sources.end())
+	    sources.push_back(dir);
+    }
+
+    if (sources.empty())
+	sources.push_back(".");
+}
+
+
+/*
+ * Function:	skipping
+ *
+ * Description:	Return whether the tokens being read are in a group that
+ *		is skipped.
+ */
+
+static inline bool skipping()
+{
+    return !conditionals.empty() && !conditionals.back().taking;
+}
+
+
+/*
+ * Function:	read
+ *
+ * Description:	Read the next token of the current input, and return
+ *		whether it is the first token on its line.  A header just
+ *		keeps returning the end of its tokens.  The line number is
+ *		set for diagnostics in headers and directives, so that of
+ *		the source files is kept aside for the lexical analyzer.
+ *		Like those in headers, lexical errors in a skipped group
+ *		are not reported.
+ */
+
+static bool read(Pretoken &pt)
+{
+    vector<Diagnostic> *saved;
+    Input &input = inputs.back();
+    bool first, skip;
+
+
+    if (input.holding) {
+	input.holding = false;
+	pt = input.held;
+	return true;
+    }
+
+    if (input.file == nullptr) {
+	skip = skipping();
+	saved = diagnostics;
+	diagnostics = skip ? &ignored : saved;
+	lineno = position;
+	nextToken(pt.token);
+	pt.line = position = lineno;
+	pt.spaced = spaced();
+	pt.hidden = nullptr;
+	pt.error = nullptr;
+	diagnostics = saved;
+	ignored.clear();
+
+    } else if (input.next < input.file->tokens.size()) {
+	pt = input.file->tokens[input.next ++];
+
+	if (pt.error != nullptr && !skipping()) {
+	    lineno = pt.line;
+	    report(pt.error);
+	}
+
+    } else {
+	pt.token.kind = DONE;
+	pt.token.lexeme.text = "";
+	pt.token.lexeme.length = 0;
+	pt.line = input.line;
+	pt.spaced = true;
+	pt.hidden = nullptr;
+	pt.error = nullptr;
+    }
+
+    first = pt.line != input.line;
+    input.line = pt.line;
+    return first;
+}
+
+
+/*
+ * Function:	readLine
+ *
+ * Description:	Read the rest of a directive into the given vector.  The
+ *		first token after it is held back to be read again.
+ */
+
+static void readLine(vector<Pretoken> &line)
+{
+    Pretoken pt;
+
+
+    line.clear();
+
+    while (true) {
+	if (read(pt) || pt.token.kind == DONE) {
+	    if (pt.token.kind == DONE || line.empty() ||
+		    !spelled(line.back().token, "\\")) {
+		inputs.back().held = pt;
+		inputs.back().holding = true;
+		return;
+	    }
+
+	    line.pop_back();
+	}
+
+	line.push_back(pt);
+    }
+}
+
+
+/*
+ * Function:	tokenize
+ *
+ * Description:	Tokenize the text of the given header, which must be
+ *		followed by a null character and the usual padding, and
+ *		then go back to where the lexical analyzer was.  Nothing is
+ *		interned, as on a thread of parlex.cpp, and errors are kept
+ *		with the tokens rather than reported.
+ */
+
+static void tokenize(HeaderFile *file, const char *start, const char *end)
+{
+    const char *message, *previous;
+    SourceState source;
+    LexerState lexer;
+    Pretoken pt;
+
+
+    saveSource(source);
+    saveLexer(lexer);
+    openBuffer(start, end);
+    restartLexer();
+    lineno = 1;
+    previous = nullptr;
+    pt.hidden = nullptr;
+
+    while (lexanDeferred(pt.token, message) != DONE) {
+	pt.line = lineno;
+	pt.spaced = pt.token.lexeme.text != previous;
+	pt.error = message;
+	previous = pt.token.lexeme.text + pt.token.lexeme.length;
+	file->tokens.push_back(pt);
+    }
+
+    restoreLexer(lexer);
+    restoreSource(source);
+}
+
+
+/*
+ * Function:	guardOf
+ *
+ * Description:	Return the macro that guards the given header, if it
+ *		consists of a single #ifndef group, and a null pointer
+ *		otherwise.
+ */
+
+static Name guardOf(const HeaderFile *file)
+{
+    const vector<Pretoken> &t = file->tokens;
+    unsigned i, depth = 0;
+    string word;
+
+
+    if (t.size() < 3 || !spelled(t[0].token, "#") ||
+	    !spelled(t[1].token, "ifndef") || t[2].token.kind != ID ||
+	    t[1].line != t[0].line || t[2].line != t[0].line ||
+	    (t.size() > 3 && t[3].line == t[0].line))
+	return nullptr;
+
+    for (i = 0; i + 1 < t.size(); i ++) {
+	if ((i > 0 && t[i].line == t[i - 1].line) ||
+		!spelled(t[i].token, "#") || t[i + 1].line != t[i].line)
+	    continue;
+
+	word = spelling(t[i + 1].token);
+
+	if (word == "if" || word == "ifdef" || word == "ifndef")
+	    depth ++;
+	else if ((word == "elif" || word == "else") && depth == 1)
+	    return nullptr;
+	else if (word == "endif" && -- depth == 0)
+	    return t.back().line == t[i].line ? t[2].token.name : nullptr;
+    }
+
+    return nullptr;
+}
+
+
+/*
+ * Function:	load
+ *
+ * Description:	Return the header with the given path, reading and
+ *		tokenizing it if this is the first time it is included
+ *		under any name, or a null pointer if it cannot be read.
+ */
+
+static HeaderFile *load(const string &path)
+{
+    unordered_map<string, HeaderFile *>::iterator it;
+    char resolved[PATH_MAX];
+    HeaderFile *file;
+    struct stat st;
+    size_t length;
+    char *text;
+    ssize_t n;
+    int fd;
+
+
+    if (realpath(path.c_str(), resolved) == NULL)
+	return nullptr;
+
+    if ((it = files.find(resolved)) != files.end())
+	return it->second;
+
+    if ((fd = open(resolved, O_RDONLY)) < 0)
+	return nullptr;
+
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+	close(fd);
+	return nullptr;
+    }
+
+    text = new char[st.st_size + 1 + SCAN_PADDING];
+    memset(text + st.st_size, 0, 1 + SCAN_PADDING);
+
+    for (length = 0; length < (size_t) st.st_size; length += n)
+	if ((n = read(fd, text + length, st.st_size - length)) <= 0)
+	    break;
+
+    close(fd);
+
+    if (length < (size_t) st.st_size) {
+	delete[] text;
+	return nullptr;
+    }
+
+    file = new HeaderFile();
+    file->directory = directoryOf(path);
+    file->guard = nullptr;
+    file->once = file->included = false;
+    tokenize(file, text, text + length);
+
+    for (Pretoken &pt : file->tokens)
+	if (pt.token.kind == ID)
+	    pt.token.name = intern(pt.token.lexeme.text, pt.token.lexeme.length);
+	else if (pt.token.kind == STRING)
+	    pt.token.name = strval(pt.token.lexeme);
+
+    file->guard = guardOf(file);
+    files[resolved] = file;
+    return file;
+}
+
+
+/*
+ * Function:	locate
+ *
+ * Description:	Search for the header with the given name, starting in
+ *		the directory of the file including it if it is quoted.
+ */
+
+static HeaderFile *locate(const string &name, bool quoted)
+{
+    vector<string> dirs;
+    HeaderFile *file;
+
+
+    if (name.empty())
+	return nullptr;
+
+    if (name[0] == '/')
+	return load(name);
+
+    if (quoted && inputs.back().file != nullptr)
+	dirs.push_back(inputs.back().file->directory);
+    else if (quoted)
+	dirs = sources;
+
+    dirs.insert(dirs.end(), directories.begin(), directories.end());
+
+    for (unsigned i = 0; i < dirs.size(); i ++)
+	if ((file = load(dirs[i] + "/" + name)) != nullptr)
+	    return file;
+
+    return nullptr;
+}
+
+
+/*
+ * Function:	expandList
+ *
+ * Description:	Expand the macros in the given tokens, by themselves.
+ */
+
+static void expandList(vector<Pretoken> &tokens)
+{
+    vector<Pretoken> stack(tokens.rbegin(), tokens.rend());
+    Pretoken pt;
+
+
+    tokens.clear();
+
+    while (take(pt, stack))
+	if (pt.token.kind != ID || !expand(pt, stack))
+	    tokens.push_back(pt);
+}
+
+
+/*
+ * Function:	include
+ *
+ * Description:	Start reading the header named in the given directive,
+ *		unless it is guarded and has been read already.
+ */
+
+static void include(vector<Pretoken> &line)
+{
+    vector<Pretoken> rest;
+    HeaderFile *file;
+    Input input;
+    string name;
+    bool quoted;
+
+
+    if (line.size() > 1 && line[1].token.kind == ID) {
+	rest.assign(line.begin() + 1, line.end());
+	expandList(rest);
+	line.resize(1);
+	line.insert(line.end(), rest.begin(), rest.end());
+    }
+
+    if (line.size() == 2 && line[1].token.kind == STRING &&
+	    line[1].token.lexeme.length >= 2) {
+	quoted = true;
+	name = spelling(line[1].token);
+	name = name.substr(1, name.size() - 2);
+
+    } else if (line.size() > 2 && line[1].token.kind == '<' &&
+	    line.back().token.kind == '>') {
+	quoted = false;
+
+	for (unsigned i = 2; i + 1 < line.size(); i ++)
+	    name += spelling(line[i].token);
+
+    } else {
+	report("#include expects \"file\" or <file>");
+	return;
+    }
+
+    if (inputs.size() > MAX_DEPTH) {
+	report("#include nested too deeply");
+	return;
+    }
+
+    if ((file = locate(name, quoted)) == nullptr) {
+	report("cannot find header '%s'", name);
+	return;
+    }
+
+    if ((file->once && file->included) ||
+	    (file->guard != nullptr && macros.count(file->guard) > 0))
+	return;
+
+    file->included = true;
+    input = Input();
+    input.file = file;
+    input.conditionals = conditionals.size();
+    inputs.push_back(input);
+}
+
+
+/*
+ * Function:	define
+ *
+ * Description:	Define the macro in the given directive, replacing any
+ *		previous definition.  A macro is function-like if its name
+ *		is followed immediately by a parenthesis.  In its body,
+ *		each parameter is replaced by a placeholder with its index,
+ *		and '#' and '##' by the operators they stand for.
+ */
+
+static void define(const vector<Pretoken> &line)
+{
+    vector<Name> params;
+    Macro *macro;
+    Pretoken pt;
+    unsigned i, j;
+    Name name;
+
+
+    if (line.size() < 2 || line[1].token.kind != ID) {
+	report("#define expects a macro name");
+	return;
+    }
+
+    name = line[1].token.name;
+    macro = new Macro();
+    macro->function = line.size() > 2 && line[2].token.kind == '(' &&
+	!line[2].spaced;
+    i = 2;
+
+    if (macro->function) {
+	for (i = 3; i < line.size() && line[i].token.kind == ID; i ++) {
+	    params.push_back(line[i].token.name);
+
+	    if (i + 1 < line.size() && line[i + 1].token.kind == ',')
+		i ++;
+	    else
+		break;
+	}
+
+	if (i < line.size() && line[i].token.kind == ID)
+	    i ++;
+
+	if (i >= line.size() || line[i].token.kind != ')' ||
+		(!params.empty() && line[i - 1].token.kind != ID)) {
+	    report("invalid parameters for macro '%s'", *name);
+	    delete macro;
+	    return;
+	}
+
+	macro->params = params.size();
+	i ++;
+    }
+
+    for (; i < line.size(); i ++) {
+	pt = line[i];
+	pt.hidden = nullptr;
+	pt.error = nullptr;
+
+	if (pt.token.kind == ID)
+	    for (j = 0; j < params.size(); j ++)
+		if (pt.token.name == params[j]) {
+		    pt.token.kind = PARAM;
+		    pt.token.value = j;
+		}
+
+	if (pt.token.kind == ERROR && spelled(pt.token, "#")) {
+	    if (i + 1 < line.size() && spelled(line[i + 1].token, "#") &&
+		    !line[i + 1].spaced) {
+		pt.token.kind = PASTE;
+		i ++;
+
+	    } else if (macro->function) {
+		for (j = 0; i + 1 < line.size() && j < params.size(); j ++)
+		    if (line[i + 1].token.kind == ID &&
+			    line[i + 1].token.name == params[j])
+			break;
+
+		if (j == params.size() || i + 1 == line.size()) {
+		    report("'#' is not followed by a parameter of '%s'", *name);
+		    delete macro;
+		    return;
+		}
+
+		pt.token.kind = STRINGIZE;
+		pt.token.value = j;
+		i ++;
+	    }
+	}
+
+	stable(pt.token);
+	macro->body.push_back(pt);
+    }
+
+    if (!macro->body.empty() && (macro->body[0].token.kind == PASTE ||
+	    macro->body.back().token.kind == PASTE)) {
+	report("'##' cannot be at either end of macro '%s'", *name);
+	delete macro;
+	return;
+    }
+
+    delete macros[name];
+    macros[name] = macro;
+}
+
+
+/*
+ * Function:	undefine
+ *
+ * Description:	Remove the definition of the macro in the given
+ *		directive, if any.
+ */
+
+static void undefine(const vector<Pretoken> &line)
+{
+    if (line.size() != 2 || line[1].token.kind != ID) {
+	report("#undef expects a macro name");
+	return;
+    }
+
+    delete macros[line[1].token.name];
+    macros.erase(line[1].token.name);
+}
+
+
+/*
+ * Function:	primary
+ *
+ * Description:	Evaluate a primary expression in a conditional directive.
+ *		Any identifier left after expansion is zero.
+ */
+
+static long primary()
+{
+    const Token *token;
+    long value;
+
+
+    if (at == expr->size()) {
+	invalid = true;
+	return 0;
+    }
+
+    token = &(*expr)[at ++].token;
+
+    if (token->kind == NUM || token->kind == CHARACTER)
+	return token->value;
+
+    if (token->kind == '(') {
+	value = expression();
+
+	if (at == expr->size() || (*expr)[at ++].token.kind != ')')
+	    invalid = true;
+
+	return value;
+    }
+
+    if (token->kind == '!')
+	return !primary();
+
+    if (token->kind == '-')
+	return -primary();
+
+    if (token->kind == '+')
+	return primary();
+
+    if (token->kind == ID || (token->kind >= AUTO && token->kind <= WHILE))
+	return 0;
+
+    invalid = true;
+    return 0;
+}
+
+
+/*
+ * Function:	precedence
+ *
+ * Description:	Return the precedence of the given binary operator, or
+ *		zero if it is not one.
+ */
+
+static int precedence(int kind)
+{
+    switch (kind) {
+    case OR:
+	return 1;
+    case AND:
+	return 2;
+    case EQL: case NEQ:
+	return 3;
+    case '<': case '>': case LEQ: case GEQ:
+	return 4;
+    case '+': case '-':
+	return 5;
+    case '*': case '/': case '%':
+	return 6;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Function:	binary
+ *
+ * Description:	Evaluate a binary expression in a conditional directive
+ *		whose operators have at least the given precedence.
+ */
+
+static long binary(int minimum)
+{
+    long left, right;
+    int kind, level;
+
+
+    left = primary();
+
+    while (at < expr->size()) {
+	kind = (*expr)[at].token.kind;
+	level = precedence(kind);
+
+	if (level < minimum || level == 0)
+	    break;
+
+	at ++;
+	right = binary(level + 1);
+
+	if ((kind == '/' || kind == '%') && right == 0) {
+	    invalid = true;
+	    right = 1;
+	}
+
+	switch (kind) {
+	case OR:  left = left || right; break;
+	case AND: left = left && right; break;
+	case EQL: left = left == right; break;
+	case NEQ: left = left != right; break;
+	case '<': left = left < right; break;
+	case '>': left = left > right; break;
+	case LEQ: left = left <= right; break;
+	case GEQ: left = left >= right; break;
+	case '+': left = left + right; break;
+	case '-': left = left - right; break;
+	case '*': left = left * right; break;
+	case '/': left = left / right; break;
+	case '%': left = left % right; break;
+	}
+    }
+
+    return left;
+}
+
+
+/*
+ * Function:	expression
+ *
+ * Description:	Evaluate a conditional expression in a conditional
+ *		directive.
+ */
+
+static long expression()
+{
+    long test, left, right;
+
+
+    test = binary(1);
+
+    if (at == expr->size() || !spelled((*expr)[at].token, "?"))
+	return test;
+
+    at ++;
+    left = expression();
+
+    if (at == expr->size() || (*expr)[at ++].token.kind != ':')
+	invalid = true;
+
+    right = expression();
+    return test ? left : right;
+}
+
+
+/*
+ * Function:	evaluate
+ *
+ * Description:	Evaluate the expression in the given #if or #elif
+ *		directive, after replacing each use of defined and then
+ *		expanding the macros in it.
+ */
+
+static long evaluate(const vector<Pretoken> &line)
+{
+    vector<Pretoken> tokens;
+    unsigned i, j;
+    Pretoken pt;
+    bool paren;
+    long value;
+
+
+    for (i = 1; i < line.size(); i ++) {
+	pt = line[i];
+
+	if (pt.token.kind == ID && pt.token.name == defined) {
+	    paren = i + 1 < line.size() && line[i + 1].token.kind == '(';
+	    j = paren ? i + 2 : i + 1;
+
+	    if (j >= line.size() || line[j].token.kind != ID || (paren &&
+		    (j + 1 >= line.size() || line[j + 1].token.kind != ')'))) {
+		report("invalid use of 'defined'");
+		return 0;
+	    }
+
+	    pt.token.kind = NUM;
+	    pt.token.value = macros.count(line[j].token.name);
+	    i = paren ? j + 1 : j;
+	}
+
+	tokens.push_back(pt);
+    }
+
+    expandList(tokens);
+    expr = &tokens;
+    at = 0;
+    invalid = false;
+    value = expression();
+
+    if (invalid || at != tokens.size()) {
+	report("invalid expression in conditional directive");
+	return 0;
+    }
+
+    return value;
+}
+
+
+/*
+ * Function:	test
+ *
+ * Description:	Return whether the group of the given conditional
+ *		directive is taken.
+ */
+
+static bool test(const string &name, const vector<Pretoken> &line)
+{
+    if (name == "if" || name == "elif")
+	return evaluate(line) != 0;
+
+    if (line.size() != 2 || line[1].token.kind != ID) {
+	report("#%s expects a macro name", name);
+	return false;
+    }
+
+    return (macros.count(line[1].token.name) > 0) == (name == "ifdef");
+}
+
+
+/*
+ * Function:	directive
+ *
+ * Description:	Read and carry out the directive started by the given
+ *		'#'.  In a skipped group, only the conditional directives
+ *		matter, and they are only checked for nesting.
+ */
+
+static void directive(const Pretoken &hash)
+{
+    vector<Pretoken> line;
+    Conditional c;
+    string name;
+
+
+    readLine(line);
+    lineno = hash.line;
+
+    if (line.empty())
+	return;
+
+    name = spelling(line[0].token);
+
+    if (name == "if" || name == "ifdef" || name == "ifndef") {
+	c.taken = skipping();
+	c.taking = !c.taken && test(name, line);
+	c.taken = c.taken || c.taking;
+	c.elsed = false;
+	conditionals.push_back(c);
+
+    } else if (name == "elif" || name == "else" || name == "endif") {
+	if (conditionals.size() <= inputs.back().conditionals) {
+	    report("#%s without #if", name);
+	    return;
+	}
+
+	if (name == "endif") {
+	    conditionals.pop_back();
+	    return;
+	}
+
+	Conditional &last = conditionals.back();
+
+	if (last.elsed) {
+	    report("#%s after #else", name);
+	    return;
+	}
+
+	last.taking = !last.taken && (name == "else" || test(name, line));
+	last.taken = last.taken || last.taking;
+	last.elsed = name == "else";
+
+    } else if (skipping() || line[0].token.kind == NUM)
+	return;
+
+    else if (name == "define")
+	define(line);
+    else if (name == "undef")
+	undefine(line);
+    else if (name == "include")
+	include(line);
+
+    else if (name == "pragma") {
+	if (line.size() == 2 && spelled(line[1].token, "once"))
+	    if (inputs.back().file != nullptr)
+		inputs.back().file->once = true;
+
+    } else if (name == "error") {
+	for (unsigned i = 1; i < line.size(); i ++)
+	    name += " " + spelling(line[i].token);
+
+	report("#%s", name);
+
+    } else
+	report("invalid directive '#%s'", name);
+}
+
+
+/*
+ * Function:	leave
+ *
+ * Description:	Finish the current input, which has ended, and return
+ *		whether there is more input after it.
+ */
+
+static bool leave()
+{
+    Input &input = inputs.back();
+
+
+    if (conditionals.size() > input.conditionals) {
+	lineno = input.line;
+	report("unterminated conditional directive");
+	conditionals.resize(input.conditionals);
+    }
+
+    if (input.file == nullptr)
+	return false;
+
+    inputs.pop_back();
+    return true;
+}
+
+
+/*
+ * Function:	scanned
+ *
+ * Description:	Return the next token of the input that is not part of a
+ *		directive or a skipped group, moving on from a header once
+ *		it ends.
+ */
+
+static void scanned(Pretoken &pt)
+{
+    bool first;
+
+
+    while (true) {
+	first = read(pt);
+
+	if (pt.token.kind == DONE) {
+	    if (leave())
+		continue;
+
+	    return;
+	}
+
+	if (first && pt.token.kind == ERROR && spelled(pt.token, "#"))
+	    directive(pt);
+	else if (!skipping())
+	    return;
+    }
+}
+
+
+/*
+ * Function:	take
+ *
+ * Description:	Take the next token from the given stack of tokens.  The
+ *		stack of pending tokens is followed by the rest of the
+ *		input, but any other stack just ends.
+ */
+
+static bool take(Pretoken &pt, vector<Pretoken> &stack)
+{
+    if (!stack.empty()) {
+	pt = stack.back();
+	stack.pop_back();
+	return true;
+    }
+
+    if (&stack != &pending)
+	return false;
+
+    scanned(pt);
+    return true;
+}
+
+
+/*
+ * Function:	arguments
+ *
+ * Description:	Read the arguments of the given function-like macro,
+ *		whose opening parenthesis has been read, from the given
+ *		stack, and return whether there are as many as it takes.
+ */
+
+static bool arguments(const Macro *macro, const Pretoken &pt,
+	vector<Pretoken> &stack, vector<vector<Pretoken> > &args)
+{
+    unsigned depth = 0;
+    Pretoken next;
+
+
+    args.assign(1, vector<Pretoken>());
+
+    while (take(next, stack) && next.token.kind != DONE) {
+	if (next.token.kind == ')' && depth == 0) {
+	    if (macro->params == 0 && args.size() == 1 && args[0].empty())
+		args.clear();
+
+	    if (args.size() == macro->params)
+		return true;
+
+	    lineno = pt.line;
+	    report("wrong number of arguments to macro '%s'", *pt.token.name);
+	    return false;
+	}
+
+	if (next.token.kind == ',' && depth == 0) {
+	    args.push_back(vector<Pretoken>());
+	    continue;
+	}
+
+	if (next.token.kind == '(')
+	    depth ++;
+	else if (next.token.kind == ')')
+	    depth --;
+
+	stable(next.token);
+	args.back().push_back(next);
+    }
+
+    lineno = pt.line;
+    report("unterminated call to macro '%s'", *pt.token.name);
+    return false;
+}
+
+
+/*
+ * Function:	stringize
+ *
+ * Description:	Return a string literal of the spelling of the given
+ *		tokens, with a space wherever there was space between them
+ *		and the quotes and backslashes of literals escaped.
+ */
+
+static Pretoken stringize(const vector<Pretoken> &tokens, Pretoken pt)
+{
+    string text = "\"", s;
+    Name name;
+
+
+    for (unsigned i = 0; i < tokens.size(); i ++) {
+	if (i > 0 && tokens[i].spaced)
+	    text += ' ';
+
+	s = spelling(tokens[i].token);
+
+	if (tokens[i].token.kind == STRING || tokens[i].token.kind == CHARACTER)
+	    for (unsigned j = 0; j < s.size(); j ++) {
+		if (s[j] == '"' || s[j] == '\\')
+		    text += '\\';
+
+		text += s[j];
+	    }
+	else
+	    text += s;
+    }
+
+    name = intern(text + "\"");
+    pt.token.kind = STRING;
+    pt.token.lexeme.text = name->data();
+    pt.token.lexeme.length = name->size();
+    pt.token.name = strval(pt.token.lexeme);
+    return pt;
+}
+
+
+/*
+ * Function:	paste
+ *
+ * Description:	Paste the right token onto the left one, and return
+ *		whether the result is a single token: an identifier, a
+ *		keyword, a number, or an operator.
+ */
+
+static bool paste(Pretoken &left, const Pretoken &right)
+{
+    string text;
+    Name name;
+    unsigned i;
+    long value;
+    int kind;
+
+
+    text = spelling(left.token) + spelling(right.token);
+
+    for (i = 0; i < text.size(); i ++)
+	if (!isalnum((unsigned char) text[i]) && text[i] != '_')
+	    break;
+
+    name = intern(text);
+    left.token.lexeme.text = name->data();
+    left.token.lexeme.length = name->size();
+
+    if (i == text.size() && !isdigit((unsigned char) text[0])) {
+	kind = keyword(name->data(), name->size());
+	left.token.name = name;
+
+    } else if (i == text.size() && text.find_first_not_of("0123456789") ==
+	    string::npos) {
+	kind = NUM;
+	value = numval(left.token.lexeme);
+	left.token.value = value != -1 ? value : 0;
+
+	if (value == -1)
+	    report("invalid integer constant");
+
+    } else {
+	for (i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i ++)
+	    if (text == operators[i])
+		break;
+
+	if (i == sizeof(kinds) / sizeof(kinds[0])) {
+	    report("pasting does not give a valid token in '%s'", text);
+	    return false;
+	}
+
+	kind = kinds[i];
+    }
+
+    left.token.kind = kind;
+    return true;
+}
+
+
+/*
+ * Function:	operand
+ *
+ * Description:	Return the tokens that the given token of the body of the
+ *		given macro stands for.  An argument is expanded unless it
+ *		is an operand of '##'.
+ */
+
+static void operand(const Macro *macro, unsigned i,
+	const vector<vector<Pretoken> > &args, bool raw,
+	vector<Pretoken> &tokens)
+{
+    const Pretoken &pt = macro->body[i];
+
+
+    tokens.clear();
+
+    if (pt.token.kind == PARAM) {
+	tokens = args[pt.token.value];
+
+	if (!raw)
+	    expandList(tokens);
+
+    } else if (pt.token.kind == STRINGIZE)
+	tokens.push_back(stringize(args[pt.token.value], pt));
+    else
+	tokens.push_back(pt);
+}
+
+
+/*
+ * Function:	substitute
+ *
+ * Description:	Return the expansion of the given macro, invoked by the
+ *		given token with the given arguments.  Every token of the
+ *		expansion is on the line of the invocation, and is hidden
+ *		from the macro, as well as from any that the invocation
+ *		was hidden from.
+ */
+
+static void substitute(const Macro *macro, const Pretoken &pt,
+	const vector<vector<Pretoken> > &args, vector<Pretoken> &result)
+{
+    vector<Pretoken> tokens;
+    const Hidden *hidden;
+    unsigned i, n;
+    bool empty;
+
+
+    n = macro->body.size();
+    empty = true;
+
+    for (i = 0; i < n; i ++) {
+	if (macro->body[i].token.kind != PASTE) {
+	    operand(macro, i, args, i + 1 < n &&
+		    macro->body[i + 1].token.kind == PASTE, tokens);
+	    result.insert(result.end(), tokens.begin(), tokens.end());
+	    empty = tokens.empty();
+	    continue;
+	}
+
+	operand(macro, ++ i, args, true, tokens);
+
+	if (!tokens.empty() && !empty && paste(result.back(), tokens[0]))
+	    tokens.erase(tokens.begin());
+
+	result.insert(result.end(), tokens.begin(), tokens.end());
+	empty = empty && tokens.empty();
+    }
+
+    hidden = new (permanent) Hidden {pt.token.name, nullptr};
+    hidden = hide(pt.hidden, hidden);
+
+    for (i = 0; i < result.size(); i ++) {
+	result[i].line = pt.line;
+	result[i].hidden = hide(result[i].hidden, hidden);
+    }
+}
+
+
+/*
+ * Function:	expand
+ *
+ * Description:	Expand the given identifier, if it is a macro that it is
+ *		not hidden from, by pushing its expansion onto the given
+ *		stack, and return whether it was.  A function-like macro is
+ *		only expanded if it is followed by a parenthesis.
+ */
+
+static bool expand(Pretoken &pt, vector<Pretoken> &stack)
+{
+    unordered_map<Name, Macro *>::iterator it;
+    vector<vector<Pretoken> > args;
+    vector<Pretoken> result;
+    Pretoken paren;
+    Macro *macro;
+
+
+    if (macros.empty() || (it = macros.find(pt.token.name)) == macros.end())
+	return false;
+
+    if (hides(pt.hidden, pt.token.name))
+	return false;
+
+    macro = it->second;
+
+    if (macro->function) {
+	if (!take(paren, stack))
+	    return false;
+
+	if (paren.token.kind != '(') {
+	    stack.push_back(paren);
+	    stable(pt.token);
+	    return false;
+	}
+
+	if (!arguments(macro, pt, stack, args))
+	    return true;
+    }
+
+    substitute(macro, pt, args, result);
+    stack.insert(stack.end(), result.rbegin(), result.rend());
+    return true;
+}
+
+
+/*
+ * Function:	preprocess
+ *
+ * Description:	Return the next token after preprocessing.
+ */
+
+int preprocess(Token &token)
+{
+    Pretoken pt;
+
+
+    if (watching)
+	return nextToken(token);
+
+    do
+	take(pt, pending);
+    while (pt.token.kind == ID && expand(pt, pending));
+
+    token = pt.token;
+    lineno = pt.line;
+    return token.kind;
+}
@@ -0,0 +1,32 @@
+/*
+ * File:	preproc.h
+ *
+ * Description:	This file contains the public function declarations for
+ *		the preprocessor for Simple C.
+ *
+ *		The preprocessor works on tokens, between the lexical
+ *		analyzer and the parser, so the parser reads every token
+ *		through preprocess(), which in turn reads the source files
+ *		through nextToken().  It handles object-like and
+ *		function-like macros, #include, and the conditional
+ *		directives.  Each header is read and tokenized at most once
+ *		per process, and a header protected by an include guard or
+ *		#pragma once is not even looked at again.
+ *
+ *		A quoted header is looked for in the directory of the file
+ *		that includes it, or in the directories of the source files
+ *		if they include it, and then in the directories given with
+ *		includeDirectory(), in order, where a header in angle
+ *		brackets is looked for only.  In watch mode, the source is
+ *		not preprocessed.
+ */
+
+# ifndef PREPROC_H
+# define PREPROC_H
+# include "lexer.h"
+
+void includeDirectory(const char *dir);
+void openPreprocessor(int count, char *paths[]);
+int preprocess(Token &token);
+
+# endif /* PREPROC_H */
@@ -0,0 +1,547 @@
+/*
+ * File:	scan.cpp
+ *
+ * Description:	This file contains the scanning kernels used by the
+ *		lexical analyzer for Simple C.  There are three versions of
+ *		each kernel: a scalar one that works anywhere, and SSE2 and
+ *		AVX2 ones that look at 16 or 32 characters at a time.
+ *
+ *		The vector kernels all work the same way.  We load a block
+ *		of characters, compare them against the characters we are
+ *		interested in, and turn the comparison into a bit mask with
+ *		one bit per character.  The position of the first
+ *		interesting character is then just the number of trailing
+ *		zeros in the mask.  Newlines are counted the same way,
+ *		using the population count of a second mask.
+ *
+ *		We deliberately don't use the <cctype> functions, since the
+ *		vector kernels can't use them either, and we want all
+ *		versions to agree exactly.  The lexical analyzer never
+ *		changes the locale, so they agree with <cctype> as well.
+ */
+
+# include "scan.h"
+
+# if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define VECTOR_KERNELS
+# include <immintrin.h>
+# endif
+
+# ifndef SCAN_FLAGS
+# define SCAN_FLAGS "unknown"
+# endif
+
+
+/*
+ * Function:	isSpace, isDigit, isIdentifier
+ *
+ * Description:	Classify a character for the scalar kernels.
+ */
+
+static inline bool isSpace(unsigned char c)
+{
+    return c == ' ' || (unsigned char) (c - '\t') <= '\r' - '\t';
+}
+
+static inline bool isDigit(unsigned char c)
+{
+    return (unsigned char) (c - '0') <= 9;
+}
+
+static inline bool isIdentifier(unsigned char c)
+{
+    return isDigit(c) || (unsigned char) ((c | 0x20) - 'a') <= 25 || c == '_';
+}
+
+
+/*
+ * Function:	scalarSpace
+ *
+ * Description:	Skip white space one character at a time.
+ */
+
+static const char *scalarSpace(const char *p, int &lines)
+{
+    while (isSpace(*p)) {
+	if (*p == '\n')
+	    lines ++;
+
+	p ++;
+    }
+
+    return p;
+}
+
+
+/*
+ * Function:	scalarIdentifier
+ *
+ * Description:	Skip identifier characters one character at a time.
+ */
+
+static const char *scalarIdentifier(const char *p)
+{
+    while (isIdentifier(*p))
+	p ++;
+
+    return p;
+}
+
+
+/*
+ * Function:	scalarDigits
+ *
+ * Description:	Skip digits one character at a time.
+ */
+
+static const char *scalarDigits(const char *p)
+{
+    while (isDigit(*p))
+	p ++;
+
+    return p;
+}
+
+
+/*
+ * Function:	scalarComment
+ *
+ * Description:	Skip to the next asterisk one character at a time.
+ */
+
+static const char *scalarComment(const char *p, int &lines)
+{
+    while (*p != '*' && *p != '\0') {
+	if (*p == '\n')
+	    lines ++;
+
+	p ++;
+    }
+
+    return p;
+}
+
+
+/*
+ * Function:	scalarString
+ *
+ * Description:	Skip to the next quote, backslash, or newline one
+ *		character at a time.
+ */
+
+static const char *scalarString(const char *p, int quote)
+{
+    while (*p != quote && *p != '\\' && *p != '\n' && *p != '\0')
+	p ++;
+
+    return p;
+}
+
+
+static bool always()
+{
+    return true;
+}
+
+
+# ifdef VECTOR_KERNELS
+
+/*
+ * Function:	sse2Range
+ *
+ * Description:	Return a mask of the characters in the range [lo, hi].
+ *		SSE2 has no unsigned byte comparison, but x <= y exactly
+ *		when min(x, y) == x.
+ */
+
+__attribute__((target("sse2")))
+static inline __m128i sse2Range(__m128i v, char lo, char hi)
+{
+    __m128i x = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(hi - lo)), x);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i sse2Equal(__m128i v, char c)
+{
+    return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+__attribute__((target("sse2")))
+static inline unsigned sse2Mask(__m128i v)
+{
+    return _mm_movemask_epi8(v);
+}
+
+
+/*
+ * Function:	sse2Space
+ *
+ * Description:	Skip white space sixteen characters at a time.
+ */
+
+__attribute__((target("sse2")))
+static const char *sse2Space(const char *p, int &lines)
+{
+    unsigned space, newline, n;
+    __m128i v;
+
+
+    while (1) {
+	v = _mm_loadu_si128((const __m128i *) p);
+	space = sse2Mask(_mm_or_si128(sse2Range(v, '\t', '\r'), sse2Equal(v, ' ')));
+	newline = sse2Mask(sse2Equal(v, '\n'));
+
+	if (space != 0xFFFF) {
+	    n = __builtin_ctz(~space);
+	    lines += __builtin_popcount(newline & ((1u << n) - 1));
+	    return p + n;
+	}
+
+	lines += __builtin_popcount(newline);
+	p += 16;
+    }
+}
+
+
+/*
+ * Function:	sse2Identifier
+ *
+ * Description:	Skip identifier characters sixteen characters at a time.
+ *		Setting the 0x20 bit maps upper case letters onto lower
+ *		case ones and nothing else onto a letter.
+ */
+
+__attribute__((target("sse2")))
+static const char *sse2Identifier(const char *p)
+{
+    unsigned mask;
+    __m128i v, lower;
+
+
+    while (1) {
+	v = _mm_loadu_si128((const __m128i *) p);
+	lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+	mask = sse2Mask(_mm_or_si128(_mm_or_si128(sse2Range(lower, 'a', 'z'),
+	    sse2Range(v, '0', '9')), sse2Equal(v, '_')));
+
+	if (mask != 0xFFFF)
+	    return p + __builtin_ctz(~mask);
+
+	p += 16;
+    }
+}
+
+
+/*
+ * Function:	sse2Digits
+ *
+ * Description:	Skip digits sixteen characters at a time.
+ */
+
+__attribute__((target("sse2")))
+static const char *sse2Digits(const char *p)
+{
+    unsigned mask;
+
+
+    while (1) {
+	mask = sse2Mask(sse2Range(_mm_loadu_si128((const __m128i *) p), '0', '9'));
+
+	if (mask != 0xFFFF)
+	    return p + __builtin_ctz(~mask);
+
+	p += 16;
+    }
+}
+
+
+/*
+ * Function:	sse2Comment
+ *
+ * Description:	Skip to the next asterisk sixteen characters at a time.
+ */
+
+__attribute__((target("sse2")))
+static const char *sse2Comment(const char *p, int &lines)
+{
+    unsigned stop, newline, n;
+    __m128i v;
+
+
+    while (1) {
+	v = _mm_loadu_si128((const __m128i *) p);
+	stop = sse2Mask(_mm_or_si128(sse2Equal(v, '*'), sse2Equal(v, '\0')));
+	newline = sse2Mask(sse2Equal(v, '\n'));
+
+	if (stop != 0) {
+	    n = __builtin_ctz(stop);
+	    lines += __builtin_popcount(newline & ((1u << n) - 1));
+	    return p + n;
+	}
+
+	lines += __builtin_popcount(newline);
+	p += 16;
+    }
+}
+
+
+/*
+ * Function:	sse2String
+ *
+ * Description:	Skip to the next quote, backslash, or newline sixteen
+ *		characters at a time.
+ */
+
+__attribute__((target("sse2")))
+static const char *sse2String(const char *p, int quote)
+{
+    unsigned stop;
+    __m128i v;
+
+
+    while (1) {
+	v = _mm_loadu_si128((const __m128i *) p);
+	stop = sse2Mask(_mm_or_si128(
+	    _mm_or_si128(sse2Equal(v, quote), sse2Equal(v, '\\')),
+	    _mm_or_si128(sse2Equal(v, '\n'), sse2Equal(v, '\0'))));
+
+	if (stop != 0)
+	    return p + __builtin_ctz(stop);
+
+	p += 16;
+    }
+}
+
+
+/*
+ * Function:	avx2Range
+ *
+ * Description:	Return a mask of the characters in the range [lo, hi].
+ *		This and the other AVX2 functions are exactly the SSE2 ones
+ *		with twice the width.
+ */
+
+__attribute__((target("avx2")))
+static inline __m256i avx2Range(__m256i v, char lo, char hi)
+{
+    __m256i x = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(hi - lo)), x);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2Equal(__m256i v, char c)
+{
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned avx2Mask(__m256i v)
+{
+    return _mm256_movemask_epi8(v);
+}
+
+
+/*
+ * Function:	avx2Space
+ *
+ * Description:	Skip white space thirty-two characters at a time.
+ */
+
+__attribute__((target("avx2")))
+static const char *avx2Space(const char *p, int &lines)
+{
+    unsigned space, newline, n;
+    __m256i v;
+
+
+    while (1) {
+	v = _mm256_loadu_si256((const __m256i *) p);
+	space = avx2Mask(_mm256_or_si256(avx2Range(v, '\t', '\r'), avx2Equal(v, ' ')));
+	newline = avx2Mask(avx2Equal(v, '\n'));
+
+	if (space != 0xFFFFFFFF) {
+	    n = __builtin_ctz(~space);
+	    lines += __builtin_popcount(newline & ((1u << n) - 1));
+	    return p + n;
+	}
+
+	lines += __builtin_popcount(newline);
+	p += 32;
+    }
+}
+
+
+/*
+ * Function:	avx2Identifier
+ *
+ * Description:	Skip identifier characters thirty-two characters at a
+ *		time.
+ */
+
+__attribute__((target("avx2")))
+static const char *avx2Identifier(const char *p)
+{
+    unsigned mask;
+    __m256i v, lower;
+
+
+    while (1) {
+	v = _mm256_loadu_si256((const __m256i *) p);
+	lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+	mask = avx2Mask(_mm256_or_si256(_mm256_or_si256(avx2Range(lower, 'a', 'z'),
+	    avx2Range(v, '0', '9')), avx2Equal(v, '_')));
+
+	if (mask != 0xFFFFFFFF)
+	    return p + __builtin_ctz(~mask);
+
+	p += 32;
+    }
+}
+
+
+/*
+ * Function:	avx2Digits
+ *
+ * Description:	Skip digits thirty-two characters at a time.
+ */
+
+__attribute__((target("avx2")))
+static const char *avx2Digits(const char *p)
+{
+    unsigned mask;
+
+
+    while (1) {
+	mask = avx2Mask(avx2Range(_mm256_loadu_si256((const __m256i *) p), '0', '9'));
+
+	if (mask != 0xFFFFFFFF)
+	    return p + __builtin_ctz(~mask);
+
+	p += 32;
+    }
+}
+
+
+/*
+ * Function:	avx2Comment
+ *
+ * Description:	Skip to the next asterisk thirty-two characters at a time.
+ */
+
+__attribute__((target("avx2")))
+static const char *avx2Comment(const char *p, int &lines)
+{
+    unsigned stop, newline, n;
+    __m256i v;
+
+
+    while (1) {
+	v = _mm256_loadu_si256((const __m256i *) p);
+	stop = avx2Mask(_mm256_or_si256(avx2Equal(v, '*'), avx2Equal(v, '\0')));
+	newline = avx2Mask(avx2Equal(v, '\n'));
+
+	if (stop != 0) {
+	    n = __builtin_ctz(stop);
+	    lines += __builtin_popcount(newline & ((1u << n) - 1));
+	    return p + n;
+	}
+
+	lines += __builtin_popcount(newline);
+	p += 32;
+    }
+}
+
+
+/*
+ * Function:	avx2String
+ *
+ * Description:	Skip to the next quote, backslash, or newline thirty-two
+ *		characters at a time.
+ */
+
+__attribute__((target("avx2")))
+static const char *avx2String(const char *p, int quote)
+{
+    unsigned stop;
+    __m256i v;
+
+
+    while (1) {
+	v = _mm256_loadu_si256((const __m256i *) p);
+	stop = avx2Mask(_mm256_or_si256(
+	    _mm256_or_si256(avx2Equal(v, quote), avx2Equal(v, '\\')),
+	    _mm256_or_si256(avx2Equal(v, '\n'), avx2Equal(v, '\0'))));
+
+	if (stop != 0)
+	    return p + __builtin_ctz(stop);
+
+	p += 32;
+    }
+}
+
+
+static bool hasSSE2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+static bool hasAVX2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static const Scanner avx2 = {
+    "avx2", hasAVX2,
+    avx2Space, avx2Identifier, avx2Digits, avx2Comment, avx2String
+};
+
+static const Scanner sse2 = {
+    "sse2", hasSSE2,
+    sse2Space, sse2Identifier, sse2Digits, sse2Comment, sse2String
+};
+
+# endif /* VECTOR_KERNELS */
+
+static const Scanner scalar = {
+    "scalar", always,
+    scalarSpace, scalarIdentifier, scalarDigits, scalarComment, scalarString
+};
+
+const Scanner *const scanners[] = {
+# ifdef VECTOR_KERNELS
+    &avx2, &sse2,
+# endif
+    &scalar, 0
+};
+
+const char scanFlags[] = SCAN_FLAGS;
+
+
+/*
+ * Function:	selectScanner
+ *
+ * Description:	Return the best set of kernels supported by the machine.
+ *		Unless they are optimized, the intrinsics in the vector
+ *		kernels are calls rather than single instructions, so the
+ *		scalar kernels are best.
+ */
+
+static const Scanner *selectScanner()
+{
+    unsigned i;
+
+# ifdef __OPTIMIZE__
+    for (i = 0; !scanners[i]->supported(); i ++)
+	continue;
+# else
+    for (i = 0; scanners[i + 1] != 0; i ++)
+	continue;
+# endif
+
+    return scanners[i];
+}
+
+const Scanner *scanner = selectScanner();
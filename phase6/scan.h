@@ -0,0 +1,49 @@
+/*
+ * File:	scan.h
+ *
+ * Description:	This file contains the public declarations for the
+ *		scanning kernels used by the lexical analyzer for Simple C.
+ *
+ *		Each kernel skips over a run of characters in the source
+ *		buffer and returns a pointer to the first character that
+ *		does not belong to the run.  Since the source buffer is
+ *		terminated by a null character, and no run includes a null
+ *		character, no kernel needs to be told where the buffer
+ *		ends.  The vector kernels do read up to SCAN_PADDING bytes
+ *		past the null character, so the buffer must be padded.
+ *
+ *		space:		skip white space, counting newlines
+ *		identifier:	skip letters, digits, and underscores
+ *		digits:		skip digits
+ *		comment:	skip to the next '*', counting newlines
+ *		string:		skip to the next quote, backslash, or newline
+ *
+ *		All sets of kernels compiled in are listed in scanners,
+ *		best first and terminated by a null pointer.  The first set
+ *		supported by the machine is chosen at startup, and the last
+ *		set is always the portable scalar fallback.  Without
+ *		optimization, the vector kernels are slower than the scalar
+ *		ones, so the scalar set is chosen instead.  The flags the
+ *		kernels were compiled with are in scanFlags.
+ */
+
+# ifndef SCAN_H
+# define SCAN_H
+
+# define SCAN_PADDING 32
+
+struct Scanner {
+    const char *name;
+    bool (*supported)();
+    const char *(*space)(const char *p, int &lines);
+    const char *(*identifier)(const char *p);
+    const char *(*digits)(const char *p);
+    const char *(*comment)(const char *p, int &lines);
+    const char *(*string)(const char *p, int quote);
+};
+
+extern const Scanner *scanner;
+extern const Scanner *const scanners[];
+extern const char scanFlags[];
+
+# endif /* SCAN_H */
@@ -0,0 +1,160 @@
+/*
+ * File:	scanbench.cpp
+ *
+ * Description:	This file contains a microbenchmark for the scanning
+ *		kernels used by the lexical analyzer for Simple C.  Each
+ *		set of kernels supported by the machine is run over the
+ *		same buffers, and the throughput of each kernel is
+ *		reported, along with the flags the kernels were compiled
+ *		with and which set the lexical analyzer chose.  The
+ *		results are also checked against the scalar kernels, since
+ *		a fast wrong answer isn't worth much.
+ *
+ *		usage: scanbench [megabytes]
+ */
+
+# include <ctime>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <vector>
+# include "scan.h"
+
+using namespace std;
+
+enum { SPACE, IDENTIFIER, DIGITS, COMMENT, STRING, NKERNELS };
+
+static const char *names[NKERNELS] = {
+    "space", "identifier", "digits", "comment", "string"
+};
+
+
+/*
+ * Function:	fill
+ *
+ * Description:	Fill a buffer with runs of characters that the given kernel
+ *		skips, separated by single characters that stop it.  The
+ *		runs have random lengths, as they would in real source.
+ */
+
+static void fill(vector<char> &buf, size_t size, int kernel)
+{
+    static const char *runs[NKERNELS] = {
+	" \t\n  \n\t  ",
+	"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_",
+	"0123456789",
+	"the quick brown fox\njumps over the lazy dog\n",
+	"hello, world %d\t",
+    };
+    static const char stops[NKERNELS] = { 'x', '+', ';', '*', '"' };
+    size_t length;
+    const char *run;
+
+
+    buf.clear();
+    run = runs[kernel];
+    length = strlen(run);
+
+    while (buf.size() < size) {
+	for (int n = 1 + rand() % 64; n > 0; n --)
+	    buf.push_back(run[rand() % length]);
+
+	buf.push_back(stops[kernel]);
+    }
+
+    buf.push_back('\0');
+    buf.insert(buf.end(), SCAN_PADDING, '\0');
+}
+
+
+/*
+ * Function:	run
+ *
+ * Description:	Run a kernel over the entire buffer, restarting it after
+ *		each character it stops on.  Return a checksum of the stop
+ *		positions and newline counts.
+ */
+
+static unsigned long run(const Scanner *s, int kernel, const char *start)
+{
+    const char *p = start;
+    unsigned long sum = 0;
+    int lines = 0;
+
+
+    while (*p != '\0') {
+	switch (kernel) {
+	case SPACE:
+	    p = s->space(p, lines);
+	    break;
+	case IDENTIFIER:
+	    p = s->identifier(p);
+	    break;
+	case DIGITS:
+	    p = s->digits(p);
+	    break;
+	case COMMENT:
+	    p = s->comment(p, lines);
+	    break;
+	case STRING:
+	    p = s->string(p, '"');
+	    break;
+	}
+
+	sum = sum * 31 + (p - start);
+
+	if (*p != '\0')
+	    p ++;
+    }
+
+    return sum + lines;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Benchmark every kernel of every supported set.
+ */
+
+int main(int argc, char *argv[])
+{
+    int repeat = 20;
+    size_t size;
+    double secs;
+    clock_t start;
+    unsigned nscanners = 0;
+    vector<char> buf;
+    unsigned long expected, actual;
+
+
+    size = (argc > 1 ? atoi(argv[1]) : 16) * 1024 * 1024;
+
+    while (scanners[nscanners] != 0)
+	nscanners ++;
+
+    printf("kernels compiled with %s, %s chosen\n", scanFlags, scanner->name);
+
+    for (int k = 0; k < NKERNELS; k ++) {
+	srand(k);
+	fill(buf, size, k);
+	expected = run(scanners[nscanners - 1], k, &buf[0]);
+
+	for (unsigned i = 0; scanners[i] != 0; i ++) {
+	    if (!scanners[i]->supported())
+		continue;
+
+	    start = clock();
+
+	    for (int r = 0; r < repeat; r ++)
+		actual = run(scanners[i], k, &buf[0]);
+
+	    secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+	    printf("%-12s %-8s %8.1f MB/s%s\n", names[k], scanners[i]->name,
+		   repeat * (size / 1048576.0) / secs,
+		   actual != expected ? "  MISMATCH" : "");
+	}
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,171 @@
+/*
+ * File:	scopebench.cpp
+ *
+ * Description:	This file contains a scaling benchmark for scopes in Simple
+ *		C.  For each number of declarations, from a thousand to a
+ *		million, doubling each time, a scope is filled the way the
+ *		checker fills the outermost scope, with each declaration
+ *		first looked for and then inserted.  Then every name is
+ *		looked up, and as many missing names, from a block nested
+ *		a few scopes deep, and finally the declarations are undone
+ *		in reverse order, as the checker does when a cached unit is
+ *		checked again.
+ *
+ *		Each operation should take about the same time however
+ *		many declarations there are.  It does grow somewhat, as the
+ *		scope outgrows the caches, but a scope searched linearly
+ *		would take a thousand times as long at a million
+ *		declarations as at a thousand.
+ *
+ *		usage: scopebench [declarations]
+ */
+
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <vector>
+# include "Scope.h"
+
+# define RUNS 3
+# define DEPTH 3		/* number of scopes nested in the outermost */
+# define MAX_GROWTH 10.0	/* largest acceptable ratio to the first */
+
+using namespace std;
+
+struct Timing {
+    double declare, lookup, undo;
+};
+
+
+/*
+ * Function:	seconds
+ *
+ * Description:	Return the number of seconds since the given time.
+ */
+
+static double seconds(chrono::steady_clock::time_point start)
+{
+    chrono::duration<double> secs = chrono::steady_clock::now() - start;
+    return secs.count();
+}
+
+
+/*
+ * Function:	measure
+ *
+ * Description:	Declare, look up, and undo the given names, and return how
+ *		long each took, or exit if a lookup is wrong.
+ */
+
+static Timing measure(const vector<Name> &names, const vector<Name> &missing)
+{
+    chrono::steady_clock::time_point start;
+    Scope *outermost, *scope;
+    Arena scratch;
+    Symbol *symbol;
+    Timing timing;
+    Type integer;
+    unsigned i;
+
+
+    integer = Type(intern("int"));
+    outermost = new (scratch) Scope();
+    start = chrono::steady_clock::now();
+
+    for (i = 0; i < names.size(); i ++)
+	if (outermost->find(names[i]) == nullptr)
+	    outermost->insert(new (scratch) Symbol(names[i], integer));
+
+    timing.declare = seconds(start);
+
+    for (scope = outermost, i = 0; i < DEPTH; i ++) {
+	scope = new (scratch) Scope(scope);
+	scope->insert(new (scratch) Symbol(intern("local"), integer));
+    }
+
+    start = chrono::steady_clock::now();
+
+    for (i = 0; i < names.size(); i ++) {
+	symbol = scope->lookup(names[i]);
+
+	if (symbol == nullptr || symbol->name() != names[i]) {
+	    printf("lookup of %s failed\n", names[i]->c_str());
+	    exit(EXIT_FAILURE);
+	}
+
+	if (scope->lookup(missing[i]) != nullptr) {
+	    printf("lookup of %s did not fail\n", missing[i]->c_str());
+	    exit(EXIT_FAILURE);
+	}
+    }
+
+    timing.lookup = seconds(start);
+    start = chrono::steady_clock::now();
+
+    for (i = names.size(); i > 0; i --)
+	outermost->remove(names[i - 1]);
+
+    timing.undo = seconds(start);
+
+    if (!outermost->symbols().empty() || outermost->find(names[0])) {
+	printf("undo of %lu declarations failed\n", names.size());
+	exit(EXIT_FAILURE);
+    }
+
+    scratch.reset();
+    return timing;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Measure each number of declarations, keeping the best of
+ *		several runs, and check that the time per declaration stays
+ *		within a constant factor of that for the fewest.
+ */
+
+int main(int argc, char *argv[])
+{
+    double cost, first = 0, growth;
+    unsigned count, limit, i, run;
+    vector<Name> names, missing;
+    Timing best, timing;
+    bool failed = false;
+    char buf[32];
+
+
+    limit = argc > 1 ? atoi(argv[1]) : 1 << 20;
+
+    for (count = 1 << 10; count <= limit; count *= 2) {
+	for (i = names.size(); i < count; i ++) {
+	    names.push_back(intern(buf, sprintf(buf, "g%u", i)));
+	    missing.push_back(intern(buf, sprintf(buf, "m%u", i)));
+	}
+
+	for (run = 0; run < RUNS; run ++) {
+	    timing = measure(names, missing);
+
+	    if (run == 0 || timing.declare < best.declare)
+		best.declare = timing.declare;
+
+	    if (run == 0 || timing.lookup < best.lookup)
+		best.lookup = timing.lookup;
+
+	    if (run == 0 || timing.undo < best.undo)
+		best.undo = timing.undo;
+	}
+
+	cost = (best.declare + best.lookup + best.undo) / count;
+	growth = first > 0 ? cost / first : 1;
+	printf("%8u declarations   declare %6.1f ns   lookup %6.1f ns   "
+	       "undo %6.1f ns", count, best.declare / count * 1e9,
+	       best.lookup / count * 1e9, best.undo / count * 1e9);
+
+	printf("   x%.2f%s\n", growth, growth > MAX_GROWTH ? "  TOO SLOW" : "");
+	failed = failed || growth > MAX_GROWTH;
+	first = first > 0 ? first : cost;
+    }
+
+    exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,393 @@
+/*
+ * File:	source.cpp
+ *
+ * Description:	This file contains the public and private function and
+ *		variable definitions for the source buffer used by the
+ *		lexical analyzer for Simple C.
+ *
+ *		A regular file is memory-mapped a window at a time, so that
+ *		even a huge generated source file never has to be mapped
+ *		all at once.  Anything else, like a pipe or a terminal, is
+ *		read in large blocks instead.  Either way, the lexical
+ *		analyzer sees a buffer terminated by a null character and
+ *		followed by enough padding for the scanning kernels.
+ *
+ *		Tokens refer directly to the text in the buffer, so we must
+ *		be careful about when that text goes away.  When the buffer
+ *		is refilled, any text after the mark is carried into the
+ *		new buffer, so the token being scanned is always contiguous.
+ *		The old buffer is retired rather than released, so tokens
+ *		already returned remain valid until releaseSource().
+ *
+ *		The files named on the command line are read one after the
+ *		other, as if they were separated by a newline.  If no files
+ *		are named, then the standard input is read, as it is for a
+ *		file named "-".
+ */
+
+# include <cerrno>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <string>
+# include <vector>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "lexer.h"
+# include "source.h"
+# include "scan.h"
+
+# ifndef WINDOW_SIZE
+# define WINDOW_SIZE (64 * 1024 * 1024)
+# endif
+
+# ifndef BLOCK_SIZE
+# define BLOCK_SIZE (1024 * 1024)
+# endif
+
+using namespace std;
+
+static const char empty[SCAN_PADDING + 2] = "";
+__thread const char *cursor = empty, *limit = empty, *mark;
+
+static char **paths;
+static int npaths, current = -1;
+
+static int fd = -1;
+static bool mapped, ownmap;
+static __thread bool ended, borrowed;
+static off_t filesize, position;
+static char *base;
+static size_t length;
+static long pagesize;
+
+struct Buffer {
+    char *base;
+    size_t length;
+    bool mapped;
+};
+
+static vector<Buffer> retired;
+
+
+/*
+ * Function:	retireBuffer
+ *
+ * Description:	Retire the current buffer, if any.  Its text remains valid
+ *		until the next call to releaseSource().
+ */
+
+static void retireBuffer()
+{
+    Buffer buffer;
+
+
+    if (base != NULL) {
+	buffer.base = base;
+	buffer.length = length;
+	buffer.mapped = ownmap;
+	retired.push_back(buffer);
+    }
+
+    base = NULL;
+}
+
+
+/*
+ * Function:	mapWindow
+ *
+ * Description:	Map the next window of the source file, starting with the
+ *		page that contains the mark, if any.  We reserve an extra
+ *		anonymous page past the end of the window and then map the
+ *		file over the front of it, so there is always a writable
+ *		byte for the sentinel, even if the window ends exactly on a
+ *		page boundary.
+ */
+
+static bool mapWindow()
+{
+    off_t keep, start;
+    size_t size;
+    void *addr;
+
+
+    keep = mark != NULL ? position - (limit - mark) : position;
+    start = keep - keep % pagesize;
+    size = filesize - start;
+
+    if (size > (size_t) (position - start) + WINDOW_SIZE)
+	size = (position - start) + WINDOW_SIZE;
+
+    addr = mmap(NULL, size + pagesize, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (addr == MAP_FAILED)
+	return false;
+
+    if (mmap(addr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+	     fd, start) == MAP_FAILED) {
+	munmap(addr, size + pagesize);
+	return false;
+    }
+
+    retireBuffer();
+    base = (char *) addr;
+    base[size] = '\0';
+    length = size + pagesize;
+    ownmap = true;
+
+    if (mark != NULL)
+	mark = base + (keep - start);
+
+    cursor = base + (position - start);
+    limit = base + size;
+    position = start + size;
+    return true;
+}
+
+
+/*
+ * Function:	readBlock
+ *
+ * Description:	Read the next block of the source file into a new buffer,
+ *		after any text carried over from the mark.  This is the
+ *		fallback when the source cannot be mapped.
+ */
+
+static bool readBlock()
+{
+    size_t kept;
+    ssize_t n;
+    char *buffer;
+
+
+    kept = mark != NULL ? limit - mark : 0;
+    buffer = new char[kept + BLOCK_SIZE + 1 + SCAN_PADDING];
+    memcpy(buffer, limit - kept, kept);
+
+    do
+	n = read(fd, buffer + kept, BLOCK_SIZE);
+    while (n < 0 && errno == EINTR);
+
+    if (n <= 0) {
+	delete[] buffer;
+	return false;
+    }
+
+    memset(buffer + kept + n, 0, 1 + SCAN_PADDING);
+    retireBuffer();
+    base = buffer;
+    length = kept + n;
+    ownmap = false;
+
+    if (mark != NULL)
+	mark = buffer;
+
+    cursor = buffer + kept;
+    limit = buffer + kept + n;
+    return true;
+}
+
+
+/*
+ * Function:	slideWindow
+ *
+ * Description:	Advance the buffer past the characters that have been
+ *		consumed.  Return false if the current file is exhausted.
+ */
+
+static bool slideWindow()
+{
+    if (fd < 0 || ended)
+	return false;
+
+    if (mapped) {
+	if (position >= filesize)
+	    return false;
+
+	if (mapWindow())
+	    return true;
+
+	mapped = false;
+	lseek(fd, position, SEEK_SET);
+    }
+
+    return readBlock();
+}
+
+
+/*
+ * Function:	nextFile
+ *
+ * Description:	Close the current source file and open the next one.
+ *		Return false if there are no more files.
+ */
+
+static bool nextFile()
+{
+    struct stat st;
+    int count = npaths > 0 ? npaths : 1;
+
+
+    if (fd >= 0) {
+	retireBuffer();
+
+	if (fd != 0)
+	    close(fd);
+
+	fd = -1;
+    }
+
+    mark = NULL;
+    cursor = limit = empty;
+
+    if (current + 1 >= count)
+	return false;
+
+    current ++;
+
+    if (npaths == 0 || strcmp(paths[current], "-") == 0)
+	fd = 0;
+
+    else if ((fd = open(paths[current], O_RDONLY)) < 0) {
+	perror(paths[current]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (current > 0)
+	lineno = 1;
+
+    mapped = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+    filesize = mapped ? st.st_size : 0;
+    position = 0;
+    ended = false;
+    return true;
+}
+
+
+/*
+ * Function:	openSource
+ *
+ * Description:	Prepare to read the given source files in order.  If no
+ *		files are given, the standard input is read instead.  A
+ *		file named "-" is the standard input too.
+ */
+
+void openSource(int count, char *names[])
+{
+    pagesize = sysconf(_SC_PAGESIZE);
+    paths = names;
+    npaths = count;
+    current = -1;
+    nextFile();
+}
+
+
+/*
+ * Function:	fillSource
+ *
+ * Description:	Refill the source buffer once the cursor has reached the
+ *		limit, and return the next character.  At the end of a
+ *		file, we step the cursor onto the padding, so the character
+ *		before the cursor is still the last one read, and return a
+ *		newline if another file follows or EOF if none does.  A
+ *		borrowed buffer simply ends.
+ */
+
+int fillSource()
+{
+    if (borrowed) {
+	if (!ended) {
+	    ended = true;
+	    limit = ++ cursor;
+	}
+
+	return EOF;
+    }
+
+    while (!slideWindow()) {
+	if (fd >= 0 && !ended) {
+	    ended = true;
+	    limit = ++ cursor;
+	    return current + 1 < (npaths > 0 ? npaths : 1) ? '\n' : EOF;
+	}
+
+	if (!nextFile())
+	    return EOF;
+    }
+
+    return (unsigned char) *cursor ++;
+}
+
+
+/*
+ * Function:	openBuffer
+ *
+ * Description:	Read the given buffer on this thread instead of the source
+ *		files.  The buffer must end with a null character followed
+ *		by the usual padding, and must outlive the reading.
+ */
+
+void openBuffer(const char *start, const char *end)
+{
+    cursor = start;
+    limit = end;
+    mark = NULL;
+    ended = false;
+    borrowed = true;
+}
+
+
+/*
+ * Function:	saveSource
+ *
+ * Description:	Save where this thread is in the source buffer, so that it
+ *		can read another buffer and come back.
+ */
+
+void saveSource(SourceState &state)
+{
+    state.cursor = cursor;
+    state.limit = limit;
+    state.mark = mark;
+    state.ended = ended;
+    state.borrowed = borrowed;
+}
+
+
+/*
+ * Function:	restoreSource
+ *
+ * Description:	Go back to where this thread was in the source buffer when
+ *		it was saved.
+ */
+
+void restoreSource(const SourceState &state)
+{
+    cursor = state.cursor;
+    limit = state.limit;
+    mark = state.mark;
+    ended = state.ended;
+    borrowed = state.borrowed;
+}
+
+
+/*
+ * Function:	releaseSource
+ *
+ * Description:	Release all retired buffers.  The caller must no longer
+ *		refer to any text other than that of the current buffer.
+ */
+
+void releaseSource()
+{
+    for (unsigned i = 0; i < retired.size(); i ++)
+	if (retired[i].mapped)
+	    munmap(retired[i].base, retired[i].length);
+	else
+	    delete[] retired[i].base;
+
+    retired.clear();
+}
@@ -0,0 +1,44 @@
+/*
+ * File:	source.h
+ *
+ * Description:	This file contains the public function and variable
+ *		declarations for the source buffer used by the lexical
+ *		analyzer for Simple C.
+ *
+ *		The source buffer is a window of characters [cursor, limit)
+ *		that the lexical analyzer walks with a raw pointer.  The
+ *		character at limit is always a null character, so the
+ *		lexical analyzer only needs to compare against the limit
+ *		when it sees a null character.  When the window is used up,
+ *		fillSource() slides it forward or moves to the next file.
+ *
+ *		The lexical analyzer sets the mark to the start of the token
+ *		it is scanning, and fillSource() keeps the text from the
+ *		mark onward contiguous, moving the mark with it.  Windows
+ *		that have been left behind stay readable until
+ *		releaseSource() is called.
+ *
+ *		The cursor, limit, and mark belong to the calling thread.
+ *		Only the main thread reads the source files, but any thread
+ *		may read a buffer of its own with openBuffer(), and then go
+ *		back to what it was reading before if it saved it.
+ */
+
+# ifndef SOURCE_H
+# define SOURCE_H
+
+struct SourceState {
+    const char *cursor, *limit, *mark;
+    bool ended, borrowed;
+};
+
+extern __thread const char *cursor, *limit, *mark;
+
+void openSource(int count, char *paths[]);
+void openBuffer(const char *start, const char *end);
+void saveSource(SourceState &state);
+void restoreSource(const SourceState &state);
+int fillSource();
+void releaseSource();
+
+# endif /* SOURCE_H */
@@ -0,0 +1,166 @@
+/*
+ * File:	stagebench.cpp
+ *
+ * Description:	This file contains a benchmark for parsing in stages in
+ *		Simple C.  A source file of many top-level declarations is
+ *		generated, with a global variable and a function for each,
+ *		and each function uses the globals and calls the function
+ *		before it, so that its body looks up names declared
+ *		throughout the file.  A sequential compilation is timed
+ *		against one that parses the bodies in stages with a worker
+ *		thread for each processor, each in a child process, and the
+ *		two must produce the same assembly.
+ *
+ *		With more than one processor, parsing in stages must be no
+ *		slower.  With only one, it cannot be, since the top-level
+ *		declarations are parsed first on their own, but its cost
+ *		relative to a sequential compilation must not grow with the
+ *		number of declarations, so a file a quarter of the size is
+ *		timed as well.
+ *
+ *		usage: stagebench [functions [compiler]]
+ */
+
+# include <cstdio>
+# include <cstdlib>
+# include <string>
+# include <thread>
+# include <unistd.h>
+# include "harness.h"
+
+# define RUNS 3
+
+using namespace std;
+
+static string dir;
+
+
+/*
+ * Function:	generate
+ *
+ * Description:	Write a source file with the given number of functions,
+ *		each after a global variable of its own, and each using a
+ *		structure and the globals before it.
+ */
+
+static void generate(const string &path, unsigned count)
+{
+    FILE *fp;
+    unsigned i;
+
+
+    if ((fp = fopen(path.c_str(), "w")) == NULL) {
+	perror(path.c_str());
+	exit(EXIT_FAILURE);
+    }
+
+    fprintf(fp, "struct node { int value; struct node *next; };\n");
+    fprintf(fp, "int printf(), g0;\nstruct node head;\n\n");
+    fprintf(fp, "int f0(int n) { return n + g0; }\n\n");
+
+    for (i = 1; i < count; i ++) {
+	fprintf(fp, "int g%u;\n\n", i);
+	fprintf(fp, "int f%u(int n)\n{\n", i);
+	fprintf(fp, "    struct node *p;\n\n    p = &head;\n");
+	fprintf(fp, "    g%u = g%u + (*p).value;\n", i, i - 1);
+	fprintf(fp, "    if (n > %u)\n", i % 13);
+	fprintf(fp, "\tprintf(\"f%u: %%d\\n\", g%u);\n", i, i / 2);
+	fprintf(fp, "    return f%u(n - 1) + g%u;\n}\n\n", i - 1, i);
+    }
+
+    fclose(fp);
+}
+
+
+/*
+ * Function:	measure
+ *
+ * Description:	Time the best of several sequential and staged
+ *		compilations of a source file with the given number of
+ *		functions, and return the ratio of the two, or a negative
+ *		number if either failed or their output differed.
+ */
+
+static double measure(const char *compiler, const char *threads,
+	unsigned count)
+{
+    double secs, sequential = 0, staged = 0;
+    string source, out1, out2;
+    bool failed = false;
+    unsigned i;
+
+
+    source = dir + "/source.c";
+    out1 = dir + "/sequential.s";
+    out2 = dir + "/staged.s";
+    generate(source, count);
+
+    for (i = 0; i < RUNS && !failed; i ++) {
+	secs = compile({compiler}, source, out1);
+	sequential = i == 0 || secs < sequential ? secs : sequential;
+	failed = failed || secs < 0;
+
+	secs = compile({compiler, "--parse-threads", threads}, source, out2);
+	staged = i == 0 || secs < staged ? secs : staged;
+	failed = failed || secs < 0;
+    }
+
+    if (failed)
+	printf("%6u functions   FAILED\n", count);
+    else {
+	printf("%6u functions   sequential %7.1f ms   staged %7.1f ms   "
+	       "ratio %4.2f", count, sequential * 1e3, staged * 1e3,
+	       staged / sequential);
+	printf("%s\n", same(out1, out2) ? "" : "  MISMATCH");
+	failed = !same(out1, out2);
+    }
+
+    unlink(source.c_str());
+    unlink(out1.c_str());
+    unlink(out2.c_str());
+    return failed ? -1 : staged / sequential;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Measure a small and a large source file, and report
+ *		whether parsing in stages was slower than it should be.
+ */
+
+int main(int argc, char *argv[])
+{
+    const char *compiler;
+    double small, large;
+    unsigned count, cpus;
+    bool failed;
+    char threads[16];
+
+
+    count = argc > 1 ? atoi(argv[1]) : 20000;
+    compiler = argc > 2 ? argv[2] : "./scc";
+    cpus = max(thread::hardware_concurrency(), 1u);
+    snprintf(threads, sizeof(threads), "%u", cpus);
+
+    dir = scratch("stagebench");
+
+    printf("%u worker threads\n", cpus);
+    small = measure(compiler, threads, count / 4);
+    large = measure(compiler, threads, count);
+    rmdir(dir.c_str());
+
+    failed = small < 0 || large < 0;
+
+    if (!failed && large > small * 1.2) {
+	printf("staged compilation grows slower with the file\n");
+	failed = true;
+    }
+
+    if (!failed && cpus > 1 && large > 1.05) {
+	printf("staged compilation is slower than sequential\n");
+	failed = true;
+    }
+
+    exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
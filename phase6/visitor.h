@@ -0,0 +1,150 @@
+/*
+ * File:	visitor.h
+ *
+ * Description:	This file contains the template functions for visiting
+ *		abstract syntax trees in Simple C by the kinds of their
+ *		nodes.  A pass over a tree is a visitor with a member
+ *		template, visit<K>, for the kinds K it handles, and the
+ *		dispatch function calls the one for a kind with a single
+ *		switch.  The calls are resolved at compile time and can be
+ *		inlined, so a new pass needs neither a virtual function on
+ *		every class nor an indirect call for every node.
+ *
+ *		The same dispatch serves the flat form of a tree, whose
+ *		nodes are only indices and whose kinds are kept in an
+ *		array, and a tree of nodes, through NodeVisitor, which
+ *		calls the visitor with each node as its own class.  Since
+ *		that is an ordinary overloaded call, a visitor can handle
+ *		kinds of nodes together by their base class, such as Unary
+ *		or Binary.
+ */
+
+# ifndef VISITOR_H
+# define VISITOR_H
+# include <utility>
+# include "Tree.h"
+
+
+/* The class of each kind of node. */
+
+template <Kind K> struct NodeClass;
+
+# define NODE_CLASS(name) \
+    template <> struct NodeClass<Kind::name> { typedef name type; }
+
+NODE_CLASS(Function);
+NODE_CLASS(Block);
+NODE_CLASS(While);
+NODE_CLASS(If);
+NODE_CLASS(Return);
+NODE_CLASS(Assignment);
+NODE_CLASS(String);
+NODE_CLASS(Character);
+NODE_CLASS(Identifier);
+NODE_CLASS(Number);
+NODE_CLASS(Call);
+NODE_CLASS(Field);
+NODE_CLASS(Not);
+NODE_CLASS(Negate);
+NODE_CLASS(Dereference);
+NODE_CLASS(Address);
+NODE_CLASS(Cast);
+NODE_CLASS(Multiply);
+NODE_CLASS(Divide);
+NODE_CLASS(Remainder);
+NODE_CLASS(Add);
+NODE_CLASS(Subtract);
+NODE_CLASS(LessThan);
+NODE_CLASS(GreaterThan);
+NODE_CLASS(LessOrEqual);
+NODE_CLASS(GreaterOrEqual);
+NODE_CLASS(Equal);
+NODE_CLASS(NotEqual);
+NODE_CLASS(LogicalAnd);
+NODE_CLASS(LogicalOr);
+
+# undef NODE_CLASS
+
+
+/*
+ * Function:	dispatch
+ *
+ * Description:	Call the member of the given visitor for the given kind
+ *		with the remaining arguments, and return its result.
+ */
+
+# define VISIT(name) \
+    case Kind::name: \
+	return visitor.template visit<Kind::name>(std::forward<Args>(args)...)
+
+template <class Visitor, class... Args>
+inline auto dispatch(Kind kind, Visitor &visitor, Args &&... args)
+    -> decltype(visitor.template visit<Kind::Function>(
+	    std::forward<Args>(args)...))
+{
+    switch (kind) {
+    VISIT(Function);
+    VISIT(Block);
+    VISIT(While);
+    VISIT(If);
+    VISIT(Return);
+    VISIT(Assignment);
+    VISIT(String);
+    VISIT(Character);
+    VISIT(Identifier);
+    VISIT(Number);
+    VISIT(Call);
+    VISIT(Field);
+    VISIT(Not);
+    VISIT(Negate);
+    VISIT(Dereference);
+    VISIT(Address);
+    VISIT(Cast);
+    VISIT(Multiply);
+    VISIT(Divide);
+    VISIT(Remainder);
+    VISIT(Add);
+    VISIT(Subtract);
+    VISIT(LessThan);
+    VISIT(GreaterThan);
+    VISIT(LessOrEqual);
+    VISIT(GreaterOrEqual);
+    VISIT(Equal);
+    VISIT(NotEqual);
+    VISIT(LogicalAnd);
+    VISIT(LogicalOr);
+    }
+
+    __builtin_unreachable();
+}
+
+# undef VISIT
+
+
+/* A visitor of a tree of nodes, which calls the derived visitor with each
+   node cast to its own class. */
+
+template <class Derived>
+struct NodeVisitor {
+    template <Kind K>
+    auto visit(const Node *node) {
+	return static_cast<Derived &>(*this)(
+	    static_cast<const typename NodeClass<K>::type *>(node));
+    }
+};
+
+
+/*
+ * Function:	visit
+ *
+ * Description:	Visit the given node with the given visitor, which is
+ *		derived from NodeVisitor.
+ */
+
+template <class Visitor>
+inline auto visit(const Node *node, Visitor &visitor)
+{
+    return dispatch(node->kind(), visitor, node);
+}
+
+# endif /* VISITOR_H */
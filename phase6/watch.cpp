@@ -0,0 +1,432 @@
+/*
+ * File:	watch.cpp
+ *
+ * Description:	This file contains the public and private function and
+ *		variable definitions for the watched source file for Simple
+ *		C.
+ *
+ *		Each token is kept as an offset into the text rather than a
+ *		pointer, so that the tokens after an edit stay valid once
+ *		they are shifted by the change in length.  When the file
+ *		changes, we find the longest common prefix and suffix of the
+ *		old and new text, and lex again starting just before the
+ *		first token touching the change.  The lexical analyzer has
+ *		no state between tokens other than its position, so as soon
+ *		as it starts a token in the unchanged suffix at the same
+ *		place as an old token did, the rest of the old tokens are
+ *		what it would produce, and we stop.
+ *
+ *		Lexical errors are kept with their tokens, rather than being
+ *		reported, since the tokens may be read many times.
+ *
+ *		The text and tokens are updated in place, and the buffer
+ *		for the old text is kept for reading the next version, so
+ *		that an update touches as little fresh memory as possible.
+ */
+
+# include <cstdlib>
+# include <algorithm>
+# include <string>
+# include <vector>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/stat.h>
+# include "watch.h"
+# include "source.h"
+# include "scan.h"
+# include "tokens.h"
+
+# define POLL_INTERVAL 100000		/* microseconds between checks */
+
+using namespace std;
+
+struct Stored {
+    unsigned offset, length, value;
+    int kind, line;
+    Name name;
+    const char *error;
+};
+
+bool watching;
+
+static string path;
+static vector<char> text, spare;
+static unsigned size;
+static vector<Stored> tokens;
+static unsigned position;
+static int lastline;
+static struct stat status;
+
+
+/*
+ * Function:	readText
+ *
+ * Description:	Read the watched file into the given buffer, followed by a
+ *		null character and the padding needed by the scanner.
+ */
+
+static bool readText(vector<char> &buffer, unsigned &length)
+{
+    struct stat st;
+    ssize_t n;
+    int fd;
+
+
+    if ((fd = open(path.c_str(), O_RDONLY)) < 0)
+	return false;
+
+    if (fstat(fd, &st) < 0) {
+	close(fd);
+	return false;
+    }
+
+    buffer.assign(st.st_size + 1 + SCAN_PADDING, '\0');
+    length = 0;
+
+    while (length < (unsigned long) st.st_size) {
+	n = read(fd, &buffer[length], st.st_size - length);
+
+	if (n <= 0)
+	    break;
+
+	length += n;
+    }
+
+    close(fd);
+    status = st;
+    return length == (unsigned long) st.st_size;
+}
+
+
+/*
+ * Function:	lexFrom
+ *
+ * Description:	Start the lexical analyzer at the given offset into the
+ *		buffer, which is on the given line.
+ */
+
+static void lexFrom(const vector<char> &buffer, unsigned length,
+	unsigned offset, int line)
+{
+    openBuffer(&buffer[offset], &buffer[length]);
+    restartLexer();
+    lineno = line;
+}
+
+
+/*
+ * Function:	store
+ *
+ * Description:	Convert a token just read from the given buffer into the
+ *		form in which it is kept.
+ */
+
+static Stored store(const vector<char> &buffer, const Token &token,
+	const char *error)
+{
+    Stored stored;
+
+
+    stored.offset = token.lexeme.text - &buffer[0];
+    stored.length = token.lexeme.length;
+    stored.kind = token.kind;
+    stored.line = lineno;
+    stored.value = token.value;
+    stored.name = nullptr;
+    stored.error = error;
+
+    if (token.kind == ID)
+	stored.name = intern(token.lexeme.text, token.lexeme.length);
+    else if (token.kind == STRING)
+	stored.name = strval(token.lexeme);
+
+    return stored;
+}
+
+
+/*
+ * Function:	openWatch
+ *
+ * Description:	Read and lex the given source file in its entirety.
+ */
+
+bool openWatch(const char *name)
+{
+    const char *error;
+    Token token;
+
+
+    path = name;
+
+    if (!readText(text, size))
+	return false;
+
+    lexFrom(text, size, 0, 1);
+
+    while (lexanDeferred(token, error) != DONE)
+	tokens.push_back(store(text, token, error));
+
+    lastline = lineno;
+    watching = true;
+    return true;
+}
+
+
+/*
+ * Function:	waitWatch
+ *
+ * Description:	Wait for the watched file to change.
+ */
+
+void waitWatch()
+{
+    struct stat st;
+
+
+    while (true) {
+	usleep(POLL_INTERVAL);
+
+	if (stat(path.c_str(), &st) < 0)
+	    continue;
+
+	if (st.st_size != status.st_size || st.st_ino != status.st_ino ||
+		st.st_mtim.tv_sec != status.st_mtim.tv_sec ||
+		st.st_mtim.tv_nsec != status.st_mtim.tv_nsec)
+	    return;
+    }
+}
+
+
+/*
+ * Function:	updateWatch
+ *
+ * Description:	Read the watched file again and lex the range that has
+ *		changed.  Return false if the text has not changed at all.
+ *		Otherwise, the damage is the range of old tokens that was
+ *		replaced and the number of new tokens in its place.
+ */
+
+bool updateWatch(Damage &damage)
+{
+    unsigned length, common, prefix, suffix, lo, hi, mid, first, last;
+    vector<Stored> lexed;
+    vector<char> &buffer = spare;
+    const char *error;
+    Stored stored;
+    bool resynced;
+    long shift;
+    Token token;
+    int lines;
+
+
+    if (!readText(buffer, length))
+	return false;
+
+
+    /* Find the changed range, [prefix, length - suffix) in the new text
+       and [prefix, size - suffix) in the old text. */
+
+    common = size < length ? size : length;
+
+    for (prefix = 0; prefix < common; prefix ++)
+	if (text[prefix] != buffer[prefix])
+	    break;
+
+    if (prefix == size && size == length)
+	return false;
+
+    for (suffix = 0; suffix < common - prefix; suffix ++)
+	if (text[size - suffix - 1] != buffer[length - suffix - 1])
+	    break;
+
+    shift = (long) length - (long) size;
+
+
+    /* Find the first token touching the change, and back up one more,
+       since the character after a token is read to end it. */
+
+    lo = 0;
+    hi = tokens.size();
+
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+
+	if (tokens[mid].offset + tokens[mid].length < prefix)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    first = lo > 0 ? lo - 1 : 0;
+
+    if (first > 0)
+	lexFrom(buffer, length, tokens[first - 1].offset +
+		tokens[first - 1].length, tokens[first - 1].line);
+    else
+	lexFrom(buffer, length, 0, 1);
+
+
+    /* Lex until a token starts in the unchanged suffix where an old
+       token started, or until the end of the text. */
+
+    last = first;
+    resynced = false;
+
+    while (lexanDeferred(token, error) != DONE) {
+	stored = store(buffer, token, error);
+
+	if (stored.offset >= length - suffix) {
+	    while (last < tokens.size() &&
+		    tokens[last].offset + shift < stored.offset)
+		last ++;
+
+	    if (last < tokens.size() &&
+		    tokens[last].offset + shift == stored.offset) {
+		resynced = true;
+		break;
+	    }
+	}
+
+	lexed.push_back(stored);
+    }
+
+
+    /* Shift the old tokens after the damage and splice in the new. */
+
+    if (resynced) {
+	lines = lineno - tokens[last].line;
+
+	for (unsigned i = last; i < tokens.size(); i ++) {
+	    tokens[i].offset += shift;
+	    tokens[i].line += lines;
+	}
+
+	lastline += lines;
+
+    } else {
+	last = tokens.size();
+	lastline = lineno;
+    }
+
+    if (lexed.size() < last - first)
+	tokens.erase(tokens.begin() + first + lexed.size(),
+		     tokens.begin() + last);
+    else
+	tokens.insert(tokens.begin() + last, lexed.size() - (last - first),
+		      Stored());
+
+    copy(lexed.begin(), lexed.end(), tokens.begin() + first);
+
+    damage.first = first;
+    damage.removed = last - first;
+    damage.added = lexed.size();
+
+    text.swap(buffer);
+    size = length;
+    return true;
+}
+
+
+/*
+ * Function:	seekWatch
+ *
+ * Description:	Make the token with the given index the next to be read.
+ */
+
+void seekWatch(unsigned index)
+{
+    position = index;
+}
+
+
+/*
+ * Function:	tellWatch
+ *
+ * Description:	Return the index of the next token to be read.
+ */
+
+unsigned tellWatch()
+{
+    return position;
+}
+
+
+/*
+ * Function:	watchCount
+ *
+ * Description:	Return the number of tokens in the watched file.
+ */
+
+unsigned watchCount()
+{
+    return tokens.size();
+}
+
+
+/*
+ * Function:	watchLine
+ *
+ * Description:	Return the line number of the token with the given index,
+ *		or of the end of the file if there is no such token.
+ */
+
+int watchLine(unsigned index)
+{
+    return index < tokens.size() ? tokens[index].line : lastline;
+}
+
+
+/*
+ * Function:	watchToken
+ *
+ * Description:	Return the next token, just as lexan() would, other than
+ *		not reporting any lexical error again.  Reading the end of
+ *		the file counts as reading a token, so that the position
+ *		less the number of tokens read ahead is always the index of
+ *		the next token to be parsed.
+ */
+
+int watchToken(Token &token)
+{
+    Stored *stored;
+
+
+    if (position >= tokens.size()) {
+	position = tokens.size() + 1;
+	lineno = lastline;
+	token.kind = DONE;
+	token.lexeme.text = "";
+	token.lexeme.length = 0;
+	return DONE;
+    }
+
+    stored = &tokens[position ++];
+    lineno = stored->line;
+    token.kind = stored->kind;
+    token.lexeme.text = &text[stored->offset];
+    token.lexeme.length = stored->length;
+    token.name = stored->name;
+    token.value = stored->value;
+    return token.kind;
+}
+
+
+/*
+ * Function:	watchErrors
+ *
+ * Description:	Append the lexical errors in the watched file to the given
+ *		diagnostics.
+ */
+
+void watchErrors(vector<Diagnostic> &errors)
+{
+    Diagnostic diagnostic;
+
+
+    for (unsigned i = 0; i < tokens.size(); i ++)
+	if (tokens[i].error != nullptr) {
+	    diagnostic.line = tokens[i].line;
+	    diagnostic.message = tokens[i].error;
+	    errors.push_back(diagnostic);
+	}
+}
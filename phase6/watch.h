@@ -0,0 +1,35 @@
+/*
+ * File:	watch.h
+ *
+ * Description:	This file contains the public function and variable
+ *		declarations for the watched source file for Simple C.
+ *
+ *		In watch mode, the source file and its token stream are
+ *		kept in memory.  When the file changes, only the tokens in
+ *		the damaged range are lexed again, and the damage is
+ *		described to the parser as a range of tokens that was
+ *		replaced, so that it need only check the declarations that
+ *		overlap it.
+ */
+
+# ifndef WATCH_H
+# define WATCH_H
+# include "lexer.h"
+
+struct Damage {
+    unsigned first, removed, added;
+};
+
+extern bool watching;
+
+bool openWatch(const char *path);
+void waitWatch();
+bool updateWatch(Damage &damage);
+void seekWatch(unsigned index);
+unsigned tellWatch();
+unsigned watchCount();
+int watchLine(unsigned index);
+int watchToken(Token &token);
+void watchErrors(std::vector<Diagnostic> &errors);
+
+# endif /* WATCH_H */